@@ -6,6 +6,7 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/softirq.h"
 #include "threads/synch.h"
 
 /* The code in this file is an interface to an ATA (IDE)
@@ -71,7 +72,8 @@ struct channel {
 	struct lock lock;           /* Must acquire to access the controller. */
 	bool expecting_interrupt;   /* True if an interrupt is expected, false if
 								   any interrupt would be spurious. */
-	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+	bool completed;             /* Interrupt seen, waiter not yet woken. */
+	struct semaphore completion_wait;   /* Up'd by the disk softirq. */
 
 	struct disk devices[2];     /* The devices on this channel. */
 };
@@ -95,12 +97,14 @@ static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static softirq_func disk_softirq;
 
 /* Initialize the disk subsystem and detect disks. */
 void
 disk_init (void) {
 	size_t chan_no;
 
+	softirq_register (SOFTIRQ_DISK, disk_softirq, "disk");
 	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
 		struct channel *c = &channels[chan_no];
 		int dev_no;
@@ -121,6 +125,7 @@ disk_init (void) {
 		}
 		lock_init (&c->lock);
 		c->expecting_interrupt = false;
+		c->completed = false;
 		sema_init (&c->completion_wait, 0);
 
 		/* Initialize devices. */
@@ -511,7 +516,8 @@ select_device_wait (const struct disk *d) {
 	wait_until_idle (d);
 }
 
-/* ATA interrupt handler. */
+/* ATA interrupt handler.  Acknowledges the interrupt and leaves
+   waking the waiter to the softirq. */
 static void
 interrupt_handler (struct intr_frame *f) {
 	struct channel *c;
@@ -520,7 +526,8 @@ interrupt_handler (struct intr_frame *f) {
 		if (f->vec_no == c->irq) {
 			if (c->expecting_interrupt) {
 				inb (reg_status (c));               /* Acknowledge interrupt. */
-				sema_up (&c->completion_wait);      /* Wake up waiter. */
+				c->completed = true;
+				softirq_raise (SOFTIRQ_DISK);
 			} else
 				printf ("%s: unexpected interrupt\n", c->name);
 			return;
@@ -529,6 +536,23 @@ interrupt_handler (struct intr_frame *f) {
 	NOT_REACHED ();
 }
 
+/* Disk softirq.  Wakes up the waiter on every channel whose
+   command has completed. */
+static void
+disk_softirq (void) {
+	struct channel *c;
+
+	for (c = channels; c < channels + CHANNEL_CNT; c++) {
+		enum intr_level old_level = intr_disable ();
+		bool completed = c->completed;
+
+		c->completed = false;
+		intr_set_level (old_level);
+		if (completed)
+			sema_up (&c->completion_wait);      /* Wake up waiter. */
+	}
+}
+
 static void
 inspect_read_cnt (struct intr_frame *f) {
 	struct disk * d = disk_get (f->R.rdx, f->R.rcx);
@@ -3,6 +3,8 @@
 #include "threads/thread.h"
 
 static int next (int pos);
+static bool empty (const struct intq *q);
+static bool full (const struct intq *q);
 static void wait (struct intq *q, struct thread **waiter);
 static void signal (struct intq *q, struct thread **waiter);
 
@@ -10,22 +12,33 @@ static void signal (struct intq *q, struct thread **waiter);
 void
 intq_init (struct intq *q) {
 	lock_init (&q->lock);
+	spin_init (&q->spin);
 	q->not_full = q->not_empty = NULL;
 	q->head = q->tail = 0;
 }
 
 /* Returns true if Q is empty, false otherwise. */
 bool
-intq_empty (const struct intq *q) {
+intq_empty (struct intq *q) {
+	bool result;
+
 	ASSERT (intr_get_level () == INTR_OFF);
-	return q->head == q->tail;
+	spin_lock (&q->spin);
+	result = empty (q);
+	spin_unlock (&q->spin);
+	return result;
 }
 
 /* Returns true if Q is full, false otherwise. */
 bool
-intq_full (const struct intq *q) {
+intq_full (struct intq *q) {
+	bool result;
+
 	ASSERT (intr_get_level () == INTR_OFF);
-	return next (q->head) == q->tail;
+	spin_lock (&q->spin);
+	result = full (q);
+	spin_unlock (&q->spin);
+	return result;
 }
 
 /* Removes a byte from Q and returns it.
@@ -37,16 +50,23 @@ intq_getc (struct intq *q) {
 	uint8_t byte;
 
 	ASSERT (intr_get_level () == INTR_OFF);
-	while (intq_empty (q)) {
+	spin_lock (&q->spin);
+	while (empty (q)) {
 		ASSERT (!intr_context ());
+		spin_unlock (&q->spin);
 		lock_acquire (&q->lock);
-		wait (q, &q->not_empty);
+		spin_lock (&q->spin);
+		if (empty (q))
+			wait (q, &q->not_empty);
+		spin_unlock (&q->spin);
 		lock_release (&q->lock);
+		spin_lock (&q->spin);
 	}
 
 	byte = q->buf[q->tail];
 	q->tail = next (q->tail);
 	signal (q, &q->not_full);
+	spin_unlock (&q->spin);
 	return byte;
 }
 
@@ -57,16 +77,23 @@ intq_getc (struct intq *q) {
 void
 intq_putc (struct intq *q, uint8_t byte) {
 	ASSERT (intr_get_level () == INTR_OFF);
-	while (intq_full (q)) {
+	spin_lock (&q->spin);
+	while (full (q)) {
 		ASSERT (!intr_context ());
+		spin_unlock (&q->spin);
 		lock_acquire (&q->lock);
-		wait (q, &q->not_full);
+		spin_lock (&q->spin);
+		if (full (q))
+			wait (q, &q->not_full);
+		spin_unlock (&q->spin);
 		lock_release (&q->lock);
+		spin_lock (&q->spin);
 	}
 
 	q->buf[q->head] = byte;
 	q->head = next (q->head);
 	signal (q, &q->not_empty);
+	spin_unlock (&q->spin);
 }
 
 /* Returns the position after POS within an intq. */
@@ -75,28 +102,43 @@ next (int pos) {
 	return (pos + 1) % INTQ_BUFSIZE;
 }
 
+/* Returns true if Q is empty.  Q's spinlock must be held. */
+static bool
+empty (const struct intq *q) {
+	return q->head == q->tail;
+}
+
+/* Returns true if Q is full.  Q's spinlock must be held. */
+static bool
+full (const struct intq *q) {
+	return next (q->head) == q->tail;
+}
+
 /* WAITER must be the address of Q's not_empty or not_full
-   member.  Waits until the given condition is true. */
+   member.  Waits until the given condition is true.  Q's
+   spinlock must be held; it is released while waiting and held
+   again on return. */
 static void
-wait (struct intq *q UNUSED, struct thread **waiter) {
+wait (struct intq *q, struct thread **waiter) {
 	ASSERT (!intr_context ());
-	ASSERT (intr_get_level () == INTR_OFF);
-	ASSERT ((waiter == &q->not_empty && intq_empty (q))
-			|| (waiter == &q->not_full && intq_full (q)));
+	ASSERT (spin_held (&q->spin));
+	ASSERT ((waiter == &q->not_empty && empty (q))
+			|| (waiter == &q->not_full && full (q)));
 
 	*waiter = thread_current ();
-	thread_block ();
+	thread_block_unlock (&q->spin);
+	spin_lock (&q->spin);
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
    member, and the associated condition must be true.  If a
    thread is waiting for the condition, wakes it up and resets
-   the waiting thread. */
+   the waiting thread.  Q's spinlock must be held. */
 static void
-signal (struct intq *q UNUSED, struct thread **waiter) {
-	ASSERT (intr_get_level () == INTR_OFF);
-	ASSERT ((waiter == &q->not_empty && !intq_empty (q))
-			|| (waiter == &q->not_full && !intq_full (q)));
+signal (struct intq *q, struct thread **waiter) {
+	ASSERT (spin_held (&q->spin));
+	ASSERT ((waiter == &q->not_empty && !empty (q))
+			|| (waiter == &q->not_full && !full (q)));
 
 	if (*waiter != NULL) {
 		thread_unblock (*waiter);
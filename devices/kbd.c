@@ -6,6 +6,7 @@
 #include "devices/input.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/softirq.h"
 
 /* Keyboard data register port. */
 #define DATA_REG 0x60
@@ -23,12 +24,24 @@ static bool caps_lock;
 /* Number of keys pressed. */
 static int64_t key_cnt;
 
+/* Scancodes read by the interrupt handler and not yet decoded by
+   the softirq.  Slot I % SCAN_BUF_SIZE holds scancode I.  The PIC
+   only interrupts the first CPU, which raises and runs the
+   softirq, so this and the key state above need no lock beyond
+   turning interrupts off. */
+#define SCAN_BUF_SIZE 16
+static unsigned scan_buf[SCAN_BUF_SIZE];
+static unsigned scan_head, scan_tail;   /* Next to decode, next to fill. */
+
 static intr_handler_func keyboard_interrupt;
+static softirq_func keyboard_softirq;
+static void decode_scancode (unsigned code);
 
 /* Initializes the keyboard. */
 void
 kbd_init (void) {
 	intr_register_ext (0x21, keyboard_interrupt, "8042 Keyboard");
+	softirq_register (SOFTIRQ_KBD, keyboard_softirq, "keyboard");
 }
 
 /* Prints keyboard statistics. */
@@ -84,26 +97,53 @@ static const struct keymap shifted_keymap[] = {
 
 static bool map_key (const struct keymap[], unsigned scancode, uint8_t *);
 
+/* Keyboard interrupt handler.  Reads the scancode and leaves
+   decoding it to the softirq. */
 static void
 keyboard_interrupt (struct intr_frame *args UNUSED) {
+	unsigned code;
+
+	/* Read scancode, including second byte if prefix code. */
+	code = inb (DATA_REG);
+	if (code == 0xe0)
+		code = (code << 8) | inb (DATA_REG);
+
+	/* Drop the key if the softirq has fallen that far behind. */
+	if (scan_tail - scan_head < SCAN_BUF_SIZE)
+		scan_buf[scan_tail++ % SCAN_BUF_SIZE] = code;
+	softirq_raise (SOFTIRQ_KBD);
+}
+
+/* Keyboard softirq.  Decodes the scancodes read so far. */
+static void
+keyboard_softirq (void) {
+	enum intr_level old_level = intr_disable ();
+
+	while (scan_head != scan_tail) {
+		decode_scancode (scan_buf[scan_head++ % SCAN_BUF_SIZE]);
+		intr_set_level (old_level);
+		old_level = intr_disable ();
+	}
+	intr_set_level (old_level);
+}
+
+/* Updates the shift state for scancode CODE or adds the
+   character it stands for to the input buffer.  Interrupts must
+   be off. */
+static void
+decode_scancode (unsigned code) {
 	/* Status of shift keys. */
 	bool shift = left_shift || right_shift;
 	bool alt = left_alt || right_alt;
 	bool ctrl = left_ctrl || right_ctrl;
 
-	/* Keyboard scancode. */
-	unsigned code;
-
 	/* False if key pressed, true if key released. */
 	bool release;
 
 	/* Character that corresponds to `code'. */
 	uint8_t c;
 
-	/* Read scancode, including second byte if prefix code. */
-	code = inb (DATA_REG);
-	if (code == 0xe0)
-		code = (code << 8) | inb (DATA_REG);
+	ASSERT (intr_get_level () == INTR_OFF);
 
 	/* Bit 0x80 distinguishes key press from key release
 	   (even if there's a prefix). */
@@ -0,0 +1,282 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/mmu.h"
+#include "threads/softirq.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Local APIC, one per CPU.  Each CPU sees its own local APIC at
+   the same physical address, so a single mapping serves them
+   all.  See [IA32-v3a] chapter 10 "Advanced Programmable
+   Interrupt Controller (APIC)". */
+
+/* Register offsets, in bytes. */
+#define LAPIC_ID      0x020     /* ID. */
+#define LAPIC_TPR     0x080     /* Task priority. */
+#define LAPIC_EOI     0x0b0     /* End of interrupt. */
+#define LAPIC_SVR     0x0f0     /* Spurious interrupt vector. */
+#define LAPIC_ESR     0x280     /* Error status. */
+#define LAPIC_ICRLO   0x300     /* Interrupt command, low half. */
+#define LAPIC_ICRHI   0x310     /* Interrupt command, high half. */
+#define LAPIC_TIMER   0x320     /* LVT timer. */
+#define LAPIC_LINT0   0x350     /* LVT local interrupt 0. */
+#define LAPIC_LINT1   0x360     /* LVT local interrupt 1. */
+#define LAPIC_ERROR   0x370     /* LVT error. */
+#define LAPIC_TICR    0x380     /* Timer initial count. */
+#define LAPIC_TCCR    0x390     /* Timer current count. */
+#define LAPIC_TDCR    0x3e0     /* Timer divide configuration. */
+
+/* Register bits. */
+#define SVR_ENABLE    0x00100   /* APIC software enable. */
+#define LVT_MASKED    0x10000   /* Interrupt masked. */
+#define LVT_EXTINT    0x00700   /* Deliver as from the 8259A PIC. */
+#define LVT_NMI       0x00400   /* Deliver as NMI. */
+#define TIMER_PERIODIC 0x20000  /* Timer reloads on expiry. */
+#define TIMER_TSC_DEADLINE 0x40000 /* Timer fires at IA32_TSC_DEADLINE. */
+#define TDCR_DIV16    0x3       /* Timer counts at bus clock / 16. */
+#define ICR_INIT      0x00500   /* INIT delivery mode. */
+#define ICR_STARTUP   0x00600   /* Start-up IPI delivery mode. */
+#define ICR_PENDING   0x01000   /* Delivery status: send pending. */
+#define ICR_ASSERT    0x04000   /* Level assert. */
+#define ICR_LEVEL     0x08000   /* Level triggered. */
+
+/* Model-specific register holding the TSC-deadline timer's
+   deadline, and the CPUID leaf 1 ECX bit that announces it. */
+#define MSR_TSC_DEADLINE 0x6e0
+#define CPUID_TSC_DEADLINE (1u << 24)
+
+/* Mapped register page, or NULL if there is no local APIC. */
+static volatile uint32_t *lapic;
+
+/* Timer count per timer tick, set by lapic_timer_calibrate(). */
+static uint32_t lapic_count_per_tick;
+
+/* Is the bootstrap processor's timer in TSC-deadline mode? */
+static bool hrtimer_tsc_mode;
+
+static intr_handler_func lapic_timer_interrupt;
+static intr_handler_func lapic_resched_interrupt;
+static intr_handler_func lapic_hrtimer_interrupt;
+
+static uint32_t
+lapic_read (int reg) {
+	return lapic[reg / 4];
+}
+
+static void
+lapic_write (int reg, uint32_t value) {
+	lapic[reg / 4] = value;
+	/* Read back to make sure the write has landed. */
+	(void) lapic[LAPIC_ID / 4];
+}
+
+/* Maps the local APIC registers at physical address BASE into the
+   kernel page table, uncached, and registers the local APIC's
+   interrupts.  Called once, on the bootstrap processor. */
+void
+lapic_map (uint64_t base) {
+	uint64_t va = (uint64_t) ptov (base);
+	uint64_t *pte;
+
+	ASSERT (lapic == NULL);
+
+	pte = pml4e_walk (base_pml4, va, 1);
+	if (pte == NULL)
+		PANIC ("cannot map local APIC");
+	*pte = base | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+	invlpg (va);
+	lapic = (volatile uint32_t *) va;
+
+	intr_register_ext (LAPIC_TIMER_VEC, lapic_timer_interrupt, "APIC Timer");
+	intr_register_ext (LAPIC_RESCHED_VEC, lapic_resched_interrupt,
+			"Reschedule IPI");
+	intr_register_ext (LAPIC_HRTIMER_VEC, lapic_hrtimer_interrupt,
+			"APIC HR Timer");
+}
+
+/* Enables the running CPU's local APIC.  If BSP, this is the
+   bootstrap processor, where the 8259A PICs stay wired through
+   LINT0 so that device interrupts keep arriving there;
+   application processors only take IPIs and their own timer. */
+void
+lapic_init (bool bsp) {
+	ASSERT (lapic != NULL);
+
+	lapic_write (LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+	lapic_write (LAPIC_TIMER, LVT_MASKED);
+	lapic_write (LAPIC_LINT0, bsp ? LVT_EXTINT : LVT_MASKED);
+	lapic_write (LAPIC_LINT1, bsp ? LVT_NMI : LVT_MASKED);
+	lapic_write (LAPIC_ERROR, LVT_MASKED);
+
+	/* Clear error status, which takes back-to-back writes, and any
+	   outstanding interrupt. */
+	lapic_write (LAPIC_ESR, 0);
+	lapic_write (LAPIC_ESR, 0);
+	lapic_write (LAPIC_EOI, 0);
+
+	/* Accept interrupts of every priority. */
+	lapic_write (LAPIC_TPR, 0);
+}
+
+/* Returns the running CPU's local APIC ID. */
+uint8_t
+lapic_id (void) {
+	return lapic_read (LAPIC_ID) >> 24;
+}
+
+/* Acknowledges the interrupt being serviced. */
+void
+lapic_eoi (void) {
+	lapic_write (LAPIC_EOI, 0);
+}
+
+/* Sends an inter-processor interrupt with ICR low half ICRLO to
+   the CPU with local APIC ID APIC_ID, and waits for the local
+   APIC to accept it. */
+static void
+send_icr (uint8_t apic_id, uint32_t icrlo) {
+	lapic_write (LAPIC_ICRHI, (uint32_t) apic_id << 24);
+	lapic_write (LAPIC_ICRLO, icrlo);
+	while (lapic_read (LAPIC_ICRLO) & ICR_PENDING)
+		asm volatile ("pause");
+}
+
+/* Sends interrupt VEC to the CPU with local APIC ID APIC_ID. */
+void
+lapic_send_ipi (uint8_t apic_id, uint8_t vec) {
+	send_icr (apic_id, vec);
+}
+
+/* Starts the application processor with local APIC ID APIC_ID
+   running real-mode code at physical address START_PA, using
+   the INIT, STARTUP, STARTUP sequence from the MultiProcessor
+   Specification, appendix B.4. */
+void
+lapic_start_ap (uint8_t apic_id, uint64_t start_pa) {
+	ASSERT (start_pa % PGSIZE == 0 && start_pa < 0x100000);
+
+	send_icr (apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+	timer_msleep (10);
+	send_icr (apic_id, ICR_INIT | ICR_LEVEL);
+
+	for (int i = 0; i < 2; i++) {
+		send_icr (apic_id, ICR_STARTUP | (start_pa >> 12));
+		timer_usleep (200);
+	}
+}
+
+/* Measures how fast the local APIC timer counts against the
+   8254, which must already be ticking.  All CPUs share the bus
+   clock, so measuring on one CPU is enough. */
+void
+lapic_timer_calibrate (void) {
+	const int cal_ticks = 10;
+	int64_t start;
+	uint32_t elapsed;
+
+	ASSERT (intr_get_level () == INTR_ON);
+
+	lapic_write (LAPIC_TDCR, TDCR_DIV16);
+	lapic_write (LAPIC_TIMER, LVT_MASKED);
+
+	/* Start counting on a tick boundary. */
+	start = timer_ticks ();
+	while (timer_ticks () == start)
+		barrier ();
+	start++;
+
+	lapic_write (LAPIC_TICR, UINT32_MAX);
+	while (timer_ticks () < start + cal_ticks)
+		barrier ();
+	elapsed = UINT32_MAX - lapic_read (LAPIC_TCCR);
+	lapic_write (LAPIC_TICR, 0);
+
+	lapic_count_per_tick = elapsed / cal_ticks;
+	ASSERT (lapic_count_per_tick > 0);
+}
+
+/* Starts the running CPU's local APIC timer, interrupting
+   TIMER_FREQ times per second like the 8254. */
+void
+lapic_timer_start (void) {
+	ASSERT (lapic_count_per_tick > 0);
+
+	lapic_write (LAPIC_TDCR, TDCR_DIV16);
+	lapic_write (LAPIC_TIMER, TIMER_PERIODIC | LAPIC_TIMER_VEC);
+	lapic_write (LAPIC_TICR, lapic_count_per_tick);
+}
+
+/* Turns the running CPU's local APIC timer, which must be the
+   bootstrap processor's, into the high-resolution timer: one
+   interrupt at a time on LAPIC_HRTIMER_VEC, armed by
+   lapic_hrtimer_arm().  Uses TSC-deadline mode if the CPU has it,
+   and one-shot mode otherwise.  Returns true for TSC-deadline
+   mode. */
+bool
+lapic_hrtimer_start (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	ASSERT (lapic_count_per_tick > 0);
+
+	cpuid (1, &eax, &ebx, &ecx, &edx);
+	hrtimer_tsc_mode = (ecx & CPUID_TSC_DEADLINE) != 0;
+
+	lapic_write (LAPIC_TDCR, TDCR_DIV16);
+	lapic_write (LAPIC_TIMER, (hrtimer_tsc_mode ? TIMER_TSC_DEADLINE : 0)
+			| LAPIC_HRTIMER_VEC);
+	return hrtimer_tsc_mode;
+}
+
+/* Arms the high-resolution timer to interrupt once the time-stamp
+   counter reaches DEADLINE, or as soon as possible if it
+   already has.  In one-shot mode, a deadline more than a tick
+   away interrupts after a tick instead, so that the count cannot
+   overflow; the handler then arms it again.  Must run on the
+   bootstrap processor with interrupts off. */
+void
+lapic_hrtimer_arm (uint64_t deadline) {
+	uint64_t now, cycles, tick_cycles = timer_ticks_to_cycles (1);
+	uint64_t count;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (hrtimer_tsc_mode) {
+		write_msr (MSR_TSC_DEADLINE, deadline);
+		return;
+	}
+
+	now = rdtsc ();
+	cycles = deadline > now ? deadline - now : 0;
+	if (cycles > tick_cycles)
+		cycles = tick_cycles;
+	count = DIV_ROUND_UP (cycles * lapic_count_per_tick, tick_cycles);
+	lapic_write (LAPIC_TICR, count > 0 ? count : 1);
+}
+
+/* Local APIC timer interrupt handler.  Drives time slicing on
+   application processors, through the timer softirq; the 8254
+   on the bootstrap processor still keeps the system time. */
+static void
+lapic_timer_interrupt (struct intr_frame *args UNUSED) {
+	softirq_raise (SOFTIRQ_TIMER);
+}
+
+/* High-resolution timer interrupt handler, also sent as an IPI
+   by other CPUs that need the timer armed earlier. */
+static void
+lapic_hrtimer_interrupt (struct intr_frame *args UNUSED) {
+	timer_hr_interrupt ();
+}
+
+/* Reschedule IPI handler.  Another CPU queued a thread here. */
+static void
+lapic_resched_interrupt (struct intr_frame *args UNUSED) {
+	thread_preempt ();
+}
@@ -5,6 +5,7 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/softirq.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -54,10 +55,15 @@ static enum { UNINIT, POLL, QUEUE } mode;
 /* Data to be transmitted. */
 static struct intq txq;
 
+/* Serializes access to the UART among CPUs, and makes checking
+   and then changing txq atomic.  Interrupts must be off. */
+static struct spinlock serial_lock;
+
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
+static softirq_func serial_softirq;
 
 /* Initializes the serial port device for polling mode.
    Polling mode busy-waits for the serial port to become free
@@ -71,6 +77,7 @@ init_poll (void) {
 	set_serial (115200);                  /* 115.2 kbps, N-8-1. */
 	outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
 	intq_init (&txq);
+	spin_init (&serial_lock);
 	mode = POLL;
 }
 
@@ -86,9 +93,12 @@ serial_init_queue (void) {
 	ASSERT (mode == POLL);
 
 	intr_register_ext (0x20 + 4, serial_interrupt, "serial");
+	softirq_register (SOFTIRQ_SERIAL, serial_softirq, "serial");
 	mode = QUEUE;
 	old_level = intr_disable ();
+	spin_lock (&serial_lock);
 	write_ier ();
+	spin_unlock (&serial_lock);
 	intr_set_level (old_level);
 }
 
@@ -102,10 +112,13 @@ serial_putc (uint8_t byte) {
 		   use dumb polling to transmit a byte. */
 		if (mode == UNINIT)
 			init_poll ();
+		spin_lock (&serial_lock);
 		putc_poll (byte);
+		spin_unlock (&serial_lock);
 	} else {
 		/* Otherwise, queue a byte and update the interrupt enable
 		   register. */
+		spin_lock (&serial_lock);
 		if (old_level == INTR_OFF && intq_full (&txq)) {
 			/* Interrupts are off and the transmit queue is full.
 			   If we wanted to wait for the queue to empty,
@@ -115,8 +128,16 @@ serial_putc (uint8_t byte) {
 			putc_poll (intq_getc (&txq));
 		}
 
-		intq_putc (&txq, byte);
+		if (old_level == INTR_OFF || !intq_full (&txq))
+			intq_putc (&txq, byte);
+		else {
+			/* Wait for room without holding up the other CPUs. */
+			spin_unlock (&serial_lock);
+			intq_putc (&txq, byte);
+			spin_lock (&serial_lock);
+		}
 		write_ier ();
+		spin_unlock (&serial_lock);
 	}
 
 	intr_set_level (old_level);
@@ -127,8 +148,10 @@ serial_putc (uint8_t byte) {
 void
 serial_flush (void) {
 	enum intr_level old_level = intr_disable ();
+	spin_lock (&serial_lock);
 	while (!intq_empty (&txq))
 		putc_poll (intq_getc (&txq));
+	spin_unlock (&serial_lock);
 	intr_set_level (old_level);
 }
 
@@ -139,8 +162,17 @@ serial_flush (void) {
 void
 serial_notify (void) {
 	ASSERT (intr_get_level () == INTR_OFF);
-	if (mode == QUEUE)
+	if (mode == QUEUE) {
+		/* The serial softirq gets here through input_putc() with
+		   the lock already held. */
+		bool locked = spin_held (&serial_lock);
+
+		if (!locked)
+			spin_lock (&serial_lock);
 		write_ier ();
+		if (!locked)
+			spin_unlock (&serial_lock);
+	}
 }
 
 /* Configures the serial port for BPS bits per second. */
@@ -162,12 +194,12 @@ set_serial (int bps) {
 	outb (LCR_REG, LCR_N81);
 }
 
-/* Update interrupt enable register. */
+/* Update interrupt enable register.  serial_lock must be held. */
 static void
 write_ier (void) {
 	uint8_t ier = 0;
 
-	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (spin_held (&serial_lock));
 
 	/* Enable transmit interrupt if we have any characters to
 	   transmit. */
@@ -193,12 +225,23 @@ putc_poll (uint8_t byte) {
 	outb (THR_REG, byte);
 }
 
-/* Serial interrupt handler. */
+/* Serial interrupt handler.  Masks the UART's interrupts and
+   leaves moving the data to the softirq, which unmasks them. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) {
 	/* Inquire about interrupt in UART.  Without this, we can
 	   occasionally miss an interrupt running under QEMU. */
 	inb (IIR_REG);
+	outb (IER_REG, 0);
+	softirq_raise (SOFTIRQ_SERIAL);
+}
+
+/* Serial softirq.  Receives and transmits what it can. */
+static void
+serial_softirq (void) {
+	enum intr_level old_level = intr_disable ();
+
+	spin_lock (&serial_lock);
 
 	/* As long as we have room to receive a byte, and the hardware
 	   has a byte for us, receive a byte.  */
@@ -212,4 +255,6 @@ serial_interrupt (struct intr_frame *f UNUSED) {
 
 	/* Update interrupt enable register based on queue status. */
 	write_ier ();
+	spin_unlock (&serial_lock);
+	intr_set_level (old_level);
 }
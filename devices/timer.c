@@ -3,10 +3,14 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/softirq.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "devices/lapic.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -21,15 +25,125 @@
 
 static int64_t ticks;
 
+/* Protects `ticks', the timer wheel, the pending hrtimers, and
+   the 8254 state below.  It is never held while a timer's
+   callback runs: the callback may take other locks, and may arm
+   timers itself.  timer_running[I] is the timer whose callback
+   CPU I is running, if any, so that cancelling a timer can wait
+   for its callback to finish. */
+static struct spinlock timer_lock;
+static const void *timer_running[CPU_MAX];
+
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Time-stamp counter cycles per timer tick.
+   Initialized by timer_calibrate(). */
+static uint64_t cycles_per_tick;
+
+/* Hierarchical timer wheel.
+
+   Level L has TW_SIZE slots, each TW_SIZE^L ticks wide, so the
+   wheel covers TW_SIZE^TW_LEVELS ticks ahead of wheel_time.
+   Level 0 slots hold events due on exactly one tick; events in
+   higher slots are cascaded one level down whenever the level
+   below wraps around.  Insert and cancel are O(1), and every
+   event due on a tick is fired in one pass over its slot. */
+#define TW_BITS 6
+#define TW_SIZE (1 << TW_BITS)
+#define TW_MASK (TW_SIZE - 1)
+#define TW_LEVELS 4
+#define TW_RANGE (1LL << (TW_BITS * TW_LEVELS))
+
+static struct list wheel[TW_LEVELS][TW_SIZE];
+
+/* Next tick to be processed by the wheel.  Every event with a
+   deadline before this tick has already fired. */
+static int64_t wheel_time;
+
+static void wheel_insert (struct timer_event *);
+static void wheel_advance (void);
+static int64_t wheel_next_deadline (void);
+
+/* 8254 input frequency, and the counter value that yields one
+   interrupt every timer tick. */
+#define PIT_HZ 1193180
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Tickless idle.  If true, the idle thread reprograms the PIT in
+   one-shot mode up to the next timer event instead of taking an
+   interrupt every tick.  Controlled by kernel command-line option
+   "-tickless". */
+bool timer_tickless;
+
+static int64_t oneshot_ticks;   /* Ticks covered by the armed one-shot,
+                                   or 0 while the PIT is periodic. */
+static unsigned oneshot_phase;  /* PIT counts of the current tick that
+                                   had elapsed when it was armed. */
+static unsigned oneshot_count;  /* Count loaded for the one-shot. */
+static int64_t suppressed_ticks;
+static bool idle_catchup;       /* Timer softirq raised only to catch
+                                   the wheel up, without a tick. */
+
+static void pit_periodic (void);
+static void pit_oneshot (unsigned count);
+static unsigned pit_read (bool *expired);
+
+/* Nanoseconds per timer tick. */
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+
+/* High-resolution timers.
+
+   Pending hrtimers are kept in a heap, earliest deadline on top,
+   and a one-shot interrupt is programmed for the earliest.  With
+   a local APIC, that is the bootstrap processor's APIC timer,
+   in TSC-deadline mode if the CPU has it; other CPUs that need
+   it armed earlier send it an IPI.  Without one, the 8254
+   itself is switched to one-shot mode to split the current tick
+   at the deadline and then at the tick boundary, where it goes
+   back to periodic mode; deadlines in later ticks are armed
+   once their tick has begun.  Every tick also fires whatever is
+   due, so a lost interrupt only costs precision. */
+enum hr_backend {
+	HR_PIT,                     /* 8254 one-shot within a tick. */
+	HR_LAPIC,                   /* Local APIC one-shot. */
+	HR_TSC_DEADLINE,            /* Local APIC TSC-deadline. */
+};
+
+static const char *hr_backend_names[] = {
+	"8254 one-shot", "APIC one-shot", "TSC deadline",
+};
+
+static enum hr_backend hr_backend;
+static struct heap hr_timers;       /* Pending hrtimers. */
+static uint64_t tsc_base;           /* TSC when timer_ns() was 0. */
+static long long hr_fired;          /* Hrtimers fired so far. */
+
+static bool hr_pit_oneshot;         /* 8254 splitting the current tick? */
+static unsigned hr_pit_left;        /* 8254 counts from the one-shot's
+                                       expiry to the tick boundary. */
+
+static bool hrtimer_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static void hr_run (void);
+static void hr_program (void);
+static void hr_pit_arm (void);
+static void hr_pit_segment (unsigned left);
+static unsigned hr_pit_counts (unsigned limit);
+static void hr_sleep (uint64_t ns);
+static timer_func hr_sleep_wakeup;
+static uint64_t cycles_to_ns (uint64_t cycles);
+static uint64_t ns_to_cycles (uint64_t ns);
+
 static intr_handler_func timer_interrupt;
+static softirq_func timer_softirq;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);\
+static void timer_fire (const void *timer, timer_func *, void *aux);
+static void timer_wait_running (const void *timer);
 // static int64_t global_ticks = 0 ;
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
@@ -37,21 +151,26 @@ static void real_time_sleep (int64_t num, int32_t denom);\
    corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	spin_init (&timer_lock);
+	pit_periodic ();
 
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	for (int level = 0; level < TW_LEVELS; level++)
+		for (int slot = 0; slot < TW_SIZE; slot++)
+			list_init (&wheel[level][slot]);
+	wheel_time = 0;
+
+	heap_init (&hr_timers, hrtimer_less, NULL);
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+	softirq_register (SOFTIRQ_TIMER, timer_softirq, "timer");
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
 void
 timer_calibrate (void) {
 	unsigned high_bit, test_bit;
+	int64_t start;
+	uint64_t tsc;
 
 	ASSERT (intr_get_level () == INTR_ON);
 	printf ("Calibrating timer...  ");
@@ -71,6 +190,72 @@ timer_calibrate (void) {
 			loops_per_tick |= test_bit;
 
 	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+	/* Count time-stamp counter cycles across one whole tick. */
+	start = timer_ticks ();
+	while (timer_ticks () == start)
+		continue;
+	tsc = rdtsc ();
+	while (timer_ticks () == start + 1)
+		continue;
+	cycles_per_tick = rdtsc () - tsc;
+	tsc_base = tsc;
+}
+
+/* Switches high-resolution timers to the local APIC, which must
+   have been calibrated by lapic_timer_calibrate().  Called on the
+   bootstrap processor, with interrupts on. */
+void
+timer_hr_use_lapic (void) {
+	enum intr_level old_level = intr_disable ();
+
+	/* Let the 8254 finish splitting the current tick. */
+	spin_lock (&timer_lock);
+	hr_backend = lapic_hrtimer_start () ? HR_TSC_DEADLINE : HR_LAPIC;
+	hr_program ();
+	spin_unlock (&timer_lock);
+	intr_set_level (old_level);
+}
+
+/* Converts CYCLES of the time-stamp counter to microseconds.
+   Returns 0 before timer_calibrate(). */
+uint64_t
+timer_cycles_to_us (uint64_t cycles) {
+	if (cycles_per_tick == 0)
+		return 0;
+	return cycles * (1000 * 1000 / TIMER_FREQ) / cycles_per_tick;
+}
+
+/* Converts TICKS timer ticks to cycles of the time-stamp counter.
+   Returns 0 before timer_calibrate(). */
+uint64_t
+timer_ticks_to_cycles (int64_t ticks) {
+	ASSERT (ticks >= 0);
+	return ticks * cycles_per_tick;
+}
+
+/* Returns the nanoseconds elapsed since timer_calibrate(), as
+   measured by the time-stamp counter, or 0 before it. */
+uint64_t
+timer_ns (void) {
+	if (cycles_per_tick == 0)
+		return 0;
+	return cycles_to_ns (rdtsc () - tsc_base);
+}
+
+/* Converts CYCLES of the time-stamp counter to nanoseconds,
+   without overflowing for any length of uptime. */
+static uint64_t
+cycles_to_ns (uint64_t cycles) {
+	return cycles / cycles_per_tick * NS_PER_TICK
+		+ cycles % cycles_per_tick * NS_PER_TICK / cycles_per_tick;
+}
+
+/* Converts NS nanoseconds to cycles of the time-stamp counter. */
+static uint64_t
+ns_to_cycles (uint64_t ns) {
+	return ns / NS_PER_TICK * cycles_per_tick
+		+ ns % NS_PER_TICK * cycles_per_tick / NS_PER_TICK;
 }
 
 /*OS가 부팅된 이후로 경과한 타이머 틱(tick) 수를 반환합니다. */
@@ -79,11 +264,7 @@ timer_calibrate (void) {
  이 값은 시스템이 부팅된 이후의 경과 시간을 추적하는 데 사용될 수 있습니다.*/
 int64_t
 timer_ticks (void) {
-	enum intr_level old_level = intr_disable ();
-	int64_t t = ticks;
-	intr_set_level (old_level);
-	barrier ();
-	return t;
+	return __atomic_load_n (&ticks, __ATOMIC_RELAXED);
 }
 
 /* timer_ticks() 함수는 THEN 이후로 경과한 타이머 틱(tick)의 수를 반환합니다. 여기서 THEN은 이전에 timer_ticks() 함수를 호출하여 얻은 값입니다.*/
@@ -125,10 +306,540 @@ timer_nsleep (int64_t ns) {
 void
 timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	if (hr_fired > 0)
+		printf ("Timer: %lld high-resolution timers fired by %s\n",
+				hr_fired, hr_backend_names[hr_backend]);
+}
+
+/* Returns the number of timer interrupts that tickless idle
+   has avoided so far. */
+int64_t
+timer_suppressed_ticks (void) {
+	return suppressed_ticks;
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  In tickless mode, switches the PIT to a single
+   interrupt at the next timer event's deadline, so that the CPU
+   sleeps through the ticks in between.  Only the bootstrap
+   processor takes the 8254's interrupt. */
+void
+timer_idle_enter (void) {
+	bool expired;
+	unsigned remaining, max_ticks;
+	int64_t delta;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_tickless || this_cpu () != &cpus[0])
+		return;
+
+	spin_lock (&timer_lock);
+	if (oneshot_ticks != 0)
+		goto done;
+
+	/* Sub-tick hrtimers keep the 8254 busy. */
+	if (hr_backend == HR_PIT && !heap_empty (&hr_timers))
+		goto done;
+
+	delta = wheel_next_deadline () - ticks;
+	if (delta <= 1)
+		goto done;
+
+	/* The one-shot counts the rest of the current tick plus
+	   DELTA - 1 whole ticks, limited by the 16-bit counter. */
+	remaining = pit_read (&expired);
+	if (remaining == 0 || remaining > PIT_TICK_COUNT)
+		goto done;
+	max_ticks = (0xffff - remaining) / PIT_TICK_COUNT + 1;
+	if (delta > max_ticks)
+		delta = max_ticks;
+	if (delta <= 1)
+		goto done;
+
+	oneshot_ticks = delta;
+	oneshot_phase = PIT_TICK_COUNT - remaining;
+	oneshot_count = remaining + (delta - 1) * PIT_TICK_COUNT;
+	pit_oneshot (oneshot_count);
+done:
+	spin_unlock (&timer_lock);
+}
+
+/* Called on entry to every external interrupt.  If the PIT was
+   left in one-shot mode by timer_idle_enter(), catches `ticks'
+   up with the time spent halted and resumes periodic ticks.
+   Events that came due in the meantime are left to the timer
+   softirq, which is raised here if no timer interrupt will. */
+void
+timer_idle_exit (void) {
+	bool expired;
+	unsigned remaining;
+	int64_t elapsed;
+
+	ASSERT (intr_context ());
+
+	/* A racy peek, to keep the common case off timer_lock. */
+	if (oneshot_ticks == 0)
+		return;
+
+	spin_lock (&timer_lock);
+	if (oneshot_ticks == 0) {
+		spin_unlock (&timer_lock);
+		return;
+	}
+	remaining = pit_read (&expired);
+	if (expired)
+		/* The one-shot's own interrupt is being delivered (or is
+		   pending) and accounts for the last tick itself. */
+		elapsed = oneshot_ticks - 1;
+	else {
+		/* Woken early by another device.  The partial tick is
+		   dropped. */
+		elapsed = (oneshot_phase + oneshot_count - remaining) / PIT_TICK_COUNT;
+		idle_catchup = elapsed > 0;
+	}
+
+	oneshot_ticks = 0;
+	pit_periodic ();
+
+	ticks += elapsed;
+	suppressed_ticks += elapsed;
+	spin_unlock (&timer_lock);
+	if (!expired && elapsed > 0)
+		softirq_raise (SOFTIRQ_TIMER);
+}
+
+/* Initializes timer event EV to call FUNC (AUX) when it fires. */
+void
+timer_event_init (struct timer_event *ev, timer_func *func, void *aux) {
+	ASSERT (ev != NULL);
+	ASSERT (func != NULL);
+
+	ev->func = func;
+	ev->aux = aux;
+	ev->deadline = 0;
+	ev->pending = false;
+}
+
+/* Arms EV to fire on the first timer tick at or after DEADLINE.
+   If EV is already pending it is rescheduled.  A deadline that
+   has already passed fires on the next tick.
+
+   This function may be called from an interrupt handler,
+   including from another timer event's callback. */
+void
+timer_event_add (struct timer_event *ev, int64_t deadline) {
+	enum intr_level old_level = intr_disable ();
+
+	spin_lock (&timer_lock);
+	if (ev->pending)
+		list_remove (&ev->elem);
+	ev->deadline = deadline;
+	ev->pending = true;
+	wheel_insert (ev);
+	spin_unlock (&timer_lock);
+
+	intr_set_level (old_level);
+}
+
+/* Disarms EV.  Returns true if EV was pending, false if it had
+   already fired or was never armed.  If EV's callback is running
+   on another CPU, waits for it to return, so that EV may be
+   freed afterward; the caller must not hold any lock that the
+   callback takes. */
+bool
+timer_event_cancel (struct timer_event *ev) {
+	enum intr_level old_level = intr_disable ();
+	bool was_pending;
+
+	spin_lock (&timer_lock);
+	was_pending = ev->pending;
+	do {
+		/* The callback may have armed EV again. */
+		if (ev->pending) {
+			list_remove (&ev->elem);
+			ev->pending = false;
+		}
+		timer_wait_running (ev);
+	} while (ev->pending);
+	spin_unlock (&timer_lock);
+
+	intr_set_level (old_level);
+	return was_pending;
+}
+
+/* Initializes hrtimer T to call FUNC (AUX) when it fires. */
+void
+hrtimer_init (struct hrtimer *t, timer_func *func, void *aux) {
+	ASSERT (t != NULL);
+	ASSERT (func != NULL);
+
+	t->func = func;
+	t->aux = aux;
+	t->deadline = 0;
+	t->pending = false;
+}
+
+/* Arms T to fire as soon as timer_ns() reaches DEADLINE.  If T is
+   already pending it is rescheduled.  A deadline that has
+   already passed fires at once.  Must be called after
+   timer_calibrate().
+
+   This function may be called from an interrupt handler,
+   including from another timer's callback. */
+void
+hrtimer_add (struct hrtimer *t, uint64_t deadline) {
+	enum intr_level old_level = intr_disable ();
+
+	ASSERT (cycles_per_tick != 0);
+
+	spin_lock (&timer_lock);
+	if (t->pending)
+		heap_remove (&hr_timers, &t->elem);
+	t->deadline = deadline;
+	t->pending = true;
+	heap_push (&hr_timers, &t->elem);
+	if (heap_max (&hr_timers) == &t->elem)
+		hr_program ();
+	spin_unlock (&timer_lock);
+
+	intr_set_level (old_level);
+}
+
+/* Disarms T.  Returns true if T was pending, false if it had
+   already fired or was never armed.  An interrupt already
+   programmed for T finds nothing to do.  Like
+   timer_event_cancel(), waits for T's callback if it is running
+   on another CPU. */
+bool
+hrtimer_cancel (struct hrtimer *t) {
+	enum intr_level old_level = intr_disable ();
+	bool was_pending;
+
+	spin_lock (&timer_lock);
+	was_pending = t->pending;
+	do {
+		if (t->pending) {
+			heap_remove (&hr_timers, &t->elem);
+			t->pending = false;
+		}
+		timer_wait_running (t);
+	} while (t->pending);
+	spin_unlock (&timer_lock);
+
+	intr_set_level (old_level);
+	return was_pending;
+}
+
+/* Handles the local APIC's high-resolution timer interrupt, or
+   another CPU's request to rearm it. */
+void
+timer_hr_interrupt (void) {
+	spin_lock (&timer_lock);
+	hr_run ();
+	hr_program ();
+	spin_unlock (&timer_lock);
 }
-
-/* Timer interrupt handler. */
 
+/* Calls FUNC (AUX), the callback of TIMER, which has just been
+   taken off the pending timers.  timer_lock must be held; it is
+   released for the call. */
+static void
+timer_fire (const void *timer, timer_func *func, void *aux) {
+	int id = this_cpu ()->id;
+
+	ASSERT (spin_held (&timer_lock));
+
+	timer_running[id] = timer;
+	spin_unlock (&timer_lock);
+	func (aux);
+	spin_lock (&timer_lock);
+	timer_running[id] = NULL;
+}
+
+/* Waits until no other CPU is running TIMER's callback.
+   timer_lock must be held; it is released while waiting.  A
+   callback that cancels its own timer does not wait for
+   itself. */
+static void
+timer_wait_running (const void *timer) {
+	int self = this_cpu ()->id;
+
+	ASSERT (spin_held (&timer_lock));
+
+	for (int i = 0; i < cpu_cnt; i++)
+		while (i != self && timer_running[i] == timer) {
+			spin_unlock (&timer_lock);
+			asm volatile ("pause");
+			spin_lock (&timer_lock);
+		}
+}
+
+/* Returns true if the hrtimer with elem A is due after the one
+   with elem B, so that the heap's greatest is the earliest. */
+static bool
+hrtimer_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct hrtimer, elem)->deadline
+		> heap_entry (b, struct hrtimer, elem)->deadline;
+}
+
+/* Fires every hrtimer that is due.  timer_lock must be held. */
+static void
+hr_run (void) {
+	uint64_t now = timer_ns ();
+
+	ASSERT (spin_held (&timer_lock));
+
+	while (!heap_empty (&hr_timers)) {
+		struct hrtimer *t = heap_entry (heap_max (&hr_timers),
+				struct hrtimer, elem);
+
+		if (t->deadline > now)
+			break;
+		heap_pop (&hr_timers);
+		t->pending = false;
+		hr_fired++;
+		timer_fire (t, t->func, t->aux);
+	}
+}
+
+/* Programs the interrupt for the earliest pending hrtimer.
+   timer_lock must be held. */
+static void
+hr_program (void) {
+	struct hrtimer *t;
+
+	ASSERT (spin_held (&timer_lock));
+
+	if (heap_empty (&hr_timers))
+		return;
+	if (hr_backend == HR_PIT) {
+		hr_pit_arm ();
+		return;
+	}
+
+	t = heap_entry (heap_max (&hr_timers), struct hrtimer, elem);
+	if (this_cpu () == &cpus[0])
+		lapic_hrtimer_arm (tsc_base + ns_to_cycles (t->deadline));
+	else
+		lapic_send_ipi (cpus[0].lapic_id, LAPIC_HRTIMER_VEC);
+}
+
+/* Splits the current tick with an 8254 one-shot at the earliest
+   hrtimer's deadline, if that falls before the next tick and
+   before any split already armed. */
+static void
+hr_pit_arm (void) {
+	unsigned remaining, left, counts;
+	bool expired;
+
+	ASSERT (spin_held (&timer_lock));
+
+	/* Tickless idle owns the 8254 until the next interrupt. */
+	if (oneshot_ticks != 0)
+		return;
+
+	remaining = pit_read (&expired);
+	if (hr_pit_oneshot) {
+		/* An expired one-shot rearms from its interrupt. */
+		if (expired)
+			return;
+		left = remaining + hr_pit_left;
+	} else {
+		if (remaining == 0 || remaining > PIT_TICK_COUNT)
+			return;
+		left = remaining;
+	}
+
+	counts = hr_pit_counts (left);
+	if (counts >= (hr_pit_oneshot ? remaining : left))
+		return;
+	hr_pit_oneshot = true;
+	hr_pit_left = left - counts;
+	pit_oneshot (counts);
+}
+
+/* Arms the next 8254 one-shot of a split tick, which has LEFT
+   counts to go: up to the earliest hrtimer's deadline or to the
+   end of the tick, whichever is first. */
+static void
+hr_pit_segment (unsigned left) {
+	unsigned counts = heap_empty (&hr_timers) ? left : hr_pit_counts (left);
+
+	ASSERT (left > 0);
+
+	hr_pit_oneshot = true;
+	hr_pit_left = left - counts;
+	pit_oneshot (counts);
+}
+
+/* Returns the 8254 counts until the earliest hrtimer is due,
+   rounded up, at least 1 and at most LIMIT. */
+static unsigned
+hr_pit_counts (unsigned limit) {
+	struct hrtimer *t = heap_entry (heap_max (&hr_timers), struct hrtimer, elem);
+	uint64_t now = timer_ns ();
+	uint64_t ns = t->deadline > now ? t->deadline - now : 0;
+	uint64_t counts;
+
+	if (ns >= NS_PER_TICK)
+		return limit;
+	counts = DIV_ROUND_UP (ns * PIT_HZ, 1000000000);
+	if (counts == 0)
+		counts = 1;
+	return counts < limit ? counts : limit;
+}
+
+/* Returns the earliest deadline among pending timer events, or
+   INT64_MAX if there is none.  timer_lock must be held.
+
+   Slots after the current one at each level are in increasing
+   time order, so only the first non-empty one needs to be
+   examined, plus the current slot, which may hold events that
+   were parked a full revolution ahead. */
+static int64_t
+wheel_next_deadline (void) {
+	int64_t next = INT64_MAX;
+
+	ASSERT (spin_held (&timer_lock));
+
+	for (int level = 0; level < TW_LEVELS; level++) {
+		int cur = (wheel_time >> (TW_BITS * level)) & TW_MASK;
+
+		for (int i = 0; i < TW_SIZE; i++) {
+			struct list *slot = &wheel[level][(cur + i) & TW_MASK];
+			struct list_elem *e;
+
+			if (list_empty (slot))
+				continue;
+			for (e = list_begin (slot); e != list_end (slot); e = list_next (e)) {
+				int64_t deadline = list_entry (e, struct timer_event, elem)->deadline;
+				if (deadline < next)
+					next = deadline;
+			}
+			if (i > 0)
+				break;
+		}
+	}
+	return next < wheel_time ? wheel_time : next;
+}
+
+/* Puts EV into the wheel slot matching its deadline relative to
+   wheel_time.  timer_lock must be held. */
+static void
+wheel_insert (struct timer_event *ev) {
+	int64_t deadline = ev->deadline;
+	int64_t delta = deadline - wheel_time;
+	int level;
+
+	ASSERT (spin_held (&timer_lock));
+
+	if (delta < 0)
+		deadline = wheel_time;
+	else if (delta >= TW_RANGE)
+		/* Park it in the farthest slot; it is re-inserted with its
+		   real deadline when that slot cascades. */
+		deadline = wheel_time + TW_RANGE - 1;
+
+	delta = deadline - wheel_time;
+	for (level = 0; level < TW_LEVELS - 1; level++)
+		if (delta < 1LL << (TW_BITS * (level + 1)))
+			break;
+
+	list_push_back (&wheel[level][(deadline >> (TW_BITS * level)) & TW_MASK],
+			&ev->elem);
+}
+
+/* Moves every event in slot INDEX of LEVEL down to the lower
+   levels.  Returns INDEX, so that the caller knows whether this
+   level wrapped around as well. */
+static int
+wheel_cascade (int level, int index) {
+	struct list moved;
+	struct list *slot = &wheel[level][index];
+
+	list_init (&moved);
+	if (!list_empty (slot))
+		list_splice (list_end (&moved), list_begin (slot), list_end (slot));
+	while (!list_empty (&moved))
+		wheel_insert (list_entry (list_pop_front (&moved),
+					struct timer_event, elem));
+	return index;
+}
+
+/* Processes tick wheel_time: cascades higher levels if level 0
+   wrapped, then fires every event in the current level-0 slot.
+   timer_lock must be held.  Another CPU may process the next
+   tick while this one runs callbacks. */
+static void
+wheel_advance (void) {
+	int index = wheel_time & TW_MASK;
+	struct list expired;
+	struct list *slot;
+
+	ASSERT (spin_held (&timer_lock));
+
+	if (index == 0)
+		for (int level = 1; level < TW_LEVELS; level++)
+			if (wheel_cascade (level,
+						(wheel_time >> (TW_BITS * level)) & TW_MASK) != 0)
+				break;
+
+	/* Detach the whole slot first, so that callbacks that re-arm
+	   themselves land in a later slot instead of this one.  Events
+	   still on EXPIRED may be cancelled while a callback runs,
+	   which is safe because the list is only touched under
+	   timer_lock. */
+	slot = &wheel[0][index];
+	list_init (&expired);
+	if (!list_empty (slot))
+		list_splice (list_end (&expired), list_begin (slot), list_end (slot));
+	wheel_time++;
+
+	while (!list_empty (&expired)) {
+		struct timer_event *ev = list_entry (list_pop_front (&expired),
+				struct timer_event, elem);
+		ev->pending = false;
+		timer_fire (ev, ev->func, ev->aux);
+	}
+}
+
+/* Programs PIT counter 0 to interrupt every timer tick. */
+static void
+pit_periodic (void) {
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, PIT_TICK_COUNT & 0xff);
+	outb (0x40, PIT_TICK_COUNT >> 8);
+}
+
+/* Programs PIT counter 0 to interrupt once, COUNT input clocks
+   from now. */
+static void
+pit_oneshot (unsigned count) {
+	ASSERT (count > 0 && count <= 0xffff);
+
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Returns the current value of PIT counter 0.  Sets *EXPIRED to
+   whether its output is high, which in one-shot mode means the
+   count has already run out. */
+static unsigned
+pit_read (bool *expired) {
+	uint8_t status, lo, hi;
+
+	/* Read-back command: latch status and count of counter 0. */
+	outb (0x43, 0xc2);
+	status = inb (0x40);
+	lo = inb (0x40);
+	hi = inb (0x40);
+
+	*expired = (status & 0x80) != 0;
+	return lo | (hi << 8);
+}
 
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
@@ -182,22 +893,68 @@ real_time_sleep (int64_t num, int32_t denom) {
 		   timer_sleep() because it will yield the CPU to other
 		   processes. */
 		timer_sleep (ticks);
+	} else if (cycles_per_tick != 0) {
+		/* Otherwise, block on an hrtimer, which wakes us up
+		   part way through the tick. */
+		ASSERT (1000000000 % denom == 0);
+		hr_sleep (num * (1000000000 / denom));
 	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
+		/* Before calibration there is no clock to set an hrtimer
+		   by, so busy-wait.  We scale the numerator and
+		   denominator down by 1000 to avoid the possibility of
+		   overflow. */
 		ASSERT (denom % 1000 == 0);
 		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
 	}
 }
 
+/* Blocks the running thread for NS nanoseconds. */
+static void
+hr_sleep (uint64_t ns) {
+	struct semaphore done;
+	struct hrtimer timer;
+
+	if (ns == 0)
+		return;
+	sema_init (&done, 0);
+	hrtimer_init (&timer, hr_sleep_wakeup, &done);
+	hrtimer_add (&timer, timer_ns () + ns);
+	sema_down (&done);
+}
+
+/* Wakes up the thread in hr_sleep() that waits on semaphore
+   DONE. */
+static void
+hr_sleep_wakeup (void *done) {
+	sema_up (done);
+}
+
 /*타이머 인터럽트가 발생했을 때  호출되는 함수이다. 운영체제의 스케줄링과 관련된 작업을 수행한다.*/
 static void timer_interrupt (struct intr_frame *args UNUSED)
 {
+	spin_lock (&timer_lock);
+	if (hr_pit_oneshot) {
+		unsigned left = hr_pit_left;
+
+		hr_pit_oneshot = false;
+		hr_pit_left = 0;
+		if (left > 0) {
+			/* Part way through a split tick: fire what is due and
+			   arm the rest of the tick. */
+			hr_run ();
+			hr_pit_segment (left);
+			spin_unlock (&timer_lock);
+			return;
+		}
+		pit_periodic ();
+	}
+
 	ticks++;
-	thread_tick ();
-	while (global_tick <= ticks)
-		thread_wakeup();
+	idle_catchup = false;
+	if (hr_backend == HR_PIT)
+		hr_pit_arm ();
+	spin_unlock (&timer_lock);
+	softirq_raise (SOFTIRQ_TIMER);
 	// if (thread_mlfqs == true)
 	// {
 	// 	thread_current()->recent_cpu += (1 << 14);
@@ -214,4 +971,35 @@ static void timer_interrupt (struct intr_frame *args UNUSED)
 	// }	
 
 }
+
+/* Timer softirq, raised by every tick on every CPU: does the
+   scheduler's per-tick work, then fires the timer events that
+   have come due, letting interrupts in between wheel slots.
+   When timer_idle_exit() raised it only to catch up after
+   tickless idle, there is no tick to account. */
+static void
+timer_softirq (void) {
+	enum intr_level old_level = intr_disable ();
+	bool tick = true;
+
+	if (this_cpu () == &cpus[0]) {
+		spin_lock (&timer_lock);
+		tick = !idle_catchup;
+		idle_catchup = false;
+		spin_unlock (&timer_lock);
+	}
+	if (tick)
+		thread_tick ();
+	spin_lock (&timer_lock);
+	hr_run ();
+	while (wheel_time <= ticks) {
+		wheel_advance ();
+		spin_unlock (&timer_lock);
+		intr_set_level (old_level);
+		old_level = intr_disable ();
+		spin_lock (&timer_lock);
+	}
+	spin_unlock (&timer_lock);
+	intr_set_level (old_level);
+}
    
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <string.h>
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* VGA text screen support.  See [FREEVGA] for more information. */
@@ -25,6 +26,9 @@ static size_t cx, cy;
    The attribute at (x,y) is fb[y][x][1]. */
 static uint8_t (*fb)[COL_CNT][2];
 
+/* Protects the cursor and the framebuffer from other CPUs. */
+static struct spinlock vga_lock;
+
 static void clear_row (size_t y);
 static void cls (void);
 static void newline (void);
@@ -51,6 +55,7 @@ vga_putc (int c) {
 	   that might write to the console. */
 	enum intr_level old_level = intr_disable ();
 
+	spin_lock (&vga_lock);
 	init ();
 
 	switch (c) {
@@ -88,6 +93,7 @@ vga_putc (int c) {
 	/* Update cursor position. */
 	move_cursor ();
 
+	spin_unlock (&vga_lock);
 	intr_set_level (old_level);
 }
 
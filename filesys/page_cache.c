@@ -1,9 +1,11 @@
 /* page_cache.c: Implementation of Page Cache (Buffer Cache). */
 
 #include "vm/vm.h"
+#include "threads/workpool.h"
 static bool page_cache_readahead (struct page *page, void *kva);
 static bool page_cache_writeback (struct page *page);
 static void page_cache_destroy (struct page *page);
+static void page_cache_kworkerd (void *aux);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations page_cache_op = {
@@ -13,12 +15,14 @@ static const struct page_operations page_cache_op = {
 	.type = VM_PAGE_CACHE,
 };
 
-tid_t page_cache_workerd;
+/* Page cache work, run by the kernel worker pool. */
+static struct work page_cache_work;
 
 /* The initializer of file vm */
 void
 pagecache_init (void) {
-	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
+	work_init (&page_cache_work, page_cache_kworkerd, NULL);
+	work_submit (&page_cache_work);
 }
 
 /* Initialize the page cache */
@@ -44,7 +48,9 @@ static void
 page_cache_destroy (struct page *page) {
 }
 
-/* Worker thread for page cache */
+/* Page cache work.  Runs on a pool worker, so it should return
+   once it is done and submit page_cache_work again to run
+   later, rather than loop forever. */
 static void
 page_cache_kworkerd (void *aux) {
 }
@@ -9,7 +9,8 @@
 
    Interrupt queue functions can be called from kernel threads or
    from external interrupt handlers.  Except for intq_init(),
-   interrupts must be off in either case.
+   interrupts must be off in either case.  Each call is atomic
+   with respect to other CPUs, but a sequence of calls is not.
 
    The interrupt queue has the structure of a "monitor".  Locks
    and condition variables from threads/synch.h cannot be used in
@@ -26,6 +27,7 @@ struct intq {
 	struct lock lock;           /* Only one thread may wait at once. */
 	struct thread *not_full;    /* Thread waiting for not-full condition. */
 	struct thread *not_empty;   /* Thread waiting for not-empty condition. */
+	struct spinlock spin;       /* Protects the waiters and the queue. */
 
 	/* Queue. */
 	uint8_t buf[INTQ_BUFSIZE];  /* Buffer. */
@@ -34,8 +36,8 @@ struct intq {
 };
 
 void intq_init (struct intq *);
-bool intq_empty (const struct intq *);
-bool intq_full (const struct intq *);
+bool intq_empty (struct intq *);
+bool intq_full (struct intq *);
 uint8_t intq_getc (struct intq *);
 void intq_putc (struct intq *, uint8_t);
 
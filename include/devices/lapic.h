@@ -0,0 +1,25 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt vectors delivered by the local APIC.  They sit above
+   the PIC's 0x20...0x2f and are handled as external interrupts. */
+#define LAPIC_TIMER_VEC 0xf0            /* Per-CPU scheduler tick. */
+#define LAPIC_RESCHED_VEC 0xf1          /* Reschedule IPI. */
+#define LAPIC_HRTIMER_VEC 0xf2          /* High-resolution timer. */
+#define LAPIC_SPURIOUS_VEC 0xff         /* Spurious interrupt. */
+
+void lapic_map (uint64_t base);
+void lapic_init (bool bsp);
+uint8_t lapic_id (void);
+void lapic_eoi (void);
+void lapic_send_ipi (uint8_t apic_id, uint8_t vec);
+void lapic_start_ap (uint8_t apic_id, uint64_t start_pa);
+void lapic_timer_calibrate (void);
+void lapic_timer_start (void);
+bool lapic_hrtimer_start (void);
+void lapic_hrtimer_arm (uint64_t deadline);
+
+#endif /* devices/lapic.h */
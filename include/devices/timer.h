@@ -1,7 +1,10 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <heap.h>
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -18,6 +21,51 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+uint64_t timer_cycles_to_us (uint64_t cycles);
+uint64_t timer_ticks_to_cycles (int64_t ticks);
+uint64_t timer_ns (void);
+
 void timer_print_stats (void);
 
+/* Tickless idle. */
+extern bool timer_tickless;
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+int64_t timer_suppressed_ticks (void);
+
+/* Kernel timer: calls FUNC (AUX) from the timer interrupt once
+   timer_ticks() reaches DEADLINE.  The callback runs in interrupt
+   context, so it must not sleep. */
+typedef void timer_func (void *aux);
+
+struct timer_event {
+	struct list_elem elem;      /* Element in a timer wheel slot. */
+	int64_t deadline;           /* Tick at which to fire. */
+	timer_func *func;           /* Callback. */
+	void *aux;                  /* Callback argument. */
+	bool pending;               /* Armed and not yet fired? */
+};
+
+void timer_event_init (struct timer_event *, timer_func *, void *aux);
+void timer_event_add (struct timer_event *, int64_t deadline);
+bool timer_event_cancel (struct timer_event *);
+
+/* High-resolution timer: like a timer event, but due when
+   timer_ns() reaches DEADLINE, and fired by a one-shot interrupt
+   programmed for that moment instead of on the next tick. */
+struct hrtimer {
+	struct heap_elem elem;      /* Element in the pending heap. */
+	uint64_t deadline;          /* timer_ns() at which to fire. */
+	timer_func *func;           /* Callback. */
+	void *aux;                  /* Callback argument. */
+	bool pending;               /* Armed and not yet fired? */
+};
+
+void hrtimer_init (struct hrtimer *, timer_func *, void *aux);
+void hrtimer_add (struct hrtimer *, uint64_t deadline);
+bool hrtimer_cancel (struct hrtimer *);
+
+void timer_hr_use_lapic (void);
+void timer_hr_interrupt (void);
+
 #endif /* devices/timer.h */
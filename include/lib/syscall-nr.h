@@ -36,6 +36,16 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Futexes, for user-level synchronization. */
+	SYS_FUTEX_WAIT,             /* Sleep if a word holds a value. */
+	SYS_FUTEX_WAKE,             /* Wake threads sleeping on a word. */
+
+	/* Real-time scheduling. */
+	SYS_SET_DEADLINE,           /* Reserve CPU time in each period. */
+
+	/* Process identity. */
+	SYS_GETPID,                 /* Return the caller's process id. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,38 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* Mutex built on futexes.  Locking and unlocking an uncontended
+   mutex never enters the kernel. */
+struct mutex {
+	int state;                  /* MUTEX_* below. */
+};
+
+#define MUTEX_UNLOCKED 0        /* Free. */
+#define MUTEX_LOCKED 1          /* Held, nobody waiting. */
+#define MUTEX_CONTENDED 2       /* Held, maybe with waiters. */
+
+#define MUTEX_INITIALIZER { MUTEX_UNLOCKED }
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* Condition variable built on futexes, for use with a mutex.
+   Signaling a condition variable nobody waits on never enters
+   the kernel. */
+struct condvar {
+	int seq;                    /* Bumped by every signal. */
+	int waiters;                /* Threads in condvar_wait(). */
+};
+
+#define CONDVAR_INITIALIZER { 0, 0 }
+
+void condvar_init (struct condvar *);
+void condvar_wait (struct condvar *, struct mutex *);
+void condvar_signal (struct condvar *);
+void condvar_broadcast (struct condvar *);
+
+#endif /* lib/user/synch.h */
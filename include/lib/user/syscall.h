@@ -50,6 +50,16 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Futexes. */
+int futex_wait (int *addr, int val);
+int futex_wake (int *addr, int n);
+
+/* Real-time scheduling. */
+bool set_deadline (unsigned period_ms, unsigned runtime_ms);
+
+/* Process identity. */
+pid_t getpid (void);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -0,0 +1,86 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <heap.h>
+#include <list.h>
+#include <rbtree.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Maximum number of CPUs that are brought up. */
+#define CPU_MAX 8
+
+/* Pages of dead threads each CPU keeps for new threads. */
+#define THREAD_CACHE_PAGES 8
+
+/* Per-CPU state.
+
+   The run queues, `curr', and the cache of thread pages may be
+   touched by any CPU that holds `rq_lock'.  Everything else
+   except `started' is only touched by the CPU it describes, with
+   interrupts off.  Other CPUs may read the run queue counts and
+   masks without the lock, as hints.  A thread finds its CPU
+   through this_cpu(), which reads the `cpu' member of the running
+   thread, so the data is only stable while the thread cannot be
+   migrated, that is, while interrupts are off. */
+struct cpu {
+	int id;                             /* Index in cpus[]. */
+	uint8_t lapic_id;                   /* Local APIC ID. */
+	volatile bool started;              /* Running the scheduler? */
+	struct thread *idle_thread;         /* Runs when nothing else can. */
+	struct thread *curr;                /* Thread running on this CPU. */
+
+	/* Protects the members below, up to thread_pages[].  A thread
+	   switch holds it from picking the next thread until that
+	   thread runs, so it passes from one thread to the next. */
+	struct spinlock rq_lock;
+	struct thread *prev;                /* Thread switched away from, until then. */
+
+	/* Run queues, one per priority, as in thread.c. */
+	struct list ready_list[PRI_MAX + 1];
+	uint64_t ready_mask;                /* Bit P set iff ready_list[P] nonempty. */
+	int ready_cnt;                      /* Total threads in all run queues. */
+
+	/* With -cfs, the threads that would be in ready_list[]
+	   instead, by virtual run time. */
+	struct rb_tree cfs_ready;           /* Ready threads, least vruntime first. */
+	unsigned long cfs_load;             /* Sum of their weights. */
+	uint64_t cfs_min_vruntime;          /* Never decreases; see cfs_update_min(). */
+
+	/* Earliest-deadline-first threads, which run ahead of the
+	   run queues above. */
+	struct heap edf_ready;              /* Ready EDF threads, earliest deadline on top. */
+	unsigned edf_util;                  /* Sum of their reserved shares. */
+
+	/* Pages of dead threads, reused by thread_create(). */
+	void *thread_pages[THREAD_CACHE_PAGES];
+	int thread_page_cnt;                /* Number of pages in thread_pages[]. */
+
+	unsigned thread_ticks;              /* Timer ticks since last yield. */
+	bool in_external_intr;              /* Processing an external interrupt? */
+	bool yield_on_return;               /* Yield on interrupt return? */
+	bool in_softirq;                    /* Running softirqs? */
+	unsigned softirq_pending;           /* Bit N set if softirq N is raised. */
+	int spin_cnt;                       /* Number of spinlocks held. */
+
+	/* Interrupts-off tracing; see interrupt.c. */
+	uint64_t irqsoff_start;             /* TSC when interrupts went off, or 0. */
+	const void *irqsoff_ip;             /* Where they went off. */
+
+	/* Statistics. */
+	long long idle_ticks;               /* Timer ticks spent idle. */
+	long long kernel_ticks;             /* Timer ticks in kernel threads. */
+	long long user_ticks;               /* Timer ticks in user programs. */
+};
+
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+extern bool smp_active;
+
+void cpu_init (struct cpu *, int id);
+struct cpu *this_cpu (void);
+void smp_init (void);
+
+#endif /* threads/cpu.h */
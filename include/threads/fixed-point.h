@@ -0,0 +1,47 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* 17.14 fixed-point real arithmetic, used by the 4.4BSD
+   scheduler for recent_cpu and load_avg.  See the "Fixed-Point
+   Real Arithmetic" appendix of the Pintos manual.
+
+   A fixed-point number is stored in a plain int whose low
+   FP_SHIFT bits are the fraction.  X and Y are fixed-point
+   numbers, N is an integer. */
+typedef int fixed_t;
+
+#define FP_SHIFT 14
+#define FP_F (1 << FP_SHIFT)
+
+/* Converts integer N to fixed point. */
+static inline fixed_t fp_from_int (int n) { return n * FP_F; }
+
+/* Converts X to an integer, rounding toward zero. */
+static inline int fp_to_int (fixed_t x) { return x / FP_F; }
+
+/* Converts X to an integer, rounding to nearest. */
+static inline int
+fp_round (fixed_t x) {
+	return x >= 0 ? (x + FP_F / 2) / FP_F : (x - FP_F / 2) / FP_F;
+}
+
+static inline fixed_t fp_add (fixed_t x, fixed_t y) { return x + y; }
+static inline fixed_t fp_sub (fixed_t x, fixed_t y) { return x - y; }
+static inline fixed_t fp_add_int (fixed_t x, int n) { return x + n * FP_F; }
+static inline fixed_t fp_sub_int (fixed_t x, int n) { return x - n * FP_F; }
+static inline fixed_t fp_mul_int (fixed_t x, int n) { return x * n; }
+static inline fixed_t fp_div_int (fixed_t x, int n) { return x / n; }
+
+static inline fixed_t
+fp_mul (fixed_t x, fixed_t y) {
+	return ((int64_t) x) * y / FP_F;
+}
+
+static inline fixed_t
+fp_div (fixed_t x, fixed_t y) {
+	return ((int64_t) x) * FP_F / y;
+}
+
+#endif /* threads/fixed-point.h */
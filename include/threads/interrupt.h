@@ -66,11 +66,20 @@ struct intr_frame {
 typedef void intr_handler_func (struct intr_frame *);
 
 void intr_init (void);
+void intr_init_ap (void);
 void intr_register_ext (uint8_t vec, intr_handler_func *, const char *name);
 void intr_register_int (uint8_t vec, int dpl, enum intr_level,
                         intr_handler_func *, const char *name);
 bool intr_context (void);
 void intr_yield_on_return (void);
+void intr_halt (void);
+void intr_trace_end (void);
+void intr_print_stats (void);
+
+/* If true, time every span with interrupts off and report the
+   longest at exit.  Controlled by kernel command-line option
+   "-irqsoff". */
+extern bool intr_tracing;
 
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
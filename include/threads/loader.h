@@ -20,6 +20,11 @@
 #define E820_MAP MULTIBOOT_INFO + 52
 #define E820_MAP4 MULTIBOOT_INFO + 56
 
+/* Physical address to which the application processor startup
+   code in threads/ap-start.S is copied.  Must be page-aligned and
+   below 1 MB, since the startup IPI names it by page number. */
+#define LOADER_AP_START 0x8000
+
 /* Important loader physical addresses. */
 #define LOADER_SIG (LOADER_END - LOADER_SIG_LEN)   /* 0xaa55 BIOS signature. */
 #define LOADER_ARGS (LOADER_SIG - LOADER_ARGS_LEN)     /* Command-line args. */
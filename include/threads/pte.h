@@ -39,7 +39,19 @@
 #define PTE_P 0x1                        /* 1=present, 0=not present. */
 #define PTE_W 0x2                        /* 1=read/write, 0=read-only. */
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
+#define PTE_PWT 0x8                      /* 1=write-through caching. */
+#define PTE_PCD 0x10                     /* 1=caching disabled. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=large page (PDEs only). */
+
+/* Large pages.
+   A page directory entry with PTE_PS set maps a 2 MB "large
+   page" directly, without a page table below it.  Its physical
+   address must be aligned on LPGSIZE. */
+#define LPGSIZE (1UL << PDXSHIFT)        /* Bytes in a large page. */
+#define LPG_PAGES (LPGSIZE / PGSIZE)     /* Small pages in a large page. */
+#define LPTE_ADDR(pde) ((uint64_t) (pde) & ~(LPGSIZE - 1))
+#define lpg_ofs(va) ((uint64_t) (va) & (LPGSIZE - 1))
 
 #endif /* threads/pte.h */
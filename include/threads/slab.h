@@ -0,0 +1,32 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches.
+
+   A cache hands out objects of one type and size, carved out of
+   single pages called "slabs", so that an object that malloc()
+   would round up to the next power of 2 wastes at most the tail
+   of a page.  An optional constructor runs once on each object
+   when its slab is created, not on every allocation.  An object
+   must therefore be freed back in its constructed state, and is
+   handed out again in that state.  See Bonwick, "The Slab
+   Allocator: An Object-Caching Kernel Memory Allocator", USENIX
+   1994. */
+
+/* Constructs the object at OBJ. */
+typedef void kmem_ctor_func (void *obj);
+
+struct kmem_cache;
+
+void kmem_init (void);
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+		size_t align, kmem_ctor_func *);
+void kmem_cache_destroy (struct kmem_cache *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void *kmem_cache_zalloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
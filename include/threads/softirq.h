@@ -0,0 +1,27 @@
+#ifndef THREADS_SOFTIRQ_H
+#define THREADS_SOFTIRQ_H
+
+/* Deferred interrupt work.  An external interrupt handler does
+   only what must be done with interrupts off, such as reading
+   the device, and raises a softirq for the rest.  Raised
+   softirqs run on the same CPU once the interrupt has been
+   acknowledged, with interrupts turned back on. */
+enum softirq {
+	SOFTIRQ_TIMER,              /* Scheduler tick and timer events. */
+	SOFTIRQ_DISK,               /* Disk request completion. */
+	SOFTIRQ_KBD,                /* Keyboard scancode decoding. */
+	SOFTIRQ_SERIAL,             /* Serial port input and output. */
+	SOFTIRQ_CNT                 /* Number of softirqs. */
+};
+
+/* A softirq handler.  It runs in interrupt context with
+   interrupts on, so it may not sleep, but it may turn interrupts
+   off and call intr_yield_on_return(). */
+typedef void softirq_func (void);
+
+void softirq_register (enum softirq, softirq_func *, const char *name);
+void softirq_raise (enum softirq);
+void softirq_run (void);
+void softirq_print_stats (void);
+
+#endif /* threads/softirq.h */
@@ -0,0 +1,37 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+/* Thread switching.
+ *
+ * switch_threads() in switch.S saves only what a function call
+ * must preserve: the callee-saved registers and, implicitly, the
+ * stack pointer and the return address.  Every other register is
+ * dead across the call, the segment registers are the same in
+ * every kernel context, and interrupts are always off, so a
+ * switch between two kernel threads needs no `struct intr_frame'
+ * and no iretq.  do_iret() is only used to enter user mode. */
+
+/* switch_threads()'s frame on a switched-out thread's stack, at
+   the address saved in the thread's `switch_rsp'. */
+struct switch_threads_frame {
+	uint64_t r15;
+	uint64_t r14;
+	uint64_t r13;
+	uint64_t r12;
+	uint64_t rbp;
+	uint64_t rbx;
+	void (*rip) (void);             /* Return address. */
+};
+
+/* Saves the running thread's stack pointer in *CUR_RSP and
+   resumes the thread whose saved stack pointer is NEXT_RSP,
+   returning in that thread's context. */
+void switch_threads (uint64_t *cur_rsp, uint64_t next_rsp);
+
+/* Where a new thread's first switch_threads() returns to.  Calls
+   the function in rbx with arguments r12 and r13. */
+void switch_entry (void);
+
+#endif /* threads/switch.h */
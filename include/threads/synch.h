@@ -1,55 +1,206 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+/* Contention statistics for lock profiling. */
+struct lock_stats {
+	uint64_t acquired;          /* Acquisitions, or waits on a condition. */
+	uint64_t contended;         /* Acquisitions that had to block. */
+	uint64_t wait_time;         /* Total time blocked, in TSC cycles. */
+	uint64_t max_wait_time;     /* Longest time blocked. */
+	uint64_t hold_time;         /* Total time held, for locks. */
+	uint64_t max_hold_time;     /* Longest time held. */
+};
+
+/* The place in the source where semaphores, locks, or condition
+   variables are initialized.  The init functions below are
+   macros that give each call site its own static lock_class.
+   Each object keeps its own statistics, in a struct lockstat of
+   synch.c; the class adds up those of all its objects. */
+struct lock_class {
+	const char *name;           /* Argument of the init call. */
+	const char *file;           /* Source file of the init call. */
+	int line;                   /* Source line of the init call. */
+	bool registered;            /* In the list of profiled classes? */
+	struct lock_class *next;    /* Next profiled class. */
+	struct lock_stats total;    /* Sum over the class's objects. */
+};
+
+#define LOCK_CLASS(NAME) ({                                     \
+		static struct lock_class lock_class_ =                  \
+			{ .name = (NAME), .file = __FILE__, .line = __LINE__ }; \
+		&lock_class_;                                           \
+	})
+
+/* If true, record contention statistics.  Controlled by kernel
+   command-line option "-lockstat". */
+extern bool lock_profiling;
+void lock_print_stats (void);
+
+/* Spinlock, for mutual exclusion between CPUs.  A spinlock never
+   sleeps, so unlike a lock it may be acquired from interrupt
+   handlers, but only with interrupts off, and it must only be
+   held briefly.  Only the scheduler holds one across a context
+   switch; see schedule() in thread.c. */
+struct spinlock {
+	volatile int locked;        /* 1 if held, 0 otherwise. */
+	struct cpu *cpu;            /* CPU holding the lock (debugging). */
+};
+
+void spin_init (struct spinlock *);
+void spin_lock (struct spinlock *);
+bool spin_trylock (struct spinlock *);
+void spin_unlock (struct spinlock *);
+bool spin_held (const struct spinlock *);
+
+/* Wait queue: threads blocked until some other thread wakes
+   them, ordered by effective priority so that the highest is
+   woken first, even if its priority changed while it waited.
+   The waits in semaphores, locks and condition variables are
+   all built on it.
+
+   A wait queue that belongs to a lock also donates the
+   priority of its waiters to the lock's holder.
+
+   SPIN protects the waiters and the state of the object the
+   queue belongs to, such as a semaphore's value or a lock's
+   holder. */
+struct waitqueue {
+	struct spinlock spin;       /* Protects the queue and its owner. */
+	struct heap waiters;        /* Blocked threads, by priority. */
+	struct lock *lock;          /* Lock whose holder they donate to, or NULL. */
+};
+
+/* Serializes priority donation: every thread's held locks, and
+   the waiters of any lock.  Taken before any wait queue's
+   spinlock. */
+extern struct spinlock donation_lock;
+
+/* Deadline for a wait that never times out. */
+#define WAIT_FOREVER INT64_MAX
+
+void waitqueue_init (struct waitqueue *, struct lock *);
+bool waitqueue_wait (struct waitqueue *, int64_t deadline);
+struct thread *waitqueue_wake_one (struct waitqueue *);
+int waitqueue_wake_all (struct waitqueue *);
+bool waitqueue_empty (const struct waitqueue *);
+int waitqueue_max_priority (const struct waitqueue *);
 
 /* semaphore는 스레드 간의 동기화를 달성하기 위해 사용되는 자료 구조입니다.
 
 멤버 변수:
 - value: 현재 semaphore의 값.
-- waiters: 대기 중인 스레드들의 리스트. (list 구조체)*/
+- waiters: 대기 중인 스레드들의 큐. (waitqueue 구조체)*/
 struct semaphore {
 	unsigned value;             
-	struct list waiters;
+	struct waitqueue waiters;
+	struct lock_class *class;   /* Profiling class, or NULL. */
+	struct lockstat *stats;     /* Own statistics, once profiled. */
 };
 
-void sema_init (struct semaphore *, unsigned value);
+#define sema_init(SEMA, VALUE) \
+	sema_init_class (SEMA, VALUE, LOCK_CLASS (#SEMA))
+void sema_init_class (struct semaphore *, unsigned value,
+		struct lock_class *);
 void sema_down (struct semaphore *);
+bool sema_down_timeout (struct semaphore *, int64_t ticks);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
-/* lock은 스레드의 동기화를 제어하는 데 사용되는 자료 구조입니다. */
+/* lock은 스레드의 동기화를 제어하는 데 사용되는 자료 구조입니다.
+
+   Threads waiting for a lock are kept in a max-heap by
+   priority, and every thread keeps the locks it holds in a
+   max-heap by the priority of their highest waiter, so that
+   priority donation and its undoing on release take O(log n)
+   time however many locks and waiters are involved. */
 struct lock {
 	struct thread *holder;      /* Tholder: 락을 소유하고 있는 스레드 (디버깅용). */
-	struct semaphore semaphore; /* semaphore: 접근을 제어하는 이진 세마포어. */
+	struct waitqueue waiters;   /* Waiting threads, by priority. */
+	struct heap_elem elem;      /* Element in holder's held_locks. */
+	struct lock_class *class;   /* Profiling class, or NULL. */
+	struct lockstat *stats;     /* Own statistics, once profiled. */
+	uint64_t acquire_time;      /* TSC when acquired, if profiled. */
 };
 
-void lock_init (struct lock *); //lock 자료구조를 초기화
+#define lock_init(LOCK) lock_init_class (LOCK, LOCK_CLASS (#LOCK))
+void lock_init_class (struct lock *, struct lock_class *); //lock 자료구조를 초기화
 void lock_acquire (struct lock *); //lock을 요청
+bool lock_acquire_timeout (struct lock *, int64_t ticks);
 bool lock_try_acquire (struct lock *); //lock을 반환
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+int lock_donated_priority (const struct lock *);
+bool lock_donation_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
 
 /* condition은 컨디션 변수라는 동기화 프리미티브를 나타냅니다.
 동기화 프리미티브는 여러 프로세스나 스레드 간에 데이터를 안전하게 공유하도록 도와주는 기본적인 도구나 메커니즘을 말합니다.
 */
 struct condition {
-	struct list waiters;        
+	struct waitqueue waiters;   
 	/* 이 필드는 대기 중인 스레드들의 목록을 관리합니다.
 	 컨디션 변수에 대기 중인 모든 스레드들이 이 목록에 포함되며,
 	 스레드가 컨디션 변수를 통해 신호를 받으면 이 목록에서 제거됩니다. */
+	struct lock_class *class;   /* Profiling class, or NULL. */
+	struct lockstat *stats;     /* Own statistics, once profiled. */
 };
 /*이 함수는 컨디션 변수를 초기화합니다. 컨디션 변수가 사용되기 전에 이 함수를 호출해야 합니다*/
-void cond_init (struct condition *);
+#define cond_init(COND) cond_init_class (COND, LOCK_CLASS (#COND))
+void cond_init_class (struct condition *, struct lock_class *);
 /* 이 함수는 주어진 락을 해제하고, 컨디션 변수에 대해 대기하는 스레드를 차단합니다.*/
 void cond_wait (struct condition *, struct lock *);
+bool cond_wait_timeout (struct condition *, struct lock *, int64_t ticks);
 /*이 함수는 대기 중인 스레드 중 하나에게 신호를 보냅니다. 신호를 받은 스레드는 대기 상태에서 벗어나 작업을 계속합니다. */
 void cond_signal (struct condition *, struct lock *);
 /* 이 함수는 모든 대기 중인 스레드에게 신호를 보냅니다. 이를 통해 대기 중인 모든 스레드가 깨어나서 작업을 계속하게 됩니다.*/
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock.  Any number of readers or a single writer
+   may hold it at once.
+
+   Writers serialize on LOCK, which they hold for as long as they
+   hold the rwlock, so a thread that blocks behind a writer
+   donates its priority to the writer through the usual lock
+   donation chain.
+
+   Each reader also holds one of HOLDS while it reads, if one is
+   free.  A writer waiting for the readers to leave acquires
+   their holds one at a time, so it donates its priority to the
+   reader it waits for just as it would to a lock holder.
+   Readers beyond RWLOCK_HOLDS are only counted, and a writer
+   waits for them on DRAINED without donating. */
+#define RWLOCK_HOLDS 4
+
+struct rwlock {
+	struct lock lock;           /* Held by the writer, if any. */
+	struct lock holds[RWLOCK_HOLDS]; /* Held by readers. */
+	struct semaphore drained;   /* Upped when the last reader leaves. */
+	unsigned readers;           /* Number of readers holding the lock. */
+	bool writing;               /* True once the writer has it. */
+	bool draining;              /* Writer waiting on DRAINED? */
+	bool prefer_writers;        /* Readers wait behind waiting writers? */
+};
+
+#define rwlock_init(RW, PREFER_WRITERS) \
+	rwlock_init_class (RW, PREFER_WRITERS, LOCK_CLASS (#RW))
+void rwlock_init_class (struct rwlock *, bool prefer_writers,
+		struct lock_class *);
+void rwlock_acquire_read (struct rwlock *);
+bool rwlock_try_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+bool rwlock_try_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_try_upgrade (struct rwlock *);
+void rwlock_downgrade (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
 
 /* Optimization barrier.
  *
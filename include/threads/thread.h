@@ -2,9 +2,14 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
+#include "threads/fixed-point.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -19,6 +24,8 @@ enum thread_status {
 	THREAD_DYING        /* 스레드의 실행이 완료되거나 예외가 발생하여 스레드가 종료된 상태입니다. 종료된 스레드는 더 이상 실행되지 않습니다. */
 };
 
+struct cpu;
+
 /* 스레드 식별자 유형 */
 typedef int tid_t;
 #define TID_ERROR ((tid_t) -1)          /* Error value for tid_t. */
@@ -28,6 +35,65 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Earliest-deadline-first reservations are admitted while the
+   reserved shares of a CPU, in units of 1/EDF_UTIL_SCALE of the
+   CPU, add up to no more than EDF_UTIL_MAX, which leaves some
+   time for priority-class threads. */
+#define EDF_UTIL_SCALE 1000
+#define EDF_UTIL_MAX 950
+
+/* Thread niceness, for the 4.4BSD and completely fair schedulers. */
+#define NICE_MIN -20                    /* Nicest to others. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice to others. */
+
+/* Buckets in the ready-to-run latency histogram.  Bucket B counts
+   latencies of 2^(B + SCHED_LAT_SHIFT) up to 2^(B + SCHED_LAT_SHIFT
+   + 1) TSC cycles; the first and last buckets are open-ended. */
+#define SCHED_LAT_BUCKETS 16
+#define SCHED_LAT_SHIFT 10
+
+/* Scheduler accounting for one thread.  Times are in TSC cycles,
+   charged whenever the thread changes state. */
+struct sched_stats {
+	uint64_t stamp;                     /* TSC at the last state change. */
+	uint64_t run_time;                  /* Time spent running. */
+	uint64_t ready_time;                /* Time spent ready but not running. */
+	uint64_t blocked_time;              /* Time spent blocked. */
+	int64_t ticks;                      /* Timer ticks charged while running. */
+	unsigned voluntary;                 /* Switches away by blocking or yielding. */
+	unsigned involuntary;               /* Switches away by preemption. */
+	unsigned latency[SCHED_LAT_BUCKETS]; /* Ready-to-run latency histogram. */
+};
+
+/* Earliest-deadline-first scheduling state.  A thread in the EDF
+   class is guaranteed RUNTIME timer ticks of CPU time in every
+   PERIOD ticks, and is throttled once it has used them up. */
+struct edf {
+	int64_t period;                     /* Ticks per period, 0 if not EDF. */
+	int64_t runtime;                    /* Ticks of CPU time per period. */
+	int64_t deadline;                   /* Tick at which the current period ends. */
+	int64_t budget;                     /* Ticks left in the current period. */
+	unsigned util;                      /* Reserved share of the CPU. */
+	bool throttled;                     /* Out of budget until the next period? */
+	struct cpu *cpu;                    /* CPU the reservation is on. */
+	int saved_priority;                 /* Base priority before joining. */
+	struct timer_event timer;           /* Starts the next period. */
+	struct heap_elem elem;              /* Element in the CPU's edf_ready. */
+	unsigned misses;                    /* Periods that ended short of RUNTIME. */
+	unsigned throttles;                 /* Periods that ran out of budget. */
+};
+
+/* Completely fair scheduling state.  VRUNTIME is the TSC cycles
+   the thread has run, scaled by CFS_WEIGHT_0 / WEIGHT, so that a
+   thread's share of the CPU is proportional to its weight. */
+struct cfs {
+	uint64_t vruntime;                  /* Weighted run time. */
+	uint64_t exec_start;                /* TSC when last charged. */
+	unsigned weight;                    /* Load weight, from niceness. */
+	struct rb_elem elem;                /* Element in the CPU's cfs_ready. */
+};
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -95,14 +161,26 @@ struct thread {
 	int priority;                      /* 우선순위(priority) */
 	
 	int64_t wakeup_ticks;				/*local_ticks/wakeup_ticks*/
-	// int recent_cpu;
+	struct timer_event sleep_timer;     /* Wakes the thread from thread_sleep(). */
+	int nice;                           /* Niceness, for the 4.4BSD scheduler. */
+	fixed_t recent_cpu;                 /* Recent CPU use, 17.14 fixed point. */
+	struct list_elem allelem;           /* Element in the list of all threads. */
+	struct cpu *cpu;                    /* CPU running T, or whose run queue T is on. */
+	struct cpu *bound_cpu;              /* Only CPU T may run on, or NULL. */
+	volatile bool on_cpu;               /* Still on a CPU's stack? */
+	struct spinlock wake_lock;          /* Orders waking T against changes to its priority and wait. */
+	struct sched_stats stats;           /* Scheduler accounting. */
+	struct edf edf;                     /* Deadline scheduling state. */
+	struct cfs cfs;                     /* Fair scheduling state. */
 	/* thread.c와 synch.c사이에서 공유되는 멤버 */
 	struct list_elem elem;              /* 리스트 요소 elem 멤버는 thread.c와 synch.c사이에서 공유되는 리스트 요소를 나타낸다.*/
 	/*이 멤버는 리스트에 스레드를 삽입하거나 제거하는 데 사용되며 스레드 관리와 동기화에 필요한 작업을 수행한다.*/
 	int original_priority; /* 초기 우선순위를 저장하기 위한 필드 */
-	struct lock *waiting_lock; /* 해당 스레드가 대기 중인 락의 주소를 저장할 필드 */
-	struct list donations; /*여러 번의 우선순위 기부를 고려하기 위한 리스트*/
-	struct list_elem d_elem; /*해당 리스트를 위한 elem*/
+	struct heap held_locks;             /* Locks held, by donated priority. */
+	struct waitqueue *waitqueue;        /* Queue T is blocked on, if any. */
+	struct heap_elem wait_elem;         /* Element in waitqueue. */
+	struct timer_event wait_timer;      /* Ends a wait with a deadline. */
+	bool wait_timed_out;                /* Did the last wait time out? */
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
 	uint64_t *pml4;                     /* Page map level 4 */
@@ -113,7 +191,8 @@ struct thread {
 #endif
 
 	/* Owned by thread.c. */
-	struct intr_frame tf;               /* 스위칭에 필요한 정보를 담고 있는 구조체 */
+	uint64_t switch_rsp;                /* Saved stack pointer while switched out. */
+	struct intr_frame tf;               /* Unused by switching; see switch_rsp. */
 	unsigned magic;                     /* 스택 오버프로우를 감지하기 위한 값 */
 };
 
@@ -128,17 +207,18 @@ struct thread {
  우선순위에 따라 다른 큐에서 작업을 선택합니다.
  이는 작업의 특성에 따라 우선순위를 조정하여 성능을 향상시키는데 도움이 됩니다.*/
 extern bool thread_mlfqs;
-/*thread_mlfqs라는 외부 변수(extern)로 선언되어 있습니다. 이 변수는 multi-level feedback queue 스케줄링 여부를 나타내는 불리언 값입니다.*/
-extern int64_t global_tick;
-/*Global Tick (전역 시각):
 
-Global tick은 전체 시스템에 대한 시간의 흐름을 나타냅니다.
-Global tick은 일반적으로 하드웨어 타이머의 인터럽트를 기반으로 증가합니다.
-시스템의 모든 스레드와 타이머 이벤트에 대한 상대적인 시간을 추적하는 데 사용됩니다.
-스레드의 wakeup_ticks 값과 비교하여 스레드를 깨우는 등 시간 기반의 스케줄링 결정에 활용됩니다.*/
+/* If true, use the completely fair scheduler instead of strict
+   priorities.  Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
 
+/* If true, print each thread's scheduler accounting when it exits.
+   Controlled by kernel command-line option "-schedstat". */
+extern bool thread_schedstat;
+/*thread_mlfqs라는 외부 변수(extern)로 선언되어 있습니다. 이 변수는 multi-level feedback queue 스케줄링 여부를 나타내는 불리언 값입니다.*/
 //readylist의 우선순위가 가장 높은 값이랑 현재 running_thread의 우선순위를 비교
 void test_max_priority(void);
+void thread_preempt (void);
 
 
 void thread_init (void);
@@ -147,6 +227,11 @@ void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_print_sched_stats (void);
+int thread_page_cache_trim (void);
+
+void *thread_ap_prepare (struct cpu *);
+void thread_ap_main (void) NO_RETURN;
 /*스레드 틱(tick)과 스레드 통계 정보 출력 함수를 선언하고 있습니다.*/
 
 typedef void thread_func (void *aux);
@@ -156,7 +241,9 @@ tid_t thread_create (const char *name, int priority, thread_func *, void *);
  이 함수는 스레드 이름, 우선순위, 함수 포인터와 aux 포인터를 인자로 받으며, 생성된 스레드의 식별자(tid_t)를 반환합니다.*/
 
 void thread_block (void);
+void thread_block_unlock (struct spinlock *);
 void thread_unblock (struct thread *);
+void thread_sleep (int64_t ticks);
 /* 스레드를 블록시키거나 언블록시키는 함수를 선언하고 있습니다.
 블록된 스레드는 실행 대기 상태에서 제외되고, 언블록된 스레드는 다시 실행 대기 상태로 들어갑니다.*/
 
@@ -167,9 +254,11 @@ const char *thread_name (void);
 /*현재 스레드의 식별자와 이름을 반환하는 함수를 선언하고 있습니다.*/
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_bind (struct cpu *);
 /*스레드를 종료하고 실행을 양도하는 함수를 선언하고 있습니다. NO_RETURN은 해당 함수가 반환하지 않는다는 것을 나타냅니다.*/
 int thread_get_priority (void);
 void thread_set_priority (int);
+bool thread_set_deadline (int64_t period, int64_t runtime);
 /*현재 스레드의 우선순위를 반환하거나 설정하는 함수를 선언하고 있습니다.*/
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -179,9 +268,13 @@ int thread_get_load_avg (void);
 void do_iret (struct intr_frame *tf);
 /*인터럽트 프레임을 인자로 받아 실행을 복원하는 함수를 선언하고 있습니다.*/
 bool cmp_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
-void donate_priority(void);
-void remove_with_lock(struct lock *lock);
-void refresh_priority(void);
+bool thread_priority_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+bool thread_deadline_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+bool thread_vruntime_less (const struct rb_elem *, const struct rb_elem *,
+		void *aux);
+void thread_refresh_priority (struct thread *);
 
 
 #endif /* threads/thread.h */
@@ -0,0 +1,48 @@
+#ifndef THREADS_WORKPOOL_H
+#define THREADS_WORKPOOL_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/* Kernel worker pool.
+
+   A fixed set of kernel threads, one per CPU and bound to it,
+   that run work on behalf of the rest of the kernel.  Unlike a
+   softirq handler, work runs in an ordinary thread, so it may
+   sleep, take locks and allocate memory.
+
+   Each worker owns a deque of work.  Work submitted by work that
+   is running, such as the halves of a job that splits itself,
+   goes to the bottom of the running worker's deque, where that
+   worker takes it back first while its data is still in the
+   cache.  A worker with nothing of its own to do steals from the
+   top of another worker's deque.  Work submitted from anywhere
+   else, including interrupt handlers, goes to a shared queue
+   that every worker drains, and work submitted with
+   work_submit_priority() to a second shared queue that is
+   always served first. */
+
+/* Runs work, given the work's auxiliary data AUX. */
+typedef void work_func (void *aux);
+
+/* A piece of work.  The submitter owns the memory, which must stay
+   valid until the work starts to run.  The work function may
+   free it or submit it again. */
+struct work {
+	work_func *func;            /* Function to run. */
+	void *aux;                  /* Its argument. */
+	bool pending;               /* Submitted but not yet started? */
+	struct list_elem elem;      /* Element in a shared queue. */
+};
+
+void workpool_init (void);
+int workpool_size (void);
+void workpool_flush (void);
+void workpool_print_stats (void);
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_submit (struct work *);
+bool work_submit_priority (struct work *);
+void work_flush (struct work *);
+
+#endif /* threads/workpool.h */
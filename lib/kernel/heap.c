@@ -0,0 +1,166 @@
+/* Max-heap.
+
+   See heap.h for basic information.  The two-pass pairing used
+   to delete the maximum is from Fredman, Sedgewick, Sleator and
+   Tarjan, "The Pairing Heap: A New Form of Self-Adjusting
+   Heap", Algorithmica 1 (1986). */
+
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *meld (struct heap *, struct heap_elem *,
+		struct heap_elem *);
+static struct heap_elem *meld_siblings (struct heap *, struct heap_elem *);
+
+/* Initializes H as an empty heap that compares elements using
+   LESS, given auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->elem_cnt = 0;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+heap_push (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	e->child = e->next = e->prev = NULL;
+	h->root = meld (h, h->root, e);
+	h->elem_cnt++;
+}
+
+/* Removes and returns the greatest element in H, which must not
+   be empty.  If several elements are greatest, returns any one
+   of them. */
+struct heap_elem *
+heap_pop (struct heap *h) {
+	struct heap_elem *max;
+
+	ASSERT (!heap_empty (h));
+
+	max = h->root;
+	h->root = meld_siblings (h, max->child);
+	max->child = NULL;
+	h->elem_cnt--;
+	return max;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) {
+	struct heap_elem *sub;
+
+	ASSERT (!heap_empty (h));
+	ASSERT (e != NULL);
+
+	if (e == h->root) {
+		heap_pop (h);
+		return;
+	}
+
+	/* Cut the subtree rooted at E out of the tree. */
+	if (e->prev->child == e)
+		e->prev->child = e->next;
+	else
+		e->prev->next = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+	e->next = e->prev = NULL;
+
+	/* Put E's children back in its place. */
+	sub = meld_siblings (h, e->child);
+	e->child = NULL;
+	h->root = meld (h, h->root, sub);
+	h->elem_cnt--;
+}
+
+/* Returns the greatest element in H, or a null pointer if H is
+   empty. */
+struct heap_elem *
+heap_max (const struct heap *h) {
+	ASSERT (h != NULL);
+
+	return h->root;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h) {
+	ASSERT (h != NULL);
+
+	return h->elem_cnt;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (const struct heap *h) {
+	ASSERT (h != NULL);
+
+	return h->root == NULL;
+}
+
+/* Joins the trees rooted at A and B, either of which may be
+   null, and returns the root of the result.  A and B must not
+   have siblings. */
+static struct heap_elem *
+meld (struct heap *h, struct heap_elem *a, struct heap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (h->less (a, b, h->aux)) {
+		struct heap_elem *t = a;
+		a = b;
+		b = t;
+	}
+
+	/* Make B the leftmost child of A. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Joins FIRST and all of its following siblings into a single
+   tree and returns its root, or a null pointer if FIRST is null.
+   Siblings are paired up from left to right, then the pairs are
+   joined from right to left. */
+static struct heap_elem *
+meld_siblings (struct heap *h, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	/* First pass.  PAIRS is a stack of joined pairs, linked
+	   through `next', so that the rightmost pair is on top. */
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL)
+			b->next = b->prev = NULL;
+		a = meld (h, a, b);
+		a->next = pairs;
+		pairs = a;
+	}
+
+	/* Second pass. */
+	while (pairs != NULL) {
+		struct heap_elem *next = pairs->next;
+
+		pairs->next = NULL;
+		root = meld (h, root, pairs);
+		pairs = next;
+	}
+	return root;
+}
@@ -0,0 +1,320 @@
+/* Red-black tree.
+
+   See rbtree.h for basic information.  Insertion and removal
+   follow Cormen, Leiserson, Rivest and Stein, "Introduction to
+   Algorithms", chapter 13, with null pointers in place of the
+   sentinel leaf, which is why removal tracks the parent of the
+   node that moved up separately. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void replace_child (struct rb_tree *, struct rb_elem *old,
+		struct rb_elem *new);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+		struct rb_elem *parent);
+static bool is_red (const struct rb_elem *);
+
+/* Initializes T as an empty tree that compares elements using
+   LESS, given auxiliary data AUX. */
+void
+rb_init (struct rb_tree *t, rb_less_func *less, void *aux) {
+	ASSERT (t != NULL);
+	ASSERT (less != NULL);
+
+	t->root = t->min = NULL;
+	t->elem_cnt = 0;
+	t->less = less;
+	t->aux = aux;
+}
+
+/* Inserts E into T, after any elements equal to it. */
+void
+rb_insert (struct rb_tree *t, struct rb_elem *e) {
+	struct rb_elem *parent = NULL;
+	struct rb_elem **link = &t->root;
+	bool leftmost = true;
+
+	ASSERT (t != NULL);
+	ASSERT (e != NULL);
+
+	while (*link != NULL) {
+		parent = *link;
+		if (t->less (e, parent, t->aux))
+			link = &parent->left;
+		else {
+			link = &parent->right;
+			leftmost = false;
+		}
+	}
+
+	e->parent = parent;
+	e->left = e->right = NULL;
+	e->red = true;
+	*link = e;
+	if (leftmost)
+		t->min = e;
+	t->elem_cnt++;
+
+	insert_fixup (t, e);
+}
+
+/* Removes E, which must be in T, from T. */
+void
+rb_remove (struct rb_tree *t, struct rb_elem *e) {
+	struct rb_elem *child, *parent;
+	bool black_removed;
+
+	ASSERT (!rb_empty (t));
+	ASSERT (e != NULL);
+
+	if (e == t->min)
+		t->min = rb_next (e);
+
+	if (e->left == NULL || e->right == NULL) {
+		/* E has at most one child, which takes its place. */
+		child = e->left != NULL ? e->left : e->right;
+		parent = e->parent;
+		black_removed = !e->red;
+		replace_child (t, e, child);
+		if (child != NULL)
+			child->parent = parent;
+	} else {
+		/* Move E's successor S, which has no left child, into E's
+		   place, taking E's color; S's right child takes S's old
+		   place. */
+		struct rb_elem *s = e->right;
+
+		while (s->left != NULL)
+			s = s->left;
+		child = s->right;
+		black_removed = !s->red;
+
+		if (s->parent == e)
+			parent = s;
+		else {
+			parent = s->parent;
+			parent->left = child;
+			if (child != NULL)
+				child->parent = parent;
+			s->right = e->right;
+			s->right->parent = s;
+		}
+		replace_child (t, e, s);
+		s->parent = e->parent;
+		s->left = e->left;
+		s->left->parent = s;
+		s->red = e->red;
+	}
+
+	e->parent = e->left = e->right = NULL;
+	t->elem_cnt--;
+
+	if (black_removed)
+		remove_fixup (t, child, parent);
+}
+
+/* Returns the least element in T, or a null pointer if T is
+   empty.  If several elements are least, returns the one
+   inserted first. */
+struct rb_elem *
+rb_min (const struct rb_tree *t) {
+	ASSERT (t != NULL);
+
+	return t->min;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the greatest. */
+struct rb_elem *
+rb_next (const struct rb_elem *e) {
+	ASSERT (e != NULL);
+
+	if (e->right != NULL) {
+		e = e->right;
+		while (e->left != NULL)
+			e = e->left;
+		return (struct rb_elem *) e;
+	}
+	while (e->parent != NULL && e == e->parent->right)
+		e = e->parent;
+	return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size (const struct rb_tree *t) {
+	ASSERT (t != NULL);
+
+	return t->elem_cnt;
+}
+
+/* Returns true if T is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *t) {
+	ASSERT (t != NULL);
+
+	return t->root == NULL;
+}
+
+/* Makes NEW take OLD's place as a child of OLD's parent, or as
+   the root of T.  NEW's own parent pointer is left alone. */
+static void
+replace_child (struct rb_tree *t, struct rb_elem *old, struct rb_elem *new) {
+	if (old->parent == NULL)
+		t->root = new;
+	else if (old == old->parent->left)
+		old->parent->left = new;
+	else
+		old->parent->right = new;
+}
+
+/* Rotates the subtree rooted at E to the left, so that E's right
+   child takes its place and E becomes that child's left child. */
+static void
+rotate_left (struct rb_tree *t, struct rb_elem *e) {
+	struct rb_elem *r = e->right;
+
+	e->right = r->left;
+	if (r->left != NULL)
+		r->left->parent = e;
+	replace_child (t, e, r);
+	r->parent = e->parent;
+	r->left = e;
+	e->parent = r;
+}
+
+/* Mirror image of rotate_left(). */
+static void
+rotate_right (struct rb_tree *t, struct rb_elem *e) {
+	struct rb_elem *l = e->left;
+
+	e->left = l->right;
+	if (l->right != NULL)
+		l->right->parent = e;
+	replace_child (t, e, l);
+	l->parent = e->parent;
+	l->right = e;
+	e->parent = l;
+}
+
+/* Restores the red-black properties after inserting red element
+   E, which may have a red parent. */
+static void
+insert_fixup (struct rb_tree *t, struct rb_elem *e) {
+	while (is_red (e->parent)) {
+		struct rb_elem *p = e->parent;
+		struct rb_elem *g = p->parent;
+
+		if (p == g->left) {
+			struct rb_elem *u = g->right;
+
+			if (is_red (u)) {
+				p->red = u->red = false;
+				g->red = true;
+				e = g;
+				continue;
+			}
+			if (e == p->right) {
+				rotate_left (t, p);
+				e = p;
+				p = e->parent;
+			}
+			p->red = false;
+			g->red = true;
+			rotate_right (t, g);
+		} else {
+			struct rb_elem *u = g->left;
+
+			if (is_red (u)) {
+				p->red = u->red = false;
+				g->red = true;
+				e = g;
+				continue;
+			}
+			if (e == p->left) {
+				rotate_right (t, p);
+				e = p;
+				p = e->parent;
+			}
+			p->red = false;
+			g->red = true;
+			rotate_left (t, g);
+		}
+	}
+	t->root->red = false;
+}
+
+/* Restores the red-black properties after a black element was
+   removed from above E, which may be null, so that every path
+   through E is one black element short.  PARENT is E's
+   parent. */
+static void
+remove_fixup (struct rb_tree *t, struct rb_elem *e, struct rb_elem *parent) {
+	while (e != t->root && !is_red (e)) {
+		if (e == parent->left) {
+			struct rb_elem *s = parent->right;
+
+			if (is_red (s)) {
+				s->red = false;
+				parent->red = true;
+				rotate_left (t, parent);
+				s = parent->right;
+			}
+			if (!is_red (s->left) && !is_red (s->right)) {
+				s->red = true;
+				e = parent;
+				parent = e->parent;
+				continue;
+			}
+			if (!is_red (s->right)) {
+				s->left->red = false;
+				s->red = true;
+				rotate_right (t, s);
+				s = parent->right;
+			}
+			s->red = parent->red;
+			parent->red = false;
+			s->right->red = false;
+			rotate_left (t, parent);
+		} else {
+			struct rb_elem *s = parent->left;
+
+			if (is_red (s)) {
+				s->red = false;
+				parent->red = true;
+				rotate_right (t, parent);
+				s = parent->left;
+			}
+			if (!is_red (s->left) && !is_red (s->right)) {
+				s->red = true;
+				e = parent;
+				parent = e->parent;
+				continue;
+			}
+			if (!is_red (s->left)) {
+				s->right->red = false;
+				s->red = true;
+				rotate_left (t, s);
+				s = parent->left;
+			}
+			s->red = parent->red;
+			parent->red = false;
+			s->left->red = false;
+			rotate_right (t, parent);
+		}
+		e = t->root;
+	}
+	if (e != NULL)
+		e->red = false;
+}
+
+/* Returns true if E is a red element; missing children count as
+   black. */
+static bool
+is_red (const struct rb_elem *e) {
+	return e != NULL && e->red;
+}
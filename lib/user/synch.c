@@ -0,0 +1,96 @@
+#include <synch.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* The mutex is the three-state futex lock from Ulrich Drepper,
+   "Futexes Are Tricky".  The holder only makes a system call on
+   unlock if the state says someone may be sleeping. */
+
+/* Initializes mutex M to unlocked. */
+void
+mutex_init (struct mutex *m) {
+	m->state = MUTEX_UNLOCKED;
+}
+
+/* Acquires mutex M, sleeping until it is available. */
+void
+mutex_lock (struct mutex *m) {
+	int c = MUTEX_UNLOCKED;
+
+	if (__atomic_compare_exchange_n (&m->state, &c, MUTEX_LOCKED, false,
+				__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+
+	/* Contended.  Mark the mutex so that the holder wakes us, and
+	   sleep until we are the one to find it unlocked. */
+	if (c != MUTEX_CONTENDED)
+		c = __atomic_exchange_n (&m->state, MUTEX_CONTENDED, __ATOMIC_ACQUIRE);
+	while (c != MUTEX_UNLOCKED) {
+		futex_wait (&m->state, MUTEX_CONTENDED);
+		c = __atomic_exchange_n (&m->state, MUTEX_CONTENDED, __ATOMIC_ACQUIRE);
+	}
+}
+
+/* Tries to acquire mutex M without sleeping.  Returns true if
+   successful, false otherwise. */
+bool
+mutex_trylock (struct mutex *m) {
+	int c = MUTEX_UNLOCKED;
+
+	return __atomic_compare_exchange_n (&m->state, &c, MUTEX_LOCKED, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/* Releases mutex M, which the caller must hold, waking one
+   waiter if there may be any. */
+void
+mutex_unlock (struct mutex *m) {
+	if (__atomic_exchange_n (&m->state, MUTEX_UNLOCKED, __ATOMIC_RELEASE)
+			== MUTEX_CONTENDED)
+		futex_wake (&m->state, 1);
+}
+
+/* Initializes condition variable CV. */
+void
+condvar_init (struct condvar *cv) {
+	cv->seq = 0;
+	cv->waiters = 0;
+}
+
+/* Atomically releases mutex M and waits for CV to be signaled,
+   then reacquires M.  As with kernel condition variables, the
+   caller must recheck its condition after waking up. */
+void
+condvar_wait (struct condvar *cv, struct mutex *m) {
+	int seq = __atomic_load_n (&cv->seq, __ATOMIC_RELAXED);
+
+	__atomic_fetch_add (&cv->waiters, 1, __ATOMIC_RELAXED);
+	mutex_unlock (m);
+
+	/* Returns at once if a signal already bumped the sequence
+	   number since we read it. */
+	futex_wait (&cv->seq, seq);
+	__atomic_fetch_sub (&cv->waiters, 1, __ATOMIC_RELAXED);
+
+	/* Others may have been woken with us, so lock in the
+	   contended state to make sure they are woken in turn. */
+	while (__atomic_exchange_n (&m->state, MUTEX_CONTENDED, __ATOMIC_ACQUIRE)
+			!= MUTEX_UNLOCKED)
+		futex_wait (&m->state, MUTEX_CONTENDED);
+}
+
+/* Wakes one thread waiting on CV, if any. */
+void
+condvar_signal (struct condvar *cv) {
+	__atomic_fetch_add (&cv->seq, 1, __ATOMIC_RELEASE);
+	if (__atomic_load_n (&cv->waiters, __ATOMIC_RELAXED) > 0)
+		futex_wake (&cv->seq, 1);
+}
+
+/* Wakes every thread waiting on CV. */
+void
+condvar_broadcast (struct condvar *cv) {
+	__atomic_fetch_add (&cv->seq, 1, __ATOMIC_RELEASE);
+	if (__atomic_load_n (&cv->waiters, __ATOMIC_RELAXED) > 0)
+		futex_wake (&cv->seq, INT_MAX);
+}
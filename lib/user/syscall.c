@@ -25,7 +25,7 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			"syscall\n"
 			: "=a" (ret)
 			: "g" (num), "g" (a1), "g" (a2), "g" (a3), "g" (a4), "g" (a5), "g" (a6)
-			: "cc", "memory");
+			: "cc", "memory", "rcx", "r11");
 	return ret;
 }
 
@@ -185,6 +185,26 @@ symlink (const char* target, const char* linkpath) {
 	return syscall2 (SYS_SYMLINK, target, linkpath);
 }
 
+int
+futex_wait (int *addr, int val) {
+	return syscall2 (SYS_FUTEX_WAIT, addr, val);
+}
+
+int
+futex_wake (int *addr, int n) {
+	return syscall2 (SYS_FUTEX_WAKE, addr, n);
+}
+
+bool
+set_deadline (unsigned period_ms, unsigned runtime_ms) {
+	return syscall2 (SYS_SET_DEADLINE, period_ms, runtime_ms);
+}
+
+pid_t
+getpid (void) {
+	return (pid_t) syscall0 (SYS_GETPID);
+}
+
 int
 mount (const char *path, int chan_no, int dev_no) {
 	return syscall3 (SYS_MOUNT, path, chan_no, dev_no);
@@ -0,0 +1,81 @@
+/* Sleeps for several durations shorter than a timer tick, each
+   a number of times, and reports how late the wakeups were.
+   Every sleep must last at least as long as asked, and the
+   wakeups must on average come well within a tick, which a
+   sleep rounded to whole ticks could not do.  A lower-priority
+   thread counts while the main thread sleeps, to check that the
+   sleeps block instead of spinning. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 20
+
+static const int durations[] = { 50, 200, 1000, 4000 };
+
+static volatile bool done;
+static volatile int64_t spins;
+static struct semaphore spinner_done;
+
+static thread_func spinner_thread;
+
+void
+test_alarm_hires (void)
+{
+  const uint64_t tick_ns = 1000000000 / TIMER_FREQ;
+  size_t i;
+  int j;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&spinner_done, 0);
+  thread_create ("spinner", PRI_DEFAULT - 1, spinner_thread, NULL);
+
+  for (i = 0; i < sizeof durations / sizeof *durations; i++)
+    {
+      uint64_t sleep_ns = (uint64_t) durations[i] * 1000;
+      uint64_t total = 0, max = 0;
+
+      for (j = 0; j < ITERATIONS; j++)
+        {
+          uint64_t start = timer_ns ();
+          uint64_t elapsed;
+
+          timer_usleep (durations[i]);
+          elapsed = timer_ns () - start;
+          if (elapsed < sleep_ns)
+            fail ("Sleep of %d us woke after %"PRIu64" ns.",
+                  durations[i], elapsed);
+          total += elapsed - sleep_ns;
+          if (elapsed - sleep_ns > max)
+            max = elapsed - sleep_ns;
+        }
+      if (total / ITERATIONS >= tick_ns)
+        fail ("Sleeps of %d us woke %"PRIu64" ns late on average.",
+              durations[i], total / ITERATIONS);
+      msg ("Slept %d us %d times.", durations[i], ITERATIONS);
+      msg ("Jitter: %"PRIu64" us average, %"PRIu64" us maximum.",
+           total / ITERATIONS / 1000, max / 1000);
+    }
+
+  if (spins == 0)
+    fail ("Lower-priority thread never ran during the sleeps.");
+  msg ("Lower-priority thread ran during the sleeps.");
+
+  done = true;
+  sema_down (&spinner_done);
+}
+
+static void
+spinner_thread (void *aux UNUSED)
+{
+  while (!done)
+    spins++;
+  sema_up (&spinner_done);
+}
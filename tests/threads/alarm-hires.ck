@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+
+# Jitter varies from run to run, so mask it before comparing.
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+s/ \d+ us average, \d+ us maximum\.$/ <avg> us average, <max> us maximum./
+  foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(alarm-hires) begin
+(alarm-hires) Slept 50 us 20 times.
+(alarm-hires) Jitter: <avg> us average, <max> us maximum.
+(alarm-hires) Slept 200 us 20 times.
+(alarm-hires) Jitter: <avg> us average, <max> us maximum.
+(alarm-hires) Slept 1000 us 20 times.
+(alarm-hires) Jitter: <avg> us average, <max> us maximum.
+(alarm-hires) Slept 4000 us 20 times.
+(alarm-hires) Jitter: <avg> us average, <max> us maximum.
+(alarm-hires) Lower-priority thread ran during the sleeps.
+(alarm-hires) end
+EOF
+pass;
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::mlfqs;
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (@actual);
+foreach (@output) {
+    my ($id, $count) = /Thread (\d+) received (\d+) ticks\./ or next;
+    $actual[$id] = $count;
+}
+
+# 1000 ticks shared in proportion to weights 1024, 335 and 110.
+my (@expected) = (697, 228, 75);
+mlfqs_compare ("thread", "%d", \@actual, \@expected, 40, [0, 2, 1],
+	       "Some tick counts were missing or differed from those "
+	       . "expected by more than 40.");
+pass;
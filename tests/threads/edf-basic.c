@@ -0,0 +1,73 @@
+/* Checks the earliest-deadline-first class set up by
+   thread_set_deadline().  Reservations that are malformed or
+   would overload the CPU must be refused, an admitted EDF thread
+   must run ahead of even a PRI_MAX thread, and leaving the class
+   must hand the CPU back to that thread and restore the old
+   priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static struct semaphore done;
+static bool high_ran;
+
+static thread_func reserver_thread;
+static thread_func high_thread;
+
+void
+test_edf_basic (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&done, 0);
+
+  if (thread_set_deadline (10, 20))
+    fail ("runtime longer than period was admitted.");
+  msg ("Runtime longer than period refused.");
+  if (thread_set_deadline (10, 10))
+    fail ("reservation of the whole CPU was admitted.");
+  msg ("Full CPU refused.");
+  if (!thread_set_deadline (100, 50))
+    fail ("reservation of half the CPU was refused.");
+  msg ("Half CPU admitted.");
+
+  /* The reserver only runs while we are blocked. */
+  thread_create ("reserver", PRI_MIN, reserver_thread, NULL);
+  sema_down (&done);
+
+  thread_create ("high", PRI_MAX, high_thread, NULL);
+  if (high_ran)
+    fail ("PRI_MAX thread ran ahead of an EDF thread.");
+  msg ("Main still ahead of a PRI_MAX thread.");
+
+  if (!thread_set_deadline (0, 0))
+    fail ("leaving the EDF class failed.");
+  if (!high_ran)
+    fail ("PRI_MAX thread did not run when main left the EDF class.");
+  msg ("Main left EDF.");
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+reserver_thread (void *aux UNUSED)
+{
+  if (thread_set_deadline (100, 50))
+    fail ("second half-CPU reservation was admitted.");
+  msg ("Second half CPU refused.");
+  sema_up (&done);
+}
+
+static void
+high_thread (void *aux UNUSED)
+{
+  high_ran = true;
+  msg ("PRI_MAX thread ran.");
+}
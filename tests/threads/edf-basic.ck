@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-basic) begin
+(edf-basic) Runtime longer than period refused.
+(edf-basic) Full CPU refused.
+(edf-basic) Half CPU admitted.
+(edf-basic) Second half CPU refused.
+(edf-basic) Main still ahead of a PRI_MAX thread.
+(edf-basic) PRI_MAX thread ran.
+(edf-basic) Main left EDF.
+(edf-basic) Main thread should have priority 31.  Actual priority: 31.
+(edf-basic) end
+EOF
+pass;
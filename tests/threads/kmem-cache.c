@@ -0,0 +1,115 @@
+/* Checks object caches.
+
+   Allocates enough objects of an odd size to fill several slabs,
+   and checks that they are aligned as asked, do not overlap, and
+   come back in the state the constructor left them in.  Frees
+   them, allocates them again, and checks that the constructor
+   did not run again on objects that were only reused.  Also
+   checks that the slabs were colored, so that their first
+   objects do not all sit at the same offset within the page. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+#define OBJ_CNT 64
+#define OBJ_ALIGN 32
+#define OBJ_MAGIC 0x0b1ec7ed
+
+/* An object a little over half a kilobyte, like an inode. */
+struct obj
+  {
+    unsigned magic;
+    int owner;
+    char data[536];
+  };
+
+static int ctor_cnt;
+
+static kmem_ctor_func obj_ctor;
+
+void
+test_kmem_cache (void)
+{
+  struct kmem_cache *c;
+  struct obj *objs[OBJ_CNT];
+  int first_ctor_cnt;
+  bool colored = false;
+  int i, j;
+
+  c = kmem_cache_create ("test", sizeof (struct obj), OBJ_ALIGN, obj_ctor);
+  if (c == NULL)
+    fail ("Cache creation failed.");
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i] = kmem_cache_alloc (c);
+      if (objs[i] == NULL)
+        fail ("Allocation %d failed.", i);
+      if ((uintptr_t) objs[i] % OBJ_ALIGN != 0)
+        fail ("Object %d is not aligned.", i);
+      if (objs[i]->magic != OBJ_MAGIC || objs[i]->owner != -1)
+        fail ("Object %d is not constructed.", i);
+      objs[i]->owner = i;
+      memset (objs[i]->data, i, sizeof objs[i]->data);
+    }
+  msg ("Allocated %d objects.", OBJ_CNT);
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      for (j = 0; j < (int) sizeof objs[i]->data; j++)
+        if (objs[i]->data[j] != (char) i)
+          fail ("Object %d was overwritten.", i);
+      if (pg_ofs (objs[i]) != pg_ofs (objs[0]) && pg_no (objs[i]) != pg_no (objs[0]))
+        colored = true;
+    }
+  msg ("No object was overwritten.");
+  if (!colored)
+    fail ("Every slab starts its objects at the same offset.");
+  msg ("Slabs are colored.");
+
+  /* Free the objects in their constructed state, in reverse
+     order, and allocate them again. */
+  first_ctor_cnt = ctor_cnt;
+  for (i = OBJ_CNT - 1; i >= 0; i--)
+    {
+      objs[i]->owner = -1;
+      kmem_cache_free (c, objs[i]);
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i] = kmem_cache_alloc (c);
+      if (objs[i] == NULL || objs[i]->magic != OBJ_MAGIC
+          || objs[i]->owner != -1)
+        fail ("Reallocated object %d is not constructed.", i);
+    }
+  msg ("Reallocated %d objects.", OBJ_CNT);
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i]->owner = -1;
+      kmem_cache_free (c, objs[i]);
+    }
+  kmem_cache_destroy (c);
+
+  /* Only slabs given back to the page allocator and created
+     again may have run the constructor again, and the cache
+     keeps at least one empty slab back. */
+  if (ctor_cnt - first_ctor_cnt >= first_ctor_cnt)
+    fail ("Constructor ran %d times for %d objects.", ctor_cnt, OBJ_CNT);
+  msg ("Constructor ran only for new slabs.");
+}
+
+static void
+obj_ctor (void *obj_)
+{
+  struct obj *obj = obj_;
+
+  obj->magic = OBJ_MAGIC;
+  obj->owner = -1;
+  ctor_cnt++;
+}
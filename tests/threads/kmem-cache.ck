@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(kmem-cache) begin
+(kmem-cache) Allocated 64 objects.
+(kmem-cache) No object was overwritten.
+(kmem-cache) Slabs are colored.
+(kmem-cache) Reallocated 64 objects.
+(kmem-cache) Constructor ran only for new slabs.
+(kmem-cache) end
+pass;
@@ -0,0 +1,124 @@
+/* Benchmarks malloc() and free().
+
+   THREAD_CNT threads each allocate BATCH blocks at a time, with
+   sizes drawn from the mix that the system call path asks for:
+   mostly small file and directory handles and path strings, some
+   in-memory inodes, and sector-sized bounce buffers.  Each thread
+   fills its blocks with a pattern of its own, checks the pattern,
+   and frees the blocks in a different order than it allocated
+   them, ROUNDS times over.  Reports the average cost of one
+   malloc() and free() pair in time-stamp counter cycles. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define THREAD_CNT 4
+#define ROUNDS 2000
+#define BATCH 32
+
+/* Block sizes and how often each is asked for, out of 100. */
+static const struct
+  {
+    size_t size;
+    int weight;
+  }
+mix[] =
+  {
+    {16, 30},           /* struct file, fd table entries. */
+    {24, 20},           /* struct dir. */
+    {40, 15},           /* Short path strings. */
+    {100, 15},          /* Long path strings, struct inode. */
+    {200, 8},           /* Argument vectors. */
+    {512, 10},          /* Sector bounce buffers. */
+    {1000, 2},          /* Page-sized user copies, minus headers. */
+  };
+
+static struct semaphore done;
+static bool corrupt;
+
+static thread_func bench_thread;
+
+void
+test_malloc_bench (void)
+{
+  uint64_t start, cycles;
+  int i;
+
+  sema_init (&done, 0);
+
+  /* Warm up. */
+  bench_thread ((void *) (intptr_t) (THREAD_CNT + 1));
+  sema_down (&done);
+
+  start = rdtsc ();
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "bench %d", i);
+      thread_create (name, PRI_DEFAULT, bench_thread, (void *) (intptr_t) (i + 1));
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+  cycles = rdtsc () - start;
+
+  if (corrupt)
+    fail ("A block was overwritten while in use.");
+  msg ("%d threads, %d rounds of %d blocks each.", THREAD_CNT, ROUNDS, BATCH);
+  msg ("All blocks intact.");
+  msg ("%"PRIu64" cycles per malloc/free pair.",
+       cycles / ((uint64_t) THREAD_CNT * ROUNDS * BATCH));
+}
+
+/* Returns a block size drawn from mix[], advancing the
+   linear congruential generator whose state is *SEED. */
+static size_t
+pick_size (unsigned *seed)
+{
+  int r, i;
+
+  *seed = *seed * 1103515245 + 12345;
+  r = (*seed >> 16) % 100;
+  for (i = 0; r >= mix[i].weight; i++)
+    r -= mix[i].weight;
+  return mix[i].size;
+}
+
+static void
+bench_thread (void *id_)
+{
+  int id = (intptr_t) id_;
+  unsigned seed = id;
+  void *blocks[BATCH];
+  size_t sizes[BATCH];
+  int round, i;
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      for (i = 0; i < BATCH; i++)
+        {
+          sizes[i] = pick_size (&seed);
+          blocks[i] = malloc (sizes[i]);
+          if (blocks[i] == NULL)
+            fail ("Out of memory after %d rounds.", round);
+          memset (blocks[i], id, sizes[i]);
+        }
+
+      /* Free in a stride that visits every block once. */
+      for (i = 0; i < BATCH; i++)
+        {
+          int j = (i * 7 + round) % BATCH;
+          unsigned char *p = blocks[j];
+          if (p[0] != id || p[sizes[j] - 1] != id)
+            corrupt = true;
+          free (p);
+        }
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+
+# The cycle count varies from run to run, so mask it before comparing.
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+s/ \d+ cycles per malloc\/free pair\.$/ <cycles> cycles per malloc\/free pair./
+  foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(malloc-bench) begin
+(malloc-bench) 4 threads, 2000 rounds of 32 blocks each.
+(malloc-bench) All blocks intact.
+(malloc-bench) <cycles> cycles per malloc/free pair.
+(malloc-bench) end
+pass;
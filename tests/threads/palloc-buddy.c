@@ -0,0 +1,66 @@
+/* Checks the buddy page allocator.
+
+   Allocates runs of 1 to MAX_RUN pages, some of them powers of 2,
+   fills every page of each run with a value of its own, and
+   checks that no run was overwritten by another.  A run of 2**K
+   pages must start on a multiple of 2**K pages in physical
+   memory.  Then frees the runs in a different order than they
+   were allocated, so that the freed blocks must merge with their
+   buddies for a large run to be allocated afterward. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define RUN_CNT 48
+#define MAX_RUN 12
+#define BIG_RUN 64
+
+void
+test_palloc_buddy (void)
+{
+  uint8_t *runs[RUN_CNT];
+  size_t sizes[RUN_CNT];
+  uint8_t *big;
+  size_t i, j;
+
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      sizes[i] = i % MAX_RUN + 1;
+      runs[i] = palloc_get_multiple (0, sizes[i]);
+      if (runs[i] == NULL)
+        fail ("Allocating %zu pages failed.", sizes[i]);
+      if ((sizes[i] & (sizes[i] - 1)) == 0
+          && pg_no (vtop (runs[i])) % sizes[i] != 0)
+        fail ("Run of %zu pages is not aligned on its size.", sizes[i]);
+      memset (runs[i], i, sizes[i] * PGSIZE);
+    }
+  msg ("Allocated %d runs of 1 to %d pages.", RUN_CNT, MAX_RUN);
+
+  for (i = 0; i < RUN_CNT; i++)
+    for (j = 0; j < sizes[i] * PGSIZE; j += 512)
+      if (runs[i][j] != (uint8_t) i)
+        fail ("Run %zu was overwritten.", i);
+  msg ("No run was overwritten.");
+
+  /* Free the odd runs, then the even ones. */
+  for (i = 1; i < RUN_CNT; i += 2)
+    palloc_free_multiple (runs[i], sizes[i]);
+  for (i = 0; i < RUN_CNT; i += 2)
+    palloc_free_multiple (runs[i], sizes[i]);
+  msg ("Freed all runs.");
+
+  big = palloc_get_multiple (PAL_ZERO, BIG_RUN);
+  if (big == NULL)
+    fail ("Allocating %d pages failed.", BIG_RUN);
+  if (pg_no (vtop (big)) % BIG_RUN != 0)
+    fail ("Run of %d pages is not aligned on its size.", BIG_RUN);
+  for (j = 0; j < BIG_RUN * PGSIZE; j++)
+    if (big[j] != 0)
+      fail ("Page allocated with PAL_ZERO is not zeroed.");
+  palloc_free_multiple (big, BIG_RUN);
+  msg ("Allocated and freed %d pages.", BIG_RUN);
+}
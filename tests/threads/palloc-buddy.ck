@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) Allocated 48 runs of 1 to 12 pages.
+(palloc-buddy) No run was overwritten.
+(palloc-buddy) Freed all runs.
+(palloc-buddy) Allocated and freed 64 pages.
+(palloc-buddy) end
+pass;
@@ -0,0 +1,59 @@
+/* Checks that PAL_ZERO pages are zeroed, both before and after
+   the idle thread has had a chance to zero pages ahead of time.
+
+   Dirties PAGE_CNT pages and frees them, so that the free lists
+   are full of dirty pages, then allocates PAGE_CNT pages with
+   PAL_ZERO and checks every byte.  Does it again after sleeping,
+   which lets the idle thread run. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 32
+
+static void dirty_and_check (const char *when);
+
+void
+test_palloc_zero (void)
+{
+  dirty_and_check ("right away");
+  timer_sleep (10);
+  dirty_and_check ("after idling");
+}
+
+/* Dirties PAGE_CNT pages, frees them, and checks that PAGE_CNT
+   pages allocated with PAL_ZERO are zeroed. */
+static void
+dirty_and_check (const char *when)
+{
+  uint8_t *pages[PAGE_CNT];
+  size_t i, j;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      pages[i] = palloc_get_page (0);
+      if (pages[i] == NULL)
+        fail ("Out of pages.");
+      memset (pages[i], 0xff, PGSIZE);
+    }
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      pages[i] = palloc_get_page (PAL_ZERO);
+      if (pages[i] == NULL)
+        fail ("Out of pages.");
+      for (j = 0; j < PGSIZE; j++)
+        if (pages[i][j] != 0)
+          fail ("Byte %zu of page %zu is not zero.", j, i);
+    }
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+  msg ("%d PAL_ZERO pages zeroed %s.", PAGE_CNT, when);
+}
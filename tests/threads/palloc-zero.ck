@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) 32 PAL_ZERO pages zeroed right away.
+(palloc-zero) 32 PAL_ZERO pages zeroed after idling.
+(palloc-zero) end
+pass;
@@ -0,0 +1,123 @@
+/* Exercises priority donation through a readers-writer lock.
+
+   First the main thread acquires the rwlock for writing.  Then
+   it creates a higher-priority reader and a still higher-priority
+   writer that block acquiring it, donating their priorities to
+   the main thread.  When the main thread releases the rwlock,
+   the writer should run before the reader.
+
+   Then the main thread acquires the rwlock for reading and
+   creates a higher-priority writer that blocks waiting for it to
+   finish, donating its priority to the main thread as a reader.
+   With writers preferred, new readers must now wait, so the main
+   thread cannot take a second read hold, and a still
+   higher-priority reader that blocks behind the waiting writer
+   donates its priority to the writer, and through it to the
+   main thread.  When the main thread releases its read hold, the
+   writer gets the rwlock, downgrades to a read hold (letting the
+   reader in), and upgrades back. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader1_thread_func;
+static thread_func writer1_thread_func;
+static thread_func writer2_thread_func;
+static thread_func reader2_thread_func;
+
+void
+test_priority_donate_rwlock (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw, true);
+
+  /* Donation from threads blocked behind a writer. */
+  rwlock_acquire_write (&rw);
+  thread_create ("reader1", PRI_DEFAULT + 1, reader1_thread_func, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+  thread_create ("writer1", PRI_DEFAULT + 2, writer1_thread_func, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  rwlock_release_write (&rw);
+  msg ("writer1, reader1 must already have finished, in that order.");
+
+  /* Writer preference, downgrade and upgrade. */
+  rwlock_acquire_read (&rw);
+  thread_create ("writer2", PRI_DEFAULT + 1, writer2_thread_func, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+  if (rwlock_try_acquire_read (&rw))
+    fail ("new reader got in ahead of a waiting writer");
+  msg ("New readers wait behind the waiting writer.");
+  thread_create ("reader2", PRI_DEFAULT + 2, reader2_thread_func, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  rwlock_release_read (&rw);
+  msg ("reader2, writer2 must already have finished, in that order.");
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+  msg ("This should be the last line before finishing this test.");
+}
+
+static void
+reader1_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_read (rw);
+  msg ("reader1: got the lock for reading");
+  rwlock_release_read (rw);
+  msg ("reader1: done");
+}
+
+static void
+writer1_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("writer1: got the lock for writing");
+  rwlock_release_write (rw);
+  msg ("writer1: done");
+}
+
+static void
+writer2_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("writer2: got the lock for writing with priority %d.",
+       thread_get_priority ());
+  rwlock_downgrade (rw);
+  msg ("writer2: downgraded, held for write: %s",
+       rwlock_held_for_write (rw) ? "yes" : "no");
+  if (!rwlock_try_upgrade (rw))
+    fail ("upgrade failed with no other holders");
+  msg ("writer2: upgraded, held for write: %s",
+       rwlock_held_for_write (rw) ? "yes" : "no");
+  rwlock_release_write (rw);
+  msg ("writer2: done");
+}
+
+static void
+reader2_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_read (rw);
+  msg ("reader2: got the lock for reading");
+  rwlock_release_read (rw);
+  msg ("reader2: done");
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock) begin
+(priority-donate-rwlock) This thread should have priority 32.  Actual priority: 32.
+(priority-donate-rwlock) This thread should have priority 33.  Actual priority: 33.
+(priority-donate-rwlock) writer1: got the lock for writing
+(priority-donate-rwlock) writer1: done
+(priority-donate-rwlock) reader1: got the lock for reading
+(priority-donate-rwlock) reader1: done
+(priority-donate-rwlock) writer1, reader1 must already have finished, in that order.
+(priority-donate-rwlock) This thread should have priority 32.  Actual priority: 32.
+(priority-donate-rwlock) New readers wait behind the waiting writer.
+(priority-donate-rwlock) This thread should have priority 33.  Actual priority: 33.
+(priority-donate-rwlock) writer2: got the lock for writing with priority 33.
+(priority-donate-rwlock) reader2: got the lock for reading
+(priority-donate-rwlock) reader2: done
+(priority-donate-rwlock) writer2: downgraded, held for write: no
+(priority-donate-rwlock) writer2: upgraded, held for write: yes
+(priority-donate-rwlock) writer2: done
+(priority-donate-rwlock) reader2, writer2 must already have finished, in that order.
+(priority-donate-rwlock) This thread should have priority 31.  Actual priority: 31.
+(priority-donate-rwlock) This should be the last line before finishing this test.
+(priority-donate-rwlock) end
+EOF
+pass;
@@ -0,0 +1,200 @@
+/* Stress test and benchmark for priority donation.
+
+   First, the main thread, at PRI_MIN, acquires the first of a
+   chain of CHAIN_DEPTH locks and creates CHAIN_DEPTH threads of
+   increasing priority.  Thread i acquires lock i and then waits
+   for lock i - 1, held by thread i - 1, so each new thread's
+   priority is donated all the way down the chain to the main
+   thread, far deeper than 8 levels.  Releasing the first lock
+   then unwinds the chain from the bottom up, each thread still
+   running at the donated priority of the top of the chain.
+
+   Second, the main thread acquires LOCK_CNT locks and creates
+   DONOR_CNT donors of increasing priority, spread over the
+   locks, so that every lock has several waiters.  It releases
+   the locks one at a time, highest donation first, and checks
+   that its priority falls to the highest donation still
+   outstanding after each release.
+
+   Times are reported for unwinding the chain, for releasing the
+   locks with donors, and for an uncontended acquire and release
+   while DONOR_CNT donations are outstanding. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define CHAIN_DEPTH 48
+#define LOCK_CNT 8
+#define DONOR_CNT 40
+#define ITERATIONS 1000
+
+struct chain_link
+  {
+    int id;                     /* Position in the chain, 1...CHAIN_DEPTH. */
+    struct lock *hold;          /* Lock held, or NULL at the top. */
+    struct lock *wait;          /* Lock waited for. */
+  };
+
+/* Too large for the main thread's stack. */
+static struct lock chain_locks[CHAIN_DEPTH];
+static struct chain_link links[CHAIN_DEPTH + 1];
+static struct lock donor_locks[LOCK_CNT];
+static struct lock extra_lock;
+
+static struct semaphore done;
+static int order[CHAIN_DEPTH];
+static int order_cnt;
+static int acquired_cnt;
+
+static thread_func chain_thread;
+static thread_func donor_thread;
+static void test_chain (void);
+static void test_donors (void);
+
+void
+test_priority_donate_stress (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_set_priority (PRI_MIN);
+  sema_init (&done, 0);
+
+  test_chain ();
+  test_donors ();
+}
+
+static void
+test_chain (void)
+{
+  uint64_t start;
+  int i;
+
+  for (i = 0; i < CHAIN_DEPTH; i++)
+    lock_init (&chain_locks[i]);
+
+  lock_acquire (&chain_locks[0]);
+  for (i = 1; i <= CHAIN_DEPTH; i++)
+    {
+      char name[16];
+
+      links[i].id = i;
+      links[i].hold = i < CHAIN_DEPTH ? &chain_locks[i] : NULL;
+      links[i].wait = &chain_locks[i - 1];
+      snprintf (name, sizeof name, "chain %d", i);
+      thread_create (name, PRI_MIN + i, chain_thread, &links[i]);
+      if (thread_get_priority () != PRI_MIN + i)
+        fail ("main should have priority %d with a %d-deep chain, "
+              "but has %d.", PRI_MIN + i, i, thread_get_priority ());
+    }
+  msg ("Main received donations through %d levels.", CHAIN_DEPTH);
+
+  start = rdtsc ();
+  lock_release (&chain_locks[0]);
+  msg ("Chain of %d unwound in %"PRIu64" us.",
+       CHAIN_DEPTH, timer_cycles_to_us (rdtsc () - start));
+
+  for (i = 0; i < CHAIN_DEPTH; i++)
+    sema_down (&done);
+  if (thread_get_priority () != PRI_MIN)
+    fail ("main should have priority %d after unwinding, but has %d.",
+          PRI_MIN, thread_get_priority ());
+  for (i = 0; i < CHAIN_DEPTH; i++)
+    if (order[i] != i + 1)
+      fail ("chain thread %d acquired its lock in place of thread %d.",
+            order[i], i + 1);
+  msg ("Chain unwound in order.");
+}
+
+static void
+chain_thread (void *link_)
+{
+  struct chain_link *link = link_;
+
+  if (link->hold != NULL)
+    lock_acquire (link->hold);
+  lock_acquire (link->wait);
+  if (thread_get_priority () != PRI_MIN + CHAIN_DEPTH)
+    fail ("chain thread %d should have priority %d, but has %d.",
+          link->id, PRI_MIN + CHAIN_DEPTH, thread_get_priority ());
+  order[order_cnt++] = link->id;
+  lock_release (link->wait);
+  if (link->hold != NULL)
+    lock_release (link->hold);
+  sema_up (&done);
+}
+
+static void
+test_donors (void)
+{
+  uint64_t start;
+  int i;
+
+  for (i = 0; i < LOCK_CNT; i++)
+    {
+      lock_init (&donor_locks[i]);
+      lock_acquire (&donor_locks[i]);
+    }
+  lock_init (&extra_lock);
+
+  /* Donor I has priority PRI_MIN + I + 1 and waits for lock
+     I % LOCK_CNT, so the locks' highest waiters are the last
+     LOCK_CNT donors. */
+  for (i = 0; i < DONOR_CNT; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "donor %d", i);
+      thread_create (name, PRI_MIN + i + 1, donor_thread,
+                     &donor_locks[i % LOCK_CNT]);
+    }
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_MIN + DONOR_CNT, thread_get_priority ());
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      lock_acquire (&extra_lock);
+      lock_release (&extra_lock);
+    }
+  msg ("%d uncontended acquire/release pairs holding %d locks: "
+       "%"PRIu64" us.", ITERATIONS, LOCK_CNT,
+       timer_cycles_to_us (rdtsc () - start));
+
+  start = rdtsc ();
+  for (i = LOCK_CNT - 1; i > 0; i--)
+    {
+      int expected = PRI_MIN + DONOR_CNT - LOCK_CNT + i;
+
+      lock_release (&donor_locks[i]);
+      if (thread_get_priority () != expected)
+        fail ("main should have priority %d after releasing lock %d, "
+              "but has %d.", expected, i, thread_get_priority ());
+    }
+  lock_release (&donor_locks[0]);
+  msg ("Released %d locks with %d donors in %"PRIu64" us.",
+       LOCK_CNT, DONOR_CNT, timer_cycles_to_us (rdtsc () - start));
+
+  for (i = 0; i < DONOR_CNT; i++)
+    sema_down (&done);
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_MIN, thread_get_priority ());
+  msg ("%d of %d donors acquired their locks.", acquired_cnt, DONOR_CNT);
+}
+
+static void
+donor_thread (void *lock_)
+{
+  struct lock *lock = lock_;
+
+  lock_acquire (lock);
+  acquired_cnt++;
+  lock_release (lock);
+  sema_up (&done);
+}
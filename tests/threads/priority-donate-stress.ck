@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+
+# Timings vary from run to run, so mask them before comparing.
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+s/ \d+ us\.$/ <time> us./ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(priority-donate-stress) begin
+(priority-donate-stress) Main received donations through 48 levels.
+(priority-donate-stress) Chain of 48 unwound in <time> us.
+(priority-donate-stress) Chain unwound in order.
+(priority-donate-stress) Main should have priority 40.  Actual priority: 40.
+(priority-donate-stress) 1000 uncontended acquire/release pairs holding 8 locks: <time> us.
+(priority-donate-stress) Released 8 locks with 40 donors in <time> us.
+(priority-donate-stress) Main should have priority 0.  Actual priority: 0.
+(priority-donate-stress) 40 of 40 donors acquired their locks.
+(priority-donate-stress) end
+EOF
+pass;
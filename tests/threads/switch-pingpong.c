@@ -0,0 +1,59 @@
+/* Benchmarks thread switching.
+
+   The main thread and a partner of equal priority hand control
+   back and forth ROUNDS times through a pair of semaphores, so
+   that every sema_down() blocks and switches to the other thread.
+   Reports the average cost of one switch, including the
+   semaphore operations around it, in time-stamp counter cycles. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define ROUNDS 10000
+
+static struct semaphore ping, pong;
+
+static thread_func pong_thread;
+
+void
+test_switch_pingpong (void)
+{
+  uint64_t start, cycles;
+  int i;
+
+  sema_init (&ping, 0);
+  sema_init (&pong, 0);
+  thread_create ("pong", thread_get_priority (), pong_thread, NULL);
+
+  /* Warm up. */
+  sema_up (&ping);
+  sema_down (&pong);
+
+  start = rdtsc ();
+  for (i = 0; i < ROUNDS; i++)
+    {
+      sema_up (&ping);
+      sema_down (&pong);
+    }
+  cycles = rdtsc () - start;
+
+  msg ("%d round trips, 2 switches each.", ROUNDS);
+  msg ("%"PRIu64" cycles per switch.", cycles / (2 * ROUNDS));
+}
+
+static void
+pong_thread (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ROUNDS + 1; i++)
+    {
+      sema_down (&ping);
+      sema_up (&pong);
+    }
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+
+# Timings vary from run to run, so mask them before comparing.
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+s/ \d+ cycles per switch\.$/ <cycles> cycles per switch./ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(switch-pingpong) begin
+(switch-pingpong) 10000 round trips, 2 switches each.
+(switch-pingpong) <cycles> cycles per switch.
+(switch-pingpong) end
+EOF
+pass;
@@ -17,6 +17,7 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-hires", test_alarm_hires},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,19 +26,30 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-stress", test_priority_donate_stress},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
-    // {"mlfqs-load-1", test_mlfqs_load_1},
-    // {"mlfqs-load-60", test_mlfqs_load_60},
-    // {"mlfqs-load-avg", test_mlfqs_load_avg},
-    // {"mlfqs-recent-1", test_mlfqs_recent_1},
-    // {"mlfqs-fair-2", test_mlfqs_fair_2},
-    // {"mlfqs-fair-20", test_mlfqs_fair_20},
-    // {"mlfqs-nice-2", test_mlfqs_nice_2},
-    // {"mlfqs-nice-10", test_mlfqs_nice_10},
-    // {"mlfqs-block", test_mlfqs_block},
+    {"wait-timeout", test_wait_timeout},
+    {"edf-basic", test_edf_basic},
+    {"cfs-nice", test_cfs_nice},
+    {"switch-pingpong", test_switch_pingpong},
+    {"workpool", test_workpool},
+    {"malloc-bench", test_malloc_bench},
+    {"kmem-cache", test_kmem_cache},
+    {"palloc-buddy", test_palloc_buddy},
+    {"palloc-zero", test_palloc_zero},
+    {"priority-donate-rwlock", test_priority_donate_rwlock},
+    {"mlfqs-load-1", test_mlfqs_load_1},
+    {"mlfqs-load-60", test_mlfqs_load_60},
+    {"mlfqs-load-avg", test_mlfqs_load_avg},
+    {"mlfqs-recent-1", test_mlfqs_recent_1},
+    {"mlfqs-fair-2", test_mlfqs_fair_2},
+    {"mlfqs-fair-20", test_mlfqs_fair_20},
+    {"mlfqs-nice-2", test_mlfqs_nice_2},
+    {"mlfqs-nice-10", test_mlfqs_nice_10},
+    {"mlfqs-block", test_mlfqs_block},
   };
 
 static const char *test_name;
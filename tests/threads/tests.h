@@ -11,6 +11,7 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_hires;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -19,19 +20,30 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_stress;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
-// extern test_func test_mlfqs_load_1;
-// extern test_func test_mlfqs_load_60;
-// extern test_func test_mlfqs_load_avg;
-// extern test_func test_mlfqs_recent_1;
-// extern test_func test_mlfqs_fair_2;
-// extern test_func test_mlfqs_fair_20;
-// extern test_func test_mlfqs_nice_2;
-// extern test_func test_mlfqs_nice_10;
-// extern test_func test_mlfqs_block;
+extern test_func test_wait_timeout;
+extern test_func test_edf_basic;
+extern test_func test_cfs_nice;
+extern test_func test_switch_pingpong;
+extern test_func test_workpool;
+extern test_func test_malloc_bench;
+extern test_func test_kmem_cache;
+extern test_func test_palloc_buddy;
+extern test_func test_palloc_zero;
+extern test_func test_priority_donate_rwlock;
+extern test_func test_mlfqs_load_1;
+extern test_func test_mlfqs_load_60;
+extern test_func test_mlfqs_load_avg;
+extern test_func test_mlfqs_recent_1;
+extern test_func test_mlfqs_fair_2;
+extern test_func test_mlfqs_fair_20;
+extern test_func test_mlfqs_nice_2;
+extern test_func test_mlfqs_nice_10;
+extern test_func test_mlfqs_block;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,94 @@
+/* Checks the timed waits: sema_down_timeout(),
+   lock_acquire_timeout() and cond_wait_timeout().  Each is made
+   to time out once and to succeed once.  A thread whose
+   lock_acquire_timeout() times out must also take back the
+   priority it donated to the lock's holder. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static struct semaphore sema;
+static struct semaphore done;
+static struct lock lock;
+static struct condition cond;
+
+static thread_func waiter_thread;
+static thread_func signaler_thread;
+
+void
+test_wait_timeout (void)
+{
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&sema, 0);
+  sema_init (&done, 0);
+  lock_init (&lock);
+  cond_init (&cond);
+
+  start = timer_ticks ();
+  if (sema_down_timeout (&sema, 10))
+    fail ("sema_down_timeout() on a zero semaphore succeeded.");
+  if (timer_elapsed (start) < 10)
+    fail ("sema_down_timeout() gave up after %"PRId64" ticks, "
+          "not 10.", timer_elapsed (start));
+  msg ("Semaphore wait timed out.");
+  sema_up (&sema);
+  if (!sema_down_timeout (&sema, 10))
+    fail ("sema_down_timeout() on a positive semaphore failed.");
+  msg ("Semaphore wait succeeded.");
+
+  lock_acquire (&lock);
+  thread_create ("waiter", PRI_DEFAULT + 5, waiter_thread, NULL);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  timer_sleep (20);
+  sema_down (&done);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+
+  if (cond_wait_timeout (&cond, &lock, 10))
+    fail ("cond_wait_timeout() was signaled with no signaler.");
+  if (!lock_held_by_current_thread (&lock))
+    fail ("cond_wait_timeout() returned without the lock.");
+  msg ("Condition wait timed out, lock held.");
+
+  thread_create ("signaler", PRI_DEFAULT + 1, signaler_thread, NULL);
+  if (!cond_wait_timeout (&cond, &lock, 1000))
+    fail ("cond_wait_timeout() timed out despite a signal.");
+  if (!lock_held_by_current_thread (&lock))
+    fail ("cond_wait_timeout() returned without the lock.");
+  msg ("Condition wait signaled, lock held.");
+  lock_release (&lock);
+  sema_down (&done);
+}
+
+static void
+waiter_thread (void *aux UNUSED)
+{
+  if (lock_acquire_timeout (&lock, 10))
+    fail ("lock_acquire_timeout() got a lock that was never released.");
+  msg ("Waiter timed out.");
+  sema_up (&done);
+}
+
+static void
+signaler_thread (void *aux UNUSED)
+{
+  timer_sleep (5);
+  lock_acquire (&lock);
+  cond_signal (&cond, &lock);
+  msg ("Signaler signaled.");
+  lock_release (&lock);
+  sema_up (&done);
+}
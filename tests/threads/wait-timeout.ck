@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(wait-timeout) begin
+(wait-timeout) Semaphore wait timed out.
+(wait-timeout) Semaphore wait succeeded.
+(wait-timeout) Main thread should have priority 36.  Actual priority: 36.
+(wait-timeout) Waiter timed out.
+(wait-timeout) Main thread should have priority 31.  Actual priority: 31.
+(wait-timeout) Condition wait timed out, lock held.
+(wait-timeout) Signaler signaled.
+(wait-timeout) Condition wait signaled, lock held.
+(wait-timeout) end
+EOF
+pass;
@@ -0,0 +1,163 @@
+/* Checks the kernel worker pool.
+
+   First, a job that splits a range of numbers in halves, each
+   half submitted as new work by the work that split it, until
+   the pieces are small enough to sum.  workpool_flush() must not
+   return before every piece has been summed.
+
+   Then every worker is kept busy with work that blocks, so that
+   work submitted meanwhile stays queued.  Submitting pending
+   work again must fail, and once one worker is let go, it must
+   run priority work before the work submitted ahead of it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workpool.h"
+
+/* Numbers to sum and the size of the pieces that are summed
+   without splitting further. */
+#define RANGE 1024
+#define LEAF_SIZE 16
+
+/* A piece of the range, [lo, hi).  Node I of the tree of
+   pieces is split into nodes 2I + 1 and 2I + 2. */
+struct piece {
+  struct work work;
+  int lo, hi;
+};
+
+static struct piece pieces[2 * RANGE / LEAF_SIZE - 1];
+static long long sum;
+static int leaf_cnt;
+
+/* Protects the results above and below, which workers on
+   several CPUs update. */
+static struct spinlock result_lock;
+
+static struct semaphore started, gate;
+static char order[4];
+static int order_cnt;
+
+static work_func split_work;
+static work_func block_work;
+static work_func record_work;
+
+void
+test_workpool (void)
+{
+  struct work a, b, p;
+  struct work *blockers;
+  int i, n;
+
+  spin_init (&result_lock);
+  pieces[0].lo = 0;
+  pieces[0].hi = RANGE;
+  work_init (&pieces[0].work, split_work, &pieces[0]);
+  work_submit (&pieces[0].work);
+  workpool_flush ();
+  if (sum != (long long) RANGE * (RANGE - 1) / 2)
+    fail ("Sum is %lld, not %lld.", sum, (long long) RANGE * (RANGE - 1) / 2);
+  if (leaf_cnt != RANGE / LEAF_SIZE)
+    fail ("Summed %d pieces, not %d.", leaf_cnt, RANGE / LEAF_SIZE);
+  msg ("Split work summed %d pieces.", leaf_cnt);
+
+  /* Occupy every worker. */
+  n = workpool_size ();
+  sema_init (&started, 0);
+  sema_init (&gate, 0);
+  blockers = calloc (n, sizeof *blockers);
+  ASSERT (blockers != NULL);
+  for (i = 0; i < n; i++)
+    {
+      work_init (&blockers[i], block_work, NULL);
+      work_submit (&blockers[i]);
+    }
+  for (i = 0; i < n; i++)
+    sema_down (&started);
+  msg ("All workers busy.");
+
+  work_init (&a, record_work, "a");
+  work_init (&b, record_work, "b");
+  work_init (&p, record_work, "p");
+  if (!work_submit (&a) || !work_submit (&b))
+    fail ("Submitting idle work failed.");
+  if (work_submit (&a))
+    fail ("Submitting pending work succeeded.");
+  msg ("Pending work not submitted twice.");
+  work_submit_priority (&p);
+
+  sema_up (&gate);
+  work_flush (&b);
+  if (order_cnt != 3)
+    fail ("Ran %d of 3 works.", order_cnt);
+  order[order_cnt] = '\0';
+  msg ("Work ran in order: %s.", order);
+
+  for (i = 1; i < n; i++)
+    sema_up (&gate);
+  workpool_flush ();
+  free (blockers);
+}
+
+/* Sums the piece AUX, or submits its halves. */
+static void
+split_work (void *aux)
+{
+  struct piece *piece = aux;
+  int idx = piece - pieces;
+  enum intr_level old_level;
+  long long piece_sum = 0;
+  int i;
+
+  if (piece->hi - piece->lo > LEAF_SIZE)
+    {
+      int mid = piece->lo + (piece->hi - piece->lo) / 2;
+      struct piece *left = &pieces[2 * idx + 1];
+      struct piece *right = &pieces[2 * idx + 2];
+
+      left->lo = piece->lo;
+      left->hi = mid;
+      right->lo = mid;
+      right->hi = piece->hi;
+      work_init (&left->work, split_work, left);
+      work_init (&right->work, split_work, right);
+      work_submit (&left->work);
+      work_submit (&right->work);
+      return;
+    }
+
+  for (i = piece->lo; i < piece->hi; i++)
+    piece_sum += i;
+  old_level = intr_disable ();
+  spin_lock (&result_lock);
+  sum += piece_sum;
+  leaf_cnt++;
+  spin_unlock (&result_lock);
+  intr_set_level (old_level);
+}
+
+/* Keeps a worker busy until the gate opens. */
+static void
+block_work (void *aux UNUSED)
+{
+  sema_up (&started);
+  sema_down (&gate);
+}
+
+/* Records that the work named AUX ran. */
+static void
+record_work (void *aux)
+{
+  const char *name = aux;
+  enum intr_level old_level = intr_disable ();
+
+  spin_lock (&result_lock);
+  order[order_cnt++] = name[0];
+  spin_unlock (&result_lock);
+  intr_set_level (old_level);
+}
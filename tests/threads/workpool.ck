@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workpool) begin
+(workpool) Split work summed 64 pieces.
+(workpool) All workers busy.
+(workpool) Pending work not submitted twice.
+(workpool) Work ran in order: pab.
+(workpool) end
+EOF
+pass;
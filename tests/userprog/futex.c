@@ -0,0 +1,51 @@
+/* Checks the futex system calls and the user-level mutex and
+   condition variable built on them, as far as one thread can:
+   futex_wait() must return at once if the futex no longer holds
+   the expected value, futex_wake() must report how many it woke,
+   both must reject bad addresses, and the mutex and condition
+   variable must only enter the kernel when someone may be
+   waiting. */
+
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int word;
+static struct mutex m = MUTEX_INITIALIZER;
+static struct condvar cv = CONDVAR_INITIALIZER;
+
+void
+test_main (void)
+{
+  word = 5;
+  CHECK (futex_wait (&word, 6) == -1,
+         "futex_wait on a changed value returns at once");
+  CHECK (futex_wake (&word, 1) == 0, "futex_wake with no waiters wakes none");
+  CHECK (futex_wait (NULL, 0) == -1, "futex_wait rejects a null pointer");
+  CHECK (futex_wait ((int *) 0x8004000000, 0) == -1,
+         "futex_wait rejects a kernel address");
+  CHECK (futex_wake ((int *) ((char *) &word + 1), 1) == -1,
+         "futex_wake rejects a misaligned address");
+
+  CHECK (mutex_trylock (&m), "trylock a free mutex");
+  CHECK (m.state == MUTEX_LOCKED, "held mutex is locked, not contended");
+  CHECK (!mutex_trylock (&m), "trylock a held mutex fails");
+  mutex_unlock (&m);
+  CHECK (m.state == MUTEX_UNLOCKED, "unlocked mutex is free");
+  mutex_lock (&m);
+  CHECK (m.state == MUTEX_LOCKED, "uncontended lock takes the fast path");
+
+  /* Unlocking a contended mutex wakes nobody, since nobody
+     sleeps, but must still leave it free. */
+  m.state = MUTEX_CONTENDED;
+  mutex_unlock (&m);
+  CHECK (m.state == MUTEX_UNLOCKED, "contended unlock frees the mutex");
+
+  mutex_lock (&m);
+  condvar_signal (&cv);
+  condvar_broadcast (&cv);
+  CHECK (cv.seq == 2 && cv.waiters == 0,
+         "signal and broadcast bump the sequence number");
+  mutex_unlock (&m);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex) begin
+(futex) futex_wait on a changed value returns at once
+(futex) futex_wake with no waiters wakes none
+(futex) futex_wait rejects a null pointer
+(futex) futex_wait rejects a kernel address
+(futex) futex_wake rejects a misaligned address
+(futex) trylock a free mutex
+(futex) held mutex is locked, not contended
+(futex) trylock a held mutex fails
+(futex) unlocked mutex is free
+(futex) uncontended lock takes the fast path
+(futex) contended unlock frees the mutex
+(futex) signal and broadcast bump the sequence number
+(futex) end
+futex: exit(0)
+EOF
+pass;
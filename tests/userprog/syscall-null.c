@@ -0,0 +1,35 @@
+/* Measures the round-trip latency of a system call that does no
+   work, getpid(), which takes the fast system call path. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALLS 100000
+
+/* Reads the time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+void
+test_main (void)
+{
+  pid_t pid = getpid ();
+  uint64_t start, cycles;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < CALLS; i++)
+    if (getpid () != pid)
+      fail ("getpid() returned %d, then %d.", pid, getpid ());
+  cycles = rdtsc () - start;
+
+  msg ("getpid() returned the same pid %d times.", CALLS);
+  msg ("%llu cycles per call.", (unsigned long long) (cycles / CALLS));
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+
+# Timings vary from run to run, so mask them before comparing.
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+s/ \d+ cycles per call\.$/ <cycles> cycles per call./ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(syscall-null) begin
+(syscall-null) getpid() returned the same pid 100000 times.
+(syscall-null) <cycles> cycles per call.
+(syscall-null) end
+syscall-null: exit(0)
+EOF
+pass;
@@ -0,0 +1,299 @@
+#include "threads/cpu.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/loader.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/syscall.h"
+#include "userprog/tss.h"
+#endif
+
+/* Every CPU that was found, the bootstrap processor first. */
+struct cpu cpus[CPU_MAX];
+int cpu_cnt = 1;
+
+/* True once application processors may be running.  Until then
+   this_cpu() need not look at the running thread, which may not
+   be set up yet. */
+bool smp_active;
+
+/* MultiProcessor Specification structures.  See the
+   MultiProcessor Specification, version 1.4, chapter 4. */
+struct mp_fptr {
+	char signature[4];          /* "_MP_". */
+	uint32_t conf_addr;         /* Physical address of struct mp_conf. */
+	uint8_t length;             /* Length in 16-byte units. */
+	uint8_t revision;
+	uint8_t checksum;           /* All bytes must add up to 0. */
+	uint8_t type;               /* Default configuration, if nonzero. */
+	uint8_t imcrp;              /* Bit 7: IMCR present, PIC mode. */
+	uint8_t reserved[3];
+} __attribute__((packed));
+
+struct mp_conf {
+	char signature[4];          /* "PCMP". */
+	uint16_t length;            /* Length of table, header included. */
+	uint8_t revision;
+	uint8_t checksum;           /* All bytes must add up to 0. */
+	char product[20];
+	uint32_t oem_table;
+	uint16_t oem_length;
+	uint16_t entry_cnt;         /* Number of entries after the header. */
+	uint32_t lapic_addr;        /* Physical address of local APICs. */
+	uint16_t ext_length;
+	uint8_t ext_checksum;
+	uint8_t reserved;
+} __attribute__((packed));
+
+/* Processor entry, the only entry type we care about. */
+#define MP_PROC 0
+struct mp_proc {
+	uint8_t type;               /* MP_PROC. */
+	uint8_t apic_id;            /* Local APIC ID. */
+	uint8_t apic_version;
+	uint8_t flags;              /* MP_PROC_* below. */
+	uint32_t signature;
+	uint32_t features;
+	uint8_t reserved[8];
+} __attribute__((packed));
+#define MP_PROC_ENABLED 0x01    /* Usable. */
+#define MP_PROC_BSP 0x02        /* Bootstrap processor. */
+
+/* Every other entry type is 8 bytes long. */
+#define MP_ENTRY_SIZE 8
+
+/* Parameters for an application processor, read by the startup
+   code in ap-start.S. */
+struct ap_boot {
+	uint64_t boot_cr3;          /* Physical address of boot_pml4e. */
+	uint64_t kern_cr3;          /* Physical address of base_pml4. */
+	uint64_t stack;             /* Initial stack pointer. */
+};
+
+/* In ap-start.S. */
+extern char ap_trampoline[], ap_trampoline_end[], ap_boot[];
+extern char boot_pml4e[];
+
+/* GDT loaded by the bootstrap processor, for the others to share
+   in kernels without user programs. */
+static struct desc_ptr gdt_desc;
+
+static struct mp_conf *mp_probe (void);
+static struct mp_fptr *mp_search (uint64_t pa, size_t len);
+static uint8_t sum (const void *, size_t);
+static bool start_ap (struct cpu *);
+void ap_main (void) NO_RETURN;
+
+/* Initializes C as CPU number ID. */
+void
+cpu_init (struct cpu *c, int id) {
+	memset (c, 0, sizeof *c);
+	c->id = id;
+	for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+		list_init (&c->ready_list[pri]);
+	heap_init (&c->edf_ready, thread_deadline_less, NULL);
+	rb_init (&c->cfs_ready, thread_vruntime_less, NULL);
+	spin_init (&c->rq_lock);
+}
+
+/* Returns the CPU the running thread is on.  This is only stable
+   while interrupts are off; with interrupts on, the thread could
+   be preempted and resumed on another CPU at any point. */
+struct cpu *
+this_cpu (void) {
+	if (!smp_active)
+		return &cpus[0];
+	return ((struct thread *) pg_round_down (rrsp ()))->cpu;
+}
+
+/* Finds the other CPUs from the BIOS's MultiProcessor
+   Specification tables and starts them.  Must be called with
+   interrupts on, after the timer has been calibrated.  Leaves
+   the system uniprocessor if no tables are found. */
+void
+smp_init (void) {
+	struct mp_conf *conf = mp_probe ();
+	struct ap_boot *boot;
+	int started;
+
+	ASSERT (intr_get_level () == INTR_ON);
+
+	if (conf == NULL || cpu_cnt == 1)
+		return;
+
+	lapic_map (conf->lapic_addr);
+	lapic_init (true);
+	cpus[0].lapic_id = lapic_id ();
+
+	/* Tickless idle reprograms the 8254, which would stop time
+	   slicing on the bootstrap processor while other CPUs keep
+	   the system busy. */
+	if (timer_tickless) {
+		printf ("SMP: tickless idle disabled.\n");
+		timer_tickless = false;
+	}
+
+	printf ("Starting %d application processors...  ", cpu_cnt - 1);
+	lapic_timer_calibrate ();
+	timer_hr_use_lapic ();
+
+	/* Install the startup code. */
+	memcpy (ptov (LOADER_AP_START), ap_trampoline,
+			ap_trampoline_end - ap_trampoline);
+	boot = ptov (LOADER_AP_START + (ap_boot - ap_trampoline));
+	boot->boot_cr3 = vtop (boot_pml4e);
+	boot->kern_cr3 = vtop (base_pml4);
+	asm volatile ("sgdt %0" : "=m" (gdt_desc));
+
+	smp_active = true;
+
+	started = 1;
+	for (int i = 1; i < cpu_cnt; i++)
+		if (start_ap (&cpus[i]))
+			started++;
+	printf ("%d CPUs online.\n", started);
+}
+
+/* Starts application processor C and waits up to 100 ms for it
+   to enter its idle loop.  Returns true if it did. */
+static bool
+start_ap (struct cpu *c) {
+	struct ap_boot *boot = ptov (LOADER_AP_START + (ap_boot - ap_trampoline));
+	void *stack = thread_ap_prepare (c);
+
+	if (stack == NULL)
+		return false;
+	boot->stack = (uint64_t) stack;
+
+	lapic_start_ap (c->lapic_id, LOADER_AP_START);
+	for (int i = 0; i < 10 && !c->started; i++)
+		timer_msleep (10);
+	if (!c->started)
+		printf ("(CPU %d did not start) ", c->id);
+	return c->started;
+}
+
+/* C entry point for application processors, called by ap_entry
+   in ap-start.S on the stack of the CPU's idle thread, with the
+   kernel page table loaded and interrupts off. */
+void
+ap_main (void) {
+#ifdef USERPROG
+	/* User processes run on every CPU, so each needs its own TSS,
+	   a GDT that describes it, and its own syscall MSRs. */
+	tss_init ();
+	gdt_init ();
+	ltr (SEL_TSS);
+	syscall_init_ap ();
+#else
+	/* Switch to the kernel's descriptor tables.  Reloading CS
+	   takes a far return. */
+	lgdt (&gdt_desc);
+	asm volatile("movw %%ax, %%fs" :: "a" (0));
+	asm volatile("movw %%ax, %%gs" :: "a" (0));
+	asm volatile("movw %%ax, %%es" :: "a" (SEL_KDSEG));
+	asm volatile("movw %%ax, %%ds" :: "a" (SEL_KDSEG));
+	asm volatile("movw %%ax, %%ss" :: "a" (SEL_KDSEG));
+	asm volatile("pushq %%rbx\n"
+			"movabs $1f, %%rax\n"
+			"pushq %%rax\n"
+			"lretq\n"
+			"1:\n" :: "b" (SEL_KCSEG) : "rax", "cc", "memory");
+#endif
+	intr_init_ap ();
+
+	lapic_init (false);
+	lapic_timer_start ();
+	thread_ap_main ();
+}
+
+/* Looks for the MultiProcessor Specification configuration
+   table, and fills in cpus[] and cpu_cnt from it.  Returns the
+   table, or a null pointer if there is none. */
+static struct mp_conf *
+mp_probe (void) {
+	struct mp_fptr *fptr;
+	struct mp_conf *conf;
+	uint8_t *p, *end;
+	uint16_t ebda;
+
+	/* The floating pointer is in the first KB of the extended
+	   BIOS data area, in the last KB of base memory, or in the
+	   BIOS ROM. */
+	ebda = *(uint16_t *) ptov (0x40e);
+	fptr = mp_search ((uint64_t) ebda << 4, 1024);
+	if (fptr == NULL)
+		fptr = mp_search (0x9fc00, 1024);
+	if (fptr == NULL)
+		fptr = mp_search (0xf0000, 0x10000);
+	if (fptr == NULL || fptr->conf_addr == 0)
+		return NULL;
+
+	conf = ptov (fptr->conf_addr);
+	if (memcmp (conf->signature, "PCMP", 4)
+			|| sum (conf, conf->length) != 0)
+		return NULL;
+
+	/* Bootstrap processor first, then the rest in table order. */
+	cpu_cnt = 1;
+	p = (uint8_t *) (conf + 1);
+	end = (uint8_t *) conf + conf->length;
+	while (p < end) {
+		struct mp_proc *proc = (struct mp_proc *) p;
+
+		if (proc->type != MP_PROC) {
+			p += MP_ENTRY_SIZE;
+			continue;
+		}
+		if (proc->flags & MP_PROC_BSP)
+			cpus[0].lapic_id = proc->apic_id;
+		else if ((proc->flags & MP_PROC_ENABLED) && cpu_cnt < CPU_MAX) {
+			cpu_init (&cpus[cpu_cnt], cpu_cnt);
+			cpus[cpu_cnt].lapic_id = proc->apic_id;
+			cpu_cnt++;
+		}
+		p += sizeof *proc;
+	}
+
+	/* If the PICs are wired straight to the bootstrap processor,
+	   route them through its local APIC instead.  See the
+	   MultiProcessor Specification, section 3.6.2.1. */
+	if (fptr->imcrp & 0x80) {
+		outb (0x22, 0x70);
+		outb (0x23, inb (0x23) | 1);
+	}
+	return conf;
+}
+
+/* Searches LEN bytes at physical address PA for an MP floating
+   pointer structure. */
+static struct mp_fptr *
+mp_search (uint64_t pa, size_t len) {
+	uint8_t *p = ptov (pa);
+	uint8_t *end = p + len;
+
+	for (; p + sizeof (struct mp_fptr) <= end; p += 16)
+		if (!memcmp (p, "_MP_", 4) && sum (p, sizeof (struct mp_fptr)) == 0)
+			return (struct mp_fptr *) p;
+	return NULL;
+}
+
+/* Returns the byte-wise sum of the LEN bytes at P. */
+static uint8_t
+sum (const void *p_, size_t len) {
+	const uint8_t *p = p_;
+	uint8_t s = 0;
+
+	while (len-- > 0)
+		s += *p++;
+	return s;
+}
@@ -3,12 +3,17 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/softirq.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
@@ -93,15 +98,71 @@ static intr_handler_func *intr_handlers[INTR_CNT];
 /* Names for each interrupt, for debugging purposes. */
 static const char *intr_names[INTR_CNT];
 
+/* Number of times each external interrupt was handled, and TSC
+   cycles spent in its handler. */
+static long long intr_counts[INTR_CNT];
+static uint64_t intr_cycles[INTR_CNT];
+
 /* External interrupts are those generated by devices outside the
    CPU, such as the timer.  External interrupts run with
    interrupts turned off, so they never nest, nor are they ever
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   interrupt returns.  Whether a CPU is processing an external
+   interrupt, and whether it should yield on return, is tracked
+   per CPU in struct cpu.  Work that need not be done with
+   interrupts off is deferred to a softirq (see softirq.h).
+
+   Besides the PICs' vectors, the local APIC's vectors at
+   LAPIC_TIMER_VEC and up are external interrupts. */
+#define is_external(vec) \
+	(((vec) >= 0x20 && (vec) < 0x30) || (vec) >= LAPIC_TIMER_VEC)
+
+/* Interrupts-off latency tracing.
+
+   With -irqsoff, each CPU times every span during which it has
+   interrupts off, from the intr_disable() or interrupt entry that
+   starts it to the intr_enable(), interrupt return, or return to
+   user mode that ends it.  A span may start in one thread and end
+   in another, across a thread switch.  Spans are tallied by the
+   pair of code addresses that started and ended them, the
+   callers of intr_disable() and intr_enable() or the interrupted
+   instruction, and in a histogram by length.  The tallies are
+   shared by every CPU, under irqsoff_lock. */
+bool intr_tracing;
+
+/* Start and end address pairs tallied.  Spans of further pairs
+   are only counted in the histogram. */
+#define IRQSOFF_SITES 128
+
+/* Number of pairs reported at exit. */
+#define IRQSOFF_TOP 10
+
+/* Histogram buckets.  Bucket N counts spans of 2**N to
+   2**(N+1) - 1 TSC cycles. */
+#define IRQSOFF_BUCKETS 40
+
+/* Spans with the same start and end addresses. */
+struct irqsoff_site {
+	const void *start_ip;       /* Where interrupts went off, or NULL. */
+	const void *end_ip;         /* Where they came back on. */
+	uint64_t cnt;               /* Number of spans. */
+	uint64_t cycles;            /* Total length, in TSC cycles. */
+	uint64_t max_cycles;        /* Longest span. */
+};
+
+static struct irqsoff_site irqsoff_sites[IRQSOFF_SITES];
+static uint64_t irqsoff_hist[IRQSOFF_BUCKETS];
+static uint64_t irqsoff_untracked;  /* Spans of pairs that did not fit. */
+static struct spinlock irqsoff_lock;
+
+static void irqsoff_begin (const void *ip);
+static void irqsoff_end (const void *ip);
+static void irqsoff_print_stats (void);
+
+static enum intr_level intr_enable_at (const void *ip);
+static enum intr_level intr_disable_at (const void *ip);
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
@@ -128,14 +189,32 @@ intr_get_level (void) {
    returns the previous interrupt status. */
 enum intr_level
 intr_set_level (enum intr_level level) {
-	return level == INTR_ON ? intr_enable () : intr_disable ();
+	const void *ip = __builtin_return_address (0);
+
+	return level == INTR_ON ? intr_enable_at (ip) : intr_disable_at (ip);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void) {
+	return intr_enable_at (__builtin_return_address (0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable (void) {
+	return intr_disable_at (__builtin_return_address (0));
+}
+
+/* Enables interrupts on behalf of the caller at IP, for tracing,
+   and returns the previous interrupt status. */
+static enum intr_level
+intr_enable_at (const void *ip) {
 	enum intr_level old_level = intr_get_level ();
-	ASSERT (!intr_context ());
+	ASSERT (!this_cpu ()->in_external_intr);
+
+	if (old_level == INTR_OFF && intr_tracing)
+		irqsoff_end (ip);
 
 	/* Enable interrupts by setting the interrupt flag.
 
@@ -147,8 +226,8 @@ intr_enable (void) {
 }
 
 /* 인터럽트를 비활성화하고 이전의 인터럽트 상태를 반환합니다, 이는 인터럽트 상태를 임시로 변경한 후, 원래 상태로 복원하는데 필요할 때 유용하게 사용됩니다. */
-enum intr_level
-intr_disable (void) {
+static enum intr_level
+intr_disable_at (const void *ip) {
 	enum intr_level old_level = intr_get_level ();
 
 	/* Disable interrupts by clearing the interrupt flag.
@@ -156,9 +235,37 @@ intr_disable (void) {
 	   Hardware Interrupts". */
 	asm volatile ("cli" : : : "memory");
 
+	if (old_level == INTR_ON && intr_tracing)
+		irqsoff_begin (ip);
+
 	return old_level;
 }
 
+/* Ends the interrupts-off span being traced ahead of an
+   instruction that turns interrupts back on by itself, such as
+   an iretq to user mode.  Interrupts must stay off until then. */
+void
+intr_trace_end (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (intr_tracing)
+		irqsoff_end (__builtin_return_address (0));
+}
+
+/* Atomically enables interrupts and waits for the next one.
+
+   The `sti' instruction disables interrupts until the
+   completion of the next instruction, so `sti; hlt' is executed
+   atomically and no interrupt can slip in between.  See
+   [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a] 7.11.1
+   "HLT Instruction". */
+void
+intr_halt (void) {
+	if (intr_tracing)
+		irqsoff_end (__builtin_return_address (0));
+	asm volatile ("sti; hlt" : : : "memory");
+}
+
 /* Initializes the interrupt system. */
 void
 intr_init (void) {
@@ -166,6 +273,7 @@ intr_init (void) {
 
 	/* Initialize interrupt controller. */
 	pic_init ();
+	spin_init (&irqsoff_lock);
 
 	/* Initialize IDT. */
 	for (i = 0; i < INTR_CNT; i++) {
@@ -203,6 +311,12 @@ intr_init (void) {
 	intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Loads the IDT on an application processor. */
+void
+intr_init_ap (void) {
+	lidt (&idt_desc);
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -227,7 +341,7 @@ register_handler (uint8_t vec_no, int dpl, enum intr_level level,
 void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
 		const char *name) {
-	ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+	ASSERT (is_external (vec_no));
 	register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -248,25 +362,27 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 		intr_handler_func *handler, const char *name)
 {
-	ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+	ASSERT (!is_external (vec_no));
 	register_handler (vec_no, dpl, level, handler, name);
 }
 
-/* Returns true during processing of an external interrupt
-   and false at all other times. */
+/* Returns true during processing of an external interrupt or of
+   the softirqs it raised, and false at all other times. */
 bool
 intr_context (void) {
-	return in_external_intr;
+	struct cpu *c = this_cpu ();
+
+	return c->in_external_intr || c->in_softirq;
 }
 
-/* During processing of an external interrupt, directs the
-   interrupt handler to yield to a new process just before
-   returning from the interrupt.  May not be called at any other
-   time. */
+/* During processing of an external interrupt or a softirq,
+   directs the interrupt handler to yield to a new process just
+   before returning from the interrupt.  May not be called at any
+   other time. */
 void
 intr_yield_on_return (void) {
 	ASSERT (intr_context ());
-	yield_on_return = true;
+	this_cpu ()->yield_on_return = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -332,25 +448,40 @@ void
 intr_handler (struct intr_frame *frame) {
 	bool external;
 	intr_handler_func *handler;
+	uint64_t start = 0;
+	struct cpu *c;
+
+	if (intr_tracing && (frame->eflags & FLAG_IF))
+		irqsoff_begin ((const void *) frame->rip);
 
 	/* External interrupts are special.
 	   We only handle one at a time (so interrupts must be off)
 	   and they need to be acknowledged on the PIC (see below).
 	   An external interrupt handler cannot sleep. */
-	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+	external = is_external (frame->vec_no);
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
-		ASSERT (!intr_context ());
 
-		in_external_intr = true;
-		yield_on_return = false;
+		c = this_cpu ();
+		ASSERT (!c->in_external_intr);
+		c->in_external_intr = true;
+
+		/* An interrupt during softirqs leaves any pending yield to
+		   the interrupt that ran them. */
+		if (!c->in_softirq)
+			c->yield_on_return = false;
+		start = rdtsc ();
+
+		/* Leave tickless idle before anything looks at the time. */
+		timer_idle_exit ();
 	}
 
 	/* Invoke the interrupt's handler. */
 	handler = intr_handlers[frame->vec_no];
 	if (handler != NULL)
 		handler (frame);
-	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
+	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+			|| frame->vec_no == LAPIC_SPURIOUS_VEC) {
 		/* There is no handler, but this interrupt can trigger
 		   spuriously due to a hardware fault or hardware race
 		   condition.  Ignore it. */
@@ -366,12 +497,148 @@ intr_handler (struct intr_frame *frame) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (intr_context ());
 
-		in_external_intr = false;
-		pic_end_of_interrupt (frame->vec_no);
-
-		if (yield_on_return)
+		c = this_cpu ();
+		__atomic_fetch_add (&intr_counts[frame->vec_no], 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add (&intr_cycles[frame->vec_no], rdtsc () - start,
+				__ATOMIC_RELAXED);
+		c->in_external_intr = false;
+		if (frame->vec_no < 0x30)
+			pic_end_of_interrupt (frame->vec_no);
+		else if (frame->vec_no != LAPIC_SPURIOUS_VEC)
+			lapic_eoi ();
+
+		/* Run deferred work with interrupts back on, unless the
+		   interrupted code had them off. */
+		if (frame->eflags & FLAG_IF)
+			softirq_run ();
+
+		if (c->yield_on_return && !c->in_softirq)
 			thread_yield ();
 	}
+
+	/* iretq turns interrupts back on if they were on before. */
+	if (intr_tracing && (frame->eflags & FLAG_IF))
+		irqsoff_end ((const void *) frame->rip);
+}
+
+/* Prints how often each external interrupt was handled and the
+   time spent in its handler, not counting softirqs. */
+void
+intr_print_stats (void) {
+	for (int vec = 0; vec < INTR_CNT; vec++)
+		if (intr_counts[vec] > 0)
+			printf ("Interrupt: %#04x (%s): %lld handled, %"PRIu64" us\n",
+					vec, intr_names[vec], intr_counts[vec],
+					timer_cycles_to_us (intr_cycles[vec]));
+	if (intr_tracing)
+		irqsoff_print_stats ();
+}
+
+/* Starts timing an interrupts-off span on the running CPU,
+   which begins at IP.  Interrupts must be off. */
+static void
+irqsoff_begin (const void *ip) {
+	struct cpu *c = this_cpu ();
+
+	c->irqsoff_start = rdtsc ();
+	c->irqsoff_ip = ip;
+}
+
+/* Ends the running CPU's interrupts-off span, if one is being
+   timed, at IP, and tallies it.  Interrupts must be off. */
+static void
+irqsoff_end (const void *ip) {
+	struct cpu *c = this_cpu ();
+	uint64_t cycles;
+	size_t h, i;
+	int b;
+
+	if (c->irqsoff_start == 0)
+		return;
+	cycles = rdtsc () - c->irqsoff_start;
+	c->irqsoff_start = 0;
+
+	b = cycles != 0 ? 63 - __builtin_clzll (cycles) : 0;
+	spin_lock (&irqsoff_lock);
+	irqsoff_hist[b < IRQSOFF_BUCKETS ? b : IRQSOFF_BUCKETS - 1]++;
+
+	/* Find the pair's site by open addressing. */
+	h = ((uintptr_t) c->irqsoff_ip ^ ((uintptr_t) ip * 31)) % IRQSOFF_SITES;
+	for (i = 0; i < IRQSOFF_SITES; i++) {
+		struct irqsoff_site *site = &irqsoff_sites[(h + i) % IRQSOFF_SITES];
+
+		if (site->start_ip == NULL) {
+			site->start_ip = c->irqsoff_ip;
+			site->end_ip = ip;
+		} else if (site->start_ip != c->irqsoff_ip || site->end_ip != ip)
+			continue;
+		site->cnt++;
+		site->cycles += cycles;
+		if (cycles > site->max_cycles)
+			site->max_cycles = cycles;
+		spin_unlock (&irqsoff_lock);
+		return;
+	}
+	irqsoff_untracked++;
+	spin_unlock (&irqsoff_lock);
+}
+
+/* Prints the histogram of interrupts-off spans and the
+   IRQSOFF_TOP start and end pairs with the longest spans.  The
+   addresses can be passed to the `backtrace' program. */
+static void
+irqsoff_print_stats (void) {
+	struct irqsoff_site top[IRQSOFF_TOP];
+	uint64_t hist[IRQSOFF_BUCKETS];
+	uint64_t untracked;
+	enum intr_level old_level;
+	int cnt = 0;
+
+	/* Copy out first, since printing turns interrupts off and so
+	   updates the tallies. */
+	old_level = intr_disable ();
+	spin_lock (&irqsoff_lock);
+	for (int s = 0; s < IRQSOFF_SITES; s++) {
+		const struct irqsoff_site *site = &irqsoff_sites[s];
+		int i;
+
+		if (site->start_ip == NULL)
+			continue;
+		for (i = cnt; i > 0 && top[i - 1].max_cycles < site->max_cycles; i--)
+			if (i < IRQSOFF_TOP)
+				top[i] = top[i - 1];
+		if (i < IRQSOFF_TOP) {
+			top[i] = *site;
+			if (cnt < IRQSOFF_TOP)
+				cnt++;
+		}
+	}
+	memcpy (hist, irqsoff_hist, sizeof hist);
+	untracked = irqsoff_untracked;
+	spin_unlock (&irqsoff_lock);
+	intr_set_level (old_level);
+
+	/* Buckets too short to tell apart in microseconds are merged. */
+	for (int b = 0; b < IRQSOFF_BUCKETS; ) {
+		uint64_t limit = timer_cycles_to_us (2ULL << b) + 1;
+		uint64_t spans = 0;
+
+		for (; b < IRQSOFF_BUCKETS
+				&& timer_cycles_to_us (2ULL << b) + 1 == limit; b++)
+			spans += hist[b];
+		if (spans > 0)
+			printf ("Irqsoff: under %"PRIu64" us: %"PRIu64" spans\n",
+					limit, spans);
+	}
+	if (untracked > 0)
+		printf ("Irqsoff: %"PRIu64" spans from untracked addresses\n",
+				untracked);
+	for (int i = 0; i < cnt; i++)
+		printf ("Irqsoff: %p -> %p: max %"PRIu64" us, "
+				"avg %"PRIu64" us, %"PRIu64" spans\n",
+				top[i].start_ip, top[i].end_ip,
+				timer_cycles_to_us (top[i].max_cycles),
+				timer_cycles_to_us (top[i].cycles / top[i].cnt), top[i].cnt);
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
@@ -5,6 +5,8 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -26,7 +28,22 @@
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   and give the arena back to the page allocator.  Each
+   descriptor keeps one such empty arena back as a spare, so that
+   a block size whose use rises and falls around an arena
+   boundary does not get and free the same page over and over.
+
+   The free lists are protected by the descriptor's lock.  Most
+   requests never touch them, though.  In front of the free lists
+   sits a per-CPU cache of "magazines", following Bonwick and
+   Adams, "Magazines and Vmem", USENIX 2001.  A magazine is a
+   small array of free blocks.  Each CPU has two magazines per
+   descriptor, and malloc() and free() pop and push blocks there
+   with interrupts off and no lock held.  Only when both of a
+   CPU's magazines are empty (for malloc()) or full (for free())
+   does it take the descriptor's lock to exchange one with the
+   descriptor's "depot" of full and empty magazines, or to fill
+   one from the free list.
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
@@ -34,12 +51,38 @@
    with the page allocator and sticking the allocation size at
    the beginning of the allocated block's arena header. */
 
+/* Blocks in a magazine. */
+#define MAG_ROUNDS 14
+
+/* Full and empty magazines each a depot keeps at most. */
+#define DEPOT_MAX 4
+
+/* A magazine of free blocks. */
+struct magazine {
+	struct list_elem elem;      /* Depot or magazine free list element. */
+	int rounds;                 /* Number of blocks in `round'. */
+	struct block *round[MAG_ROUNDS]; /* Free blocks, last one on top. */
+};
+
+/* A CPU's magazines for one descriptor.  Touched only by threads
+   running on that CPU, with interrupts off. */
+struct cpu_cache {
+	struct magazine *loaded;    /* Magazine in use, or NULL. */
+	struct magazine *previous;  /* Full or empty spare, or NULL. */
+};
+
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
-	struct lock lock;           /* Lock. */
+	size_t spare_cnt;           /* Arenas with no block in use. */
+	struct list full_mags;      /* Depot of full magazines. */
+	struct list empty_mags;     /* Depot of empty magazines. */
+	size_t full_cnt;            /* Number of full magazines in depot. */
+	size_t empty_cnt;           /* Number of empty magazines in depot. */
+	struct lock lock;           /* Lock for all of the above. */
+	struct cpu_cache caches[CPU_MAX]; /* Per-CPU magazines. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -61,8 +104,20 @@ struct block {
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Magazines not in use by any descriptor.  Magazines are carved
+   out of pages of their own and never given back. */
+static struct list mag_free_list;
+static struct lock mag_lock;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *block_get (struct desc *);
+static void block_put (struct desc *, struct block *);
+static void *malloc_slow (struct desc *);
+static void free_slow (struct desc *, struct block *);
+static struct magazine *mag_get (struct desc *, bool full);
+static void mag_put (struct desc *, struct magazine *);
+static struct magazine *mag_alloc (void);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -75,8 +130,15 @@ malloc_init (void) {
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
+		d->spare_cnt = 0;
+		list_init (&d->full_mags);
+		list_init (&d->empty_mags);
+		d->full_cnt = d->empty_cnt = 0;
 		lock_init (&d->lock);
+		memset (d->caches, 0, sizeof d->caches);
 	}
+	list_init (&mag_free_list);
+	lock_init (&mag_lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -86,6 +148,8 @@ malloc (size_t size) {
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
+	struct cpu_cache *cc;
+	enum intr_level old_level;
 
 	/* A null pointer satisfies a request for 0 bytes. */
 	if (size == 0)
@@ -112,33 +176,82 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
+	/* Take a block from this CPU's loaded magazine, or from the
+	   previous one if the loaded one is empty. */
+	old_level = intr_disable ();
+	cc = &d->caches[this_cpu ()->id];
+	if (cc->loaded == NULL || cc->loaded->rounds == 0) {
+		struct magazine *m = cc->previous;
+		if (m == NULL || m->rounds == 0) {
+			intr_set_level (old_level);
+			return malloc_slow (d);
+		}
+		cc->previous = cc->loaded;
+		cc->loaded = m;
+	}
+	b = cc->loaded->round[--cc->loaded->rounds];
+	intr_set_level (old_level);
+	return b;
+}
 
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
+/* Allocates a block from D when this CPU's magazines are both
+   empty, by exchanging one for a full magazine from D's depot or,
+   failing that, filling one from D's free list. */
+static void *
+malloc_slow (struct desc *d) {
+	struct magazine *full;
+	struct cpu_cache *cc;
+	struct block *b;
+	enum intr_level old_level;
 
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
+	lock_acquire (&d->lock);
+	full = mag_get (d, true);
+	if (full == NULL) {
+		/* No full magazine.  Fill an empty one with blocks from the
+		   free list, or if there is no magazine to spare, just return
+		   a single block. */
+		full = mag_get (d, false);
+		if (full == NULL)
+			full = mag_alloc ();
+		if (full == NULL) {
+			b = block_get (d);
+			lock_release (&d->lock);
+			return b;
+		}
+		while (full->rounds < MAG_ROUNDS) {
+			b = block_get (d);
+			if (b == NULL)
+				break;
+			full->round[full->rounds++] = b;
+		}
+		if (full->rounds == 0) {
+			mag_put (d, full);
 			lock_release (&d->lock);
 			return NULL;
 		}
+	}
 
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
+	/* We may have moved to another CPU, or another thread on ours
+	   may have freed blocks in the meantime, so look again. */
+	old_level = intr_disable ();
+	cc = &d->caches[this_cpu ()->id];
+	if (cc->loaded == NULL || cc->loaded->rounds == 0) {
+		struct magazine *m = cc->previous;
+		if (m == NULL || m->rounds == 0) {
+			/* Both empty, as expected.  Load FULL and hand the
+			   previous magazine back to the depot. */
+			cc->previous = cc->loaded;
+			cc->loaded = full;
+			full = m;
+		} else {
+			cc->previous = cc->loaded;
+			cc->loaded = m;
 		}
 	}
-
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
+	b = cc->loaded->round[--cc->loaded->rounds];
+	intr_set_level (old_level);
+	if (full != NULL)
+		mag_put (d, full);
 	lock_release (&d->lock);
 	return b;
 }
@@ -207,30 +320,30 @@ free (void *p) {
 
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
+			struct cpu_cache *cc;
+			enum intr_level old_level;
 
 #ifndef NDEBUG
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
+			/* Push the block on this CPU's loaded magazine, or on the
+			   previous one if the loaded one is full. */
+			old_level = intr_disable ();
+			cc = &d->caches[this_cpu ()->id];
+			if (cc->loaded == NULL || cc->loaded->rounds == MAG_ROUNDS) {
+				struct magazine *m = cc->previous;
+				if (m == NULL || m->rounds == MAG_ROUNDS) {
+					intr_set_level (old_level);
+					free_slow (d, b);
+					return;
 				}
-				palloc_free_page (a);
+				cc->previous = cc->loaded;
+				cc->loaded = m;
 			}
-
-			lock_release (&d->lock);
+			cc->loaded->round[cc->loaded->rounds++] = b;
+			intr_set_level (old_level);
 		} else {
 			/* It's a big block.  Free its pages. */
 			palloc_free_multiple (a, a->free_cnt);
@@ -238,7 +351,185 @@ free (void *p) {
 		}
 	}
 }
-
+
+/* Frees block B of D when this CPU's magazines are both full (or
+   missing), by exchanging one for an empty magazine from D's
+   depot.  If there is no magazine to spare, B goes straight back
+   to D's free list. */
+static void
+free_slow (struct desc *d, struct block *b) {
+	struct magazine *empty;
+	struct cpu_cache *cc;
+	enum intr_level old_level;
+
+	lock_acquire (&d->lock);
+	empty = mag_get (d, false);
+	if (empty == NULL)
+		empty = mag_alloc ();
+	if (empty == NULL) {
+		block_put (d, b);
+		lock_release (&d->lock);
+		return;
+	}
+
+	/* Look again, as in malloc_slow(). */
+	old_level = intr_disable ();
+	cc = &d->caches[this_cpu ()->id];
+	if (cc->loaded == NULL || cc->loaded->rounds == MAG_ROUNDS) {
+		struct magazine *m = cc->previous;
+		if (m == NULL || m->rounds == MAG_ROUNDS) {
+			/* Both full, as expected.  Load EMPTY and hand the
+			   previous magazine back to the depot. */
+			cc->previous = cc->loaded;
+			cc->loaded = empty;
+			empty = m;
+		} else {
+			cc->previous = cc->loaded;
+			cc->loaded = m;
+		}
+	}
+	cc->loaded->round[cc->loaded->rounds++] = b;
+	intr_set_level (old_level);
+	if (empty != NULL)
+		mag_put (d, empty);
+	lock_release (&d->lock);
+}
+
+/* Removes and returns a full magazine from D's depot if FULL is
+   true, or an empty one otherwise.  Returns a null pointer if the
+   depot has none.  D's lock must be held. */
+static struct magazine *
+mag_get (struct desc *d, bool full) {
+	struct list *list = full ? &d->full_mags : &d->empty_mags;
+	size_t *cnt = full ? &d->full_cnt : &d->empty_cnt;
+
+	ASSERT (lock_held_by_current_thread (&d->lock));
+
+	if (list_empty (list))
+		return NULL;
+	(*cnt)--;
+	return list_entry (list_pop_front (list), struct magazine, elem);
+}
+
+/* Puts magazine M into D's depot.  A full magazine goes on the
+   depot's full list unless that already has DEPOT_MAX magazines.
+   Otherwise, M's blocks go back to the free list and the empty
+   magazine goes on the depot's empty list, or back to the
+   magazine free list if that too is long enough.  D's lock must
+   be held. */
+static void
+mag_put (struct desc *d, struct magazine *m) {
+	ASSERT (lock_held_by_current_thread (&d->lock));
+
+	if (m->rounds == MAG_ROUNDS && d->full_cnt < DEPOT_MAX) {
+		list_push_front (&d->full_mags, &m->elem);
+		d->full_cnt++;
+		return;
+	}
+	while (m->rounds > 0)
+		block_put (d, m->round[--m->rounds]);
+
+	if (d->empty_cnt < DEPOT_MAX) {
+		list_push_front (&d->empty_mags, &m->elem);
+		d->empty_cnt++;
+	} else {
+		lock_acquire (&mag_lock);
+		list_push_front (&mag_free_list, &m->elem);
+		lock_release (&mag_lock);
+	}
+}
+
+/* Returns a new empty magazine, or a null pointer if memory is
+   not available. */
+static struct magazine *
+mag_alloc (void) {
+	struct magazine *m;
+
+	lock_acquire (&mag_lock);
+	if (list_empty (&mag_free_list)) {
+		uint8_t *page = palloc_get_page (0);
+		size_t i;
+
+		if (page == NULL) {
+			lock_release (&mag_lock);
+			return NULL;
+		}
+		for (i = 0; i < PGSIZE / sizeof *m; i++) {
+			m = (struct magazine *) page + i;
+			list_push_back (&mag_free_list, &m->elem);
+		}
+	}
+	m = list_entry (list_pop_front (&mag_free_list), struct magazine, elem);
+	lock_release (&mag_lock);
+
+	m->rounds = 0;
+	return m;
+}
+
+/* Removes and returns a block from D's free list, creating a new
+   arena if the list is empty.  Returns a null pointer if memory
+   is not available.  D's lock must be held. */
+static struct block *
+block_get (struct desc *d) {
+	struct block *b;
+	struct arena *a;
+
+	/* If the free list is empty, create a new arena. */
+	if (list_empty (&d->free_list)) {
+		size_t i;
+
+		/* Allocate a page. */
+		a = palloc_get_page (0);
+		if (a == NULL)
+			return NULL;
+
+		/* Initialize arena and add its blocks to the free list. */
+		a->magic = ARENA_MAGIC;
+		a->desc = d;
+		a->free_cnt = d->blocks_per_arena;
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_push_back (&d->free_list, &b->free_elem);
+		}
+		d->spare_cnt++;
+	}
+
+	/* Get a block from free list. */
+	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+	a = block_to_arena (b);
+	if (a->free_cnt-- == d->blocks_per_arena)
+		d->spare_cnt--;
+	return b;
+}
+
+/* Adds block B to D's free list.  If B's arena is now entirely
+   unused and D already has a spare arena, frees the arena.  D's
+   lock must be held. */
+static void
+block_put (struct desc *d, struct block *b) {
+	struct arena *a = block_to_arena (b);
+
+	/* Add block to free list. */
+	list_push_front (&d->free_list, &b->free_elem);
+
+	/* If the arena is now entirely unused, keep it as the spare or
+	   free it. */
+	if (++a->free_cnt >= d->blocks_per_arena) {
+		size_t i;
+
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		if (d->spare_cnt == 0) {
+			d->spare_cnt++;
+			return;
+		}
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_remove (&b->free_elem);
+		}
+		palloc_free_page (a);
+	}
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
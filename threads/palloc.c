@@ -2,6 +2,7 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -9,8 +10,11 @@
 #include <string.h>
 #include "threads/init.h"
 #include "threads/loader.h"
+#include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "intrinsic.h"
 
 /* Page allocator.  Hands out memory in page-size (or
    page-multiple) chunks.  See malloc.h for an allocator that
@@ -24,13 +28,78 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Its free pages are
+   grouped into blocks of 2**ORDER pages, for ORDER from 0 to
+   MAX_ORDER, each aligned on a multiple of its size in physical
+   memory, and there is a free list for each order.  A request
+   for N pages takes a block of the least order that holds N
+   pages, from that order's free list if it is nonempty, or else
+   by splitting a larger block in halves until one half is the
+   right size.  Any pages of the block beyond the N requested go
+   back on the free lists.  A freed block is merged with its
+   "buddy", the other half of the block it was split from, for as
+   long as the buddy is free too.  Both take O(MAX_ORDER) steps,
+   so they are done with interrupts off, which also makes it safe
+   to free pages where sleeping is not allowed, such as in the
+   scheduler.
+
+   Requests for more than 2**MAX_ORDER pages fall back to a
+   first-fit search of the bitmap of used pages.
+
+   The free lists link bookkeeping kept apart from the pages,
+   because the pages are not all mapped yet when the pools are
+   populated.
+
+   Each pool also keeps a list of pages zeroed ahead of time, so
+   that single-page PAL_ZERO requests, such as for page tables and
+   user stacks, need not clear the page themselves.  The idle
+   thread takes free pages from the buddy lists and zeroes them
+   while its CPU has nothing else to do, until the list holds
+   ZERO_MAX pages or a 16th of the pool.  Pages on the list count
+   as used.  If a pool runs out of free pages, its zeroed pages go
+   back to the buddy lists. */
+
+/* Greatest order of a block. */
+#define MAX_ORDER 10
+
+/* Bookkeeping for a page of a pool. */
+struct page_info {
+	struct list_elem free_elem;     /* Free list element. */
+	int8_t order;                   /* Order of the free block this page
+	                                   heads, or -1 if none. */
+};
+
+/* Most pages a pool keeps zeroed ahead of time. */
+#define ZERO_MAX 256
+
+/* Number of buckets in the allocation latency histogram. */
+#define LAT_BUCKETS 32
 
-/* A memory pool. */
+/* A memory pool.  LOCK, taken with interrupts off, protects
+   everything from FREE_LISTS on, and the bitmap and bookkeeping
+   of free pages. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
-	struct bitmap *used_map;        /* Bitmap of free pages. */
+	struct spinlock lock;           /* Serializes CPUs. */
+	const char *name;               /* Name, for statistics. */
+	struct bitmap *used_map;        /* Bitmap of used pages. */
+	struct page_info *pages;        /* Bookkeeping for each page. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t base_pfn;                /* Page number of BASE. */
+	struct list free_lists[MAX_ORDER + 1]; /* Free blocks by order. */
+	size_t free_cnts[MAX_ORDER + 1];       /* Lengths of free lists. */
+	size_t free_pages;              /* Number of free pages. */
+	struct list zero_list;          /* Pages zeroed ahead of time. */
+	size_t zero_cnt;                /* Zeroed or being zeroed. */
+	size_t zero_target;             /* Pages to keep zeroed. */
+
+	/* Statistics. */
+	long long alloc_cnt;            /* Allocations. */
+	long long fail_cnt;             /* Failed allocations. */
+	long long zero_hit_cnt;         /* PAL_ZERO served from zero_list. */
+	long long zero_miss_cnt;        /* PAL_ZERO that had to zero. */
+	unsigned lat_hist[LAT_BUCKETS]; /* Allocations by log2 of cycles. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +111,16 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static void pool_free (struct pool *, size_t page_idx, size_t page_cnt);
+static size_t block_alloc (struct pool *, int order);
+static void block_free (struct pool *, size_t page_idx, int order);
+static void block_insert (struct pool *, size_t page_idx, int order);
+static void block_remove (struct pool *, size_t page_idx);
+static void carve_range (struct pool *, size_t page_idx, size_t page_cnt);
+static int range_order (const struct pool *, size_t page_idx,
+		size_t page_cnt);
+static size_t zero_drain (struct pool *);
 
 /* multiboot info */
 struct multiboot_info {
@@ -189,6 +268,8 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 
 	// generate the user pool
 	init_pool(&user_pool, &free_start, region_start, end);
+	kernel_pool.name = "kernel pool";
+	user_pool.name = "user pool";
 
 	// Iterate over the e820_entry. Setup the usable.
 	uint64_t usable_bound = (uint64_t) free_start;
@@ -223,12 +304,12 @@ split:
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -250,6 +331,12 @@ palloc_init (void) {
 	printf ("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
 		  ext_mem.start, ext_mem.end, ext_mem.size / 1024);
 	populate_pools (&base_mem, &ext_mem);
+	kernel_pool.zero_target = kernel_pool.free_pages / 16;
+	if (kernel_pool.zero_target > ZERO_MAX)
+		kernel_pool.zero_target = ZERO_MAX;
+	user_pool.zero_target = user_pool.free_pages / 16;
+	if (user_pool.zero_target > ZERO_MAX)
+		user_pool.zero_target = ZERO_MAX;
 	return ext_mem.end;
 }
 
@@ -258,23 +345,75 @@ palloc_init (void) {
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   FLAGS, in which case the kernel panics.  The pages for a
+   request for a power of 2 pages, up to 2**MAX_ORDER, are aligned
+   on a multiple of their size, as a large page needs. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	enum intr_level old_level;
+	uint64_t start = rdtsc ();
+	bool zeroed = false;
+	size_t page_idx;
 	void *pages;
 
+	if (page_cnt == 0)
+		return NULL;
+
+	old_level = intr_disable ();
+	spin_lock (&pool->lock);
+	if ((flags & PAL_ZERO) && page_cnt == 1
+			&& !list_empty (&pool->zero_list)) {
+		struct list_elem *e = list_pop_front (&pool->zero_list);
+		page_idx = list_entry (e, struct page_info, free_elem) - pool->pages;
+		pool->zero_cnt--;
+		zeroed = true;
+	} else {
+		page_idx = pool_alloc (pool, page_cnt);
+		if (page_idx == BITMAP_ERROR && zero_drain (pool) > 0)
+			page_idx = pool_alloc (pool, page_cnt);
+	}
+	spin_unlock (&pool->lock);
+	intr_set_level (old_level);
+
+	/* Out of kernel pages: take back the pages cached for new
+	   threads and try again.  That frees pages, so it must not
+	   run under the pool's lock. */
+	if (page_idx == BITMAP_ERROR && pool == &kernel_pool
+			&& thread_page_cache_trim () > 0) {
+		old_level = intr_disable ();
+		spin_lock (&pool->lock);
+		page_idx = pool_alloc (pool, page_cnt);
+		spin_unlock (&pool->lock);
+		intr_set_level (old_level);
+	}
+
 	if (page_idx != BITMAP_ERROR)
 		pages = pool->base + PGSIZE * page_idx;
 	else
 		pages = NULL;
 
+	old_level = intr_disable ();
+	spin_lock (&pool->lock);
+	if (pages != NULL) {
+		uint64_t cycles = rdtsc () - start;
+		int b = cycles != 0 ? 63 - __builtin_clzll (cycles) : 0;
+
+		pool->alloc_cnt++;
+		pool->lat_hist[b < LAT_BUCKETS ? b : LAT_BUCKETS - 1]++;
+		if (flags & PAL_ZERO) {
+			if (zeroed)
+				pool->zero_hit_cnt++;
+			else
+				pool->zero_miss_cnt++;
+		}
+	} else
+		pool->fail_cnt++;
+	spin_unlock (&pool->lock);
+	intr_set_level (old_level);
+
 	if (pages) {
-		if (flags & PAL_ZERO)
+		if ((flags & PAL_ZERO) && !zeroed)
 			memset (pages, 0, PGSIZE * page_cnt);
 	} else {
 		if (flags & PAL_ASSERT)
@@ -300,6 +439,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
 	size_t page_idx;
+	enum intr_level old_level;
 
 	ASSERT (pg_ofs (pages) == 0);
 	if (pages == NULL || page_cnt == 0)
@@ -317,8 +457,12 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	old_level = intr_disable ();
+	spin_lock (&pool->lock);
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	pool_free (pool, page_idx, page_cnt);
+	spin_unlock (&pool->lock);
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -327,21 +471,138 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Zeroes a free page ahead of time for a pool that wants more
+   zeroed pages.  Returns true if it did, false if no pool needs
+   one or can spare one.  Called by the idle thread with
+   interrupts off.  Turns them on while zeroing the page. */
+bool
+palloc_zero_idle (void) {
+	struct pool *pools[] = { &kernel_pool, &user_pool };
+	size_t page_idx = BITMAP_ERROR;
+	struct pool *p;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* Leave a pool's last free pages alone, so that zeroing does
+	   not hand them back and forth with zero_drain(). */
+	for (size_t i = 0; i < sizeof pools / sizeof *pools; i++) {
+		p = pools[i];
+		spin_lock (&p->lock);
+		if (p->zero_cnt < p->zero_target
+				&& p->free_pages > 2 * p->zero_target) {
+			page_idx = pool_alloc (p, 1);
+			if (page_idx != BITMAP_ERROR)
+				p->zero_cnt++;
+		}
+		spin_unlock (&p->lock);
+		if (page_idx != BITMAP_ERROR)
+			break;
+	}
+	if (page_idx == BITMAP_ERROR)
+		return false;
+
+	intr_enable ();
+	memset (p->base + PGSIZE * page_idx, 0, PGSIZE);
+	intr_disable ();
+
+	spin_lock (&p->lock);
+	list_push_back (&p->zero_list, &p->pages[page_idx].free_elem);
+	spin_unlock (&p->lock);
+	return true;
+}
+
+/* Returns the value of the latency histogram HIST below which
+   PERCENT percent of the CNT allocations in it fall, in cycles. */
+static uint64_t
+lat_percentile (const unsigned hist[LAT_BUCKETS], long long cnt,
+		int percent) {
+	long long seen = 0;
+	int b;
+
+	for (b = 0; b < LAT_BUCKETS - 1; b++) {
+		seen += hist[b];
+		if (seen * 100 >= cnt * percent)
+			break;
+	}
+	return 1ULL << (b + 1);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) {
+	struct pool *pools[] = { &kernel_pool, &user_pool };
+
+	for (size_t i = 0; i < sizeof pools / sizeof *pools; i++) {
+		struct pool *p = pools[i];
+		unsigned hist[LAT_BUCKETS];
+		long long alloc_cnt, fail_cnt, zero_hit_cnt, zero_miss_cnt;
+		size_t free_pages, zero_cnt, largest = 0;
+		enum intr_level old_level;
+		int order;
+
+		old_level = intr_disable ();
+		spin_lock (&p->lock);
+		memcpy (hist, p->lat_hist, sizeof hist);
+		alloc_cnt = p->alloc_cnt;
+		fail_cnt = p->fail_cnt;
+		free_pages = p->free_pages;
+		zero_cnt = p->zero_cnt;
+		zero_hit_cnt = p->zero_hit_cnt;
+		zero_miss_cnt = p->zero_miss_cnt;
+		for (order = MAX_ORDER; order >= 0; order--)
+			if (p->free_cnts[order] > 0) {
+				largest = (size_t) 1 << order;
+				break;
+			}
+		spin_unlock (&p->lock);
+		intr_set_level (old_level);
+
+		printf ("Palloc: %s: %zu of %zu pages free, largest free block "
+				"%zu pages\n", p->name, free_pages,
+				bitmap_size (p->used_map), largest);
+		if (alloc_cnt > 0)
+			printf ("Palloc: %s: %lld allocations, %lld failed, latency "
+					"p50 <%"PRIu64", p90 <%"PRIu64", p99 <%"PRIu64" cycles\n",
+					p->name, alloc_cnt, fail_cnt,
+					lat_percentile (hist, alloc_cnt, 50),
+					lat_percentile (hist, alloc_cnt, 90),
+					lat_percentile (hist, alloc_cnt, 99));
+		if (zero_hit_cnt + zero_miss_cnt > 0)
+			printf ("Palloc: %s: %lld zeroed page hits, %lld misses, "
+					"%zu pages zeroed ahead\n", p->name, zero_hit_cnt,
+					zero_miss_cnt, zero_cnt);
+	}
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
+  /* We'll put the pool's used_map at its base, followed by the
+     bookkeeping for each page.  Calculate the space needed for
+     them and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
-
-	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	size_t bm_size = ROUND_UP (bitmap_buf_size (pgcnt), sizeof (void *));
+	size_t bm_pages = DIV_ROUND_UP (bm_size
+			+ pgcnt * sizeof (struct page_info), PGSIZE) * PGSIZE;
+	size_t i;
+
+	spin_init (&p->lock);
+	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_size);
+	p->pages = (struct page_info *) ((uint8_t *) *bm_base + bm_size);
 	p->base = (void *) start;
+	p->base_pfn = pg_no (start);
+	for (i = 0; i <= MAX_ORDER; i++) {
+		list_init (&p->free_lists[i]);
+		p->free_cnts[i] = 0;
+	}
+	p->free_pages = 0;
+	list_init (&p->zero_list);
+	p->zero_cnt = p->zero_target = 0;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	for (i = 0; i < pgcnt; i++)
+		p->pages[i].order = -1;
 
 	*bm_base += bm_pages;
 }
@@ -355,3 +616,191 @@ page_from_pool (const struct pool *pool, void *page) {
 	size_t end_page = start_page + bitmap_size (pool->used_map);
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Allocates PAGE_CNT contiguous pages from pool P and returns the
+   index of the first, or BITMAP_ERROR if P has no such run of
+   free pages.  P's lock must be held. */
+static size_t
+pool_alloc (struct pool *p, size_t page_cnt) {
+	size_t page_idx;
+	int order;
+
+	ASSERT (spin_held (&p->lock));
+
+	if (page_cnt > (size_t) 1 << MAX_ORDER) {
+		page_idx = bitmap_scan (p->used_map, 0, page_cnt, false);
+		if (page_idx != BITMAP_ERROR)
+			carve_range (p, page_idx, page_cnt);
+	} else {
+		order = page_cnt > 1 ? 64 - __builtin_clzll (page_cnt - 1) : 0;
+		page_idx = block_alloc (p, order);
+		if (page_idx == BITMAP_ERROR)
+			return BITMAP_ERROR;
+
+		/* Give back the pages beyond PAGE_CNT. */
+		if (page_cnt < (size_t) 1 << order)
+			pool_free (p, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+	}
+
+	if (page_idx != BITMAP_ERROR)
+		bitmap_set_multiple (p->used_map, page_idx, page_cnt, true);
+	return page_idx;
+}
+
+/* Adds the PAGE_CNT pages starting at PAGE_IDX in pool P to P's
+   free lists, as the largest aligned blocks that cover them.
+   P's lock must be held, except while populating the pools. */
+static void
+pool_free (struct pool *p, size_t page_idx, size_t page_cnt) {
+	bitmap_set_multiple (p->used_map, page_idx, page_cnt, false);
+	while (page_cnt > 0) {
+		int order = range_order (p, page_idx, page_cnt);
+
+		block_free (p, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Returns the order of the largest block that starts at PAGE_IDX
+   in pool P, is aligned on its size, and holds no more than
+   PAGE_CNT pages. */
+static int
+range_order (const struct pool *p, size_t page_idx, size_t page_cnt) {
+	size_t pfn = p->base_pfn + page_idx;
+	int order = 0;
+
+	while (order < MAX_ORDER
+			&& (pfn & (((size_t) 2 << order) - 1)) == 0
+			&& (size_t) 2 << order <= page_cnt)
+		order++;
+	return order;
+}
+
+/* Removes a block of 2**ORDER pages from pool P's free lists,
+   splitting a larger block if need be, and returns the index of
+   its first page, or BITMAP_ERROR if there is no block large
+   enough. */
+static size_t
+block_alloc (struct pool *p, int order) {
+	size_t page_idx;
+	int i;
+
+	for (i = order; i <= MAX_ORDER; i++)
+		if (!list_empty (&p->free_lists[i]))
+			break;
+	if (i > MAX_ORDER)
+		return BITMAP_ERROR;
+
+	page_idx = list_entry (list_front (&p->free_lists[i]),
+			struct page_info, free_elem) - p->pages;
+	block_remove (p, page_idx);
+
+	/* Split, putting the upper halves back. */
+	while (i > order) {
+		i--;
+		block_insert (p, page_idx + ((size_t) 1 << i), i);
+	}
+	return page_idx;
+}
+
+/* Adds the block of 2**ORDER pages at PAGE_IDX in pool P to its
+   free lists, first merging it with its buddy for as long as the
+   buddy is a free block of the same order. */
+static void
+block_free (struct pool *p, size_t page_idx, int order) {
+	while (order < MAX_ORDER) {
+		size_t buddy = ((p->base_pfn + page_idx) ^ ((size_t) 1 << order))
+			- p->base_pfn;
+
+		if (buddy >= bitmap_size (p->used_map)
+				|| p->pages[buddy].order != order)
+			break;
+		block_remove (p, buddy);
+		if (buddy < page_idx)
+			page_idx = buddy;
+		order++;
+	}
+	block_insert (p, page_idx, order);
+}
+
+/* Puts the block of 2**ORDER pages at PAGE_IDX on pool P's free
+   list for ORDER. */
+static void
+block_insert (struct pool *p, size_t page_idx, int order) {
+	struct page_info *info = &p->pages[page_idx];
+
+	ASSERT (info->order == -1);
+	info->order = order;
+	list_push_front (&p->free_lists[order], &info->free_elem);
+	p->free_cnts[order]++;
+	p->free_pages += (size_t) 1 << order;
+}
+
+/* Takes the free block at PAGE_IDX off pool P's free lists. */
+static void
+block_remove (struct pool *p, size_t page_idx) {
+	struct page_info *info = &p->pages[page_idx];
+	int order = info->order;
+
+	ASSERT (order >= 0);
+	list_remove (&info->free_elem);
+	info->order = -1;
+	p->free_cnts[order]--;
+	p->free_pages -= (size_t) 1 << order;
+}
+
+/* Takes the PAGE_CNT free pages starting at PAGE_IDX in pool P
+   off its free lists.  The free blocks that hold these pages may
+   stick out on either side, and the parts that do go back on
+   the free lists. */
+static void
+carve_range (struct pool *p, size_t page_idx, size_t page_cnt) {
+	size_t end = page_idx + page_cnt;
+	size_t i = page_idx;
+
+	while (i < end) {
+		size_t head = BITMAP_ERROR, block_end;
+		int order;
+
+		/* Find the free block that holds page I. */
+		for (order = 0; order <= MAX_ORDER; order++) {
+			size_t pfn = (p->base_pfn + i) & ~(((size_t) 1 << order) - 1);
+
+			if (pfn < p->base_pfn)
+				break;
+			if (p->pages[pfn - p->base_pfn].order == order) {
+				head = pfn - p->base_pfn;
+				break;
+			}
+		}
+		ASSERT (head != BITMAP_ERROR);
+
+		block_remove (p, head);
+		block_end = head + ((size_t) 1 << order);
+		if (head < page_idx)
+			pool_free (p, head, page_idx - head);
+		if (block_end > end)
+			pool_free (p, end, block_end - end);
+		i = block_end;
+	}
+}
+
+/* Gives every page on pool P's zeroed list back to its buddy
+   lists, and returns the number of pages.  P's lock must be
+   held. */
+static size_t
+zero_drain (struct pool *p) {
+	size_t cnt = 0;
+
+	ASSERT (spin_held (&p->lock));
+
+	while (!list_empty (&p->zero_list)) {
+		struct list_elem *e = list_pop_front (&p->zero_list);
+
+		pool_free (p, list_entry (e, struct page_info, free_elem) - p->pages, 1);
+		p->zero_cnt--;
+		cnt++;
+	}
+	return cnt;
+}
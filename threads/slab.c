@@ -0,0 +1,337 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.
+
+   Each slab is one page from the page allocator.  It starts with
+   a header, followed by an array of free list links, one per
+   object, and then the objects themselves.  The free list is kept
+   in the header rather than in the free objects, so that freeing
+   an object leaves its constructed state alone.
+
+   Whatever is left of the page after the objects is spent on
+   "coloring": each new slab of a cache starts its objects one
+   cache line further into the page than the last, wrapping
+   around when the leftover space runs out.  Without it, the
+   first object of every slab, and the hot fields in it, would
+   all compete for the same cache sets.
+
+   A cache keeps its slabs on three lists, by whether all, some,
+   or none of their objects are in use.  Objects come from a
+   partly used slab if there is one, so that slabs fill up and
+   empty out as a whole.  A cache keeps one empty slab back as a
+   spare and gives any others back to the page allocator. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab0bec
+
+/* Alignment of objects in a cache created with no alignment. */
+#define SLAB_MIN_ALIGN 8
+
+/* Step between the colors of successive slabs.  Should be the
+   size of a cache line. */
+#define SLAB_COLOR_STEP 64
+
+/* End of a slab's free list. */
+#define FREE_END UINT16_MAX
+
+/* Object cache. */
+struct kmem_cache {
+	char name[16];              /* Name, for statistics. */
+	size_t size;                /* Object size, a multiple of ALIGN. */
+	size_t align;               /* Object alignment, a power of 2. */
+	kmem_ctor_func *ctor;       /* Constructor, or NULL. */
+	size_t objs_per_slab;       /* Number of objects in a slab. */
+	size_t objs_ofs;            /* Offset of first object in a slab. */
+	size_t color_step;          /* Step between colors. */
+	size_t color_max;           /* Greatest color. */
+	size_t color_next;          /* Color of the next new slab. */
+
+	struct lock lock;           /* Protects the members below. */
+	struct list full_slabs;     /* Slabs with all objects in use. */
+	struct list partial_slabs;  /* Slabs with some objects in use. */
+	struct list empty_slabs;    /* Slabs with no object in use. */
+	size_t slab_cnt;            /* Number of slabs. */
+	size_t empty_cnt;           /* Number of empty slabs. */
+	size_t in_use;              /* Objects in use. */
+	long long alloc_cnt;        /* Objects allocated, ever. */
+	long long slab_alloc_cnt;   /* Slabs allocated, ever. */
+
+	struct list_elem elem;      /* Element in `caches'. */
+};
+
+/* A slab, at the start of its page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in one of the cache's lists. */
+	uint8_t *objs;              /* First object. */
+	size_t in_use;              /* Objects in use. */
+	uint16_t free;              /* First free object, or FREE_END. */
+	uint16_t next[];            /* next[I] follows object I when free. */
+};
+
+/* All caches, for statistics. */
+static struct list caches;
+static struct lock caches_lock;
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+
+/* Initializes the slab allocator. */
+void
+kmem_init (void) {
+	list_init (&caches);
+	lock_init (&caches_lock);
+}
+
+/* Creates and returns a cache of objects of SIZE bytes, each
+   aligned on an ALIGN-byte boundary, which must be 0 for the
+   default or a power of 2.  If CTOR is non-null, it is run once
+   on each object when the object's slab is created.  NAME
+   identifies the cache in statistics.  Returns a null pointer if
+   memory is not available.
+
+   SIZE must be small enough that a slab holds at least one
+   object. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, size_t align,
+		kmem_ctor_func *ctor) {
+	struct kmem_cache *c;
+	size_t n;
+
+	if (align == 0)
+		align = SLAB_MIN_ALIGN;
+	ASSERT (size > 0);
+	ASSERT ((align & (align - 1)) == 0 && align <= PGSIZE / 2);
+
+	c = malloc (sizeof *c);
+	if (c == NULL)
+		return NULL;
+
+	strlcpy (c->name, name, sizeof c->name);
+	c->size = ROUND_UP (size, align);
+	c->align = align;
+	c->ctor = ctor;
+
+	/* Fit as many objects as possible after the header and its
+	   free list links. */
+	n = (PGSIZE - sizeof (struct slab)) / (c->size + sizeof (uint16_t));
+	while (n > 0 && ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+				align) + n * c->size > PGSIZE)
+		n--;
+	ASSERT (n > 0 && n < FREE_END);
+	c->objs_per_slab = n;
+	c->objs_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t), align);
+
+	/* Spread the leftover space over the colors. */
+	c->color_step = align > SLAB_COLOR_STEP ? align : SLAB_COLOR_STEP;
+	c->color_max = ROUND_DOWN (PGSIZE - c->objs_ofs - n * c->size,
+			c->color_step);
+	c->color_next = 0;
+
+	lock_init (&c->lock);
+	list_init (&c->full_slabs);
+	list_init (&c->partial_slabs);
+	list_init (&c->empty_slabs);
+	c->slab_cnt = c->empty_cnt = c->in_use = 0;
+	c->alloc_cnt = c->slab_alloc_cnt = 0;
+
+	lock_acquire (&caches_lock);
+	list_push_back (&caches, &c->elem);
+	lock_release (&caches_lock);
+	return c;
+}
+
+/* Destroys cache C, which must have no objects in use, and gives
+   its slabs back to the page allocator. */
+void
+kmem_cache_destroy (struct kmem_cache *c) {
+	ASSERT (c != NULL);
+	ASSERT (c->in_use == 0);
+	ASSERT (list_empty (&c->full_slabs) && list_empty (&c->partial_slabs));
+
+	lock_acquire (&caches_lock);
+	list_remove (&c->elem);
+	lock_release (&caches_lock);
+
+	while (!list_empty (&c->empty_slabs)) {
+		struct list_elem *e = list_pop_front (&c->empty_slabs);
+		palloc_free_page (list_entry (e, struct slab, elem));
+	}
+	free (c);
+}
+
+/* Obtains and returns an object from cache C, in its constructed
+   state.  Returns a null pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	size_t idx;
+
+	ASSERT (c != NULL);
+
+	lock_acquire (&c->lock);
+	if (list_empty (&c->partial_slabs)) {
+		/* Start on an empty slab, creating one if there is none.
+		   The constructor may sleep, so run it without the lock. */
+		if (list_empty (&c->empty_slabs)) {
+			lock_release (&c->lock);
+			s = slab_create (c);
+			if (s == NULL)
+				return NULL;
+			lock_acquire (&c->lock);
+			c->slab_cnt++;
+			c->slab_alloc_cnt++;
+		} else {
+			s = list_entry (list_pop_front (&c->empty_slabs), struct slab, elem);
+			c->empty_cnt--;
+		}
+		list_push_front (&c->partial_slabs, &s->elem);
+	}
+
+	/* Take the first free object of the first partly used slab. */
+	s = list_entry (list_front (&c->partial_slabs), struct slab, elem);
+	idx = s->free;
+	ASSERT (idx != FREE_END);
+	s->free = s->next[idx];
+	if (++s->in_use == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->full_slabs, &s->elem);
+	}
+	c->in_use++;
+	c->alloc_cnt++;
+	lock_release (&c->lock);
+
+	return s->objs + idx * c->size;
+}
+
+/* Obtains and returns an object from cache C, which must not
+   have a constructor, with all of its bytes set to zero.
+   Returns a null pointer if memory is not available. */
+void *
+kmem_cache_zalloc (struct kmem_cache *c) {
+	void *obj;
+
+	ASSERT (c->ctor == NULL);
+
+	obj = kmem_cache_alloc (c);
+	if (obj != NULL)
+		memset (obj, 0, c->size);
+	return obj;
+}
+
+/* Frees OBJ, which must have been obtained from cache C and must
+   be back in its constructed state. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+	size_t idx;
+
+	if (obj == NULL)
+		return;
+
+	s = obj_to_slab (c, obj);
+	idx = ((uint8_t *) obj - s->objs) / c->size;
+
+	lock_acquire (&c->lock);
+	if (s->in_use == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial_slabs, &s->elem);
+	}
+	s->next[idx] = s->free;
+	s->free = idx;
+	c->in_use--;
+
+	/* If the slab is now entirely unused, keep it as the spare or
+	   free it. */
+	if (--s->in_use == 0) {
+		list_remove (&s->elem);
+		if (c->empty_cnt == 0) {
+			list_push_front (&c->empty_slabs, &s->elem);
+			c->empty_cnt++;
+		} else {
+			c->slab_cnt--;
+			s->magic = 0;
+			palloc_free_page (s);
+		}
+	}
+	lock_release (&c->lock);
+}
+
+/* Prints statistics for every cache that has been used. */
+void
+kmem_print_stats (void) {
+	struct list_elem *e;
+
+	lock_acquire (&caches_lock);
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+		if (c->alloc_cnt == 0)
+			continue;
+		printf ("Kmem: %s: %zu of %zu objects of %zu bytes in use, "
+				"%lld allocated, %lld slabs created, %zu%% overhead\n",
+				c->name, c->in_use, c->slab_cnt * c->objs_per_slab, c->size,
+				c->alloc_cnt, c->slab_alloc_cnt,
+				(PGSIZE - c->objs_per_slab * c->size) * 100 / PGSIZE);
+	}
+	lock_release (&caches_lock);
+}
+
+/* Creates and returns a new slab for cache C, with every object
+   constructed and free, or returns a null pointer if memory is
+   not available.  C's lock must not be held. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s;
+	size_t color;
+	size_t i;
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+
+	lock_acquire (&c->lock);
+	color = c->color_next;
+	c->color_next = color + c->color_step <= c->color_max
+		? color + c->color_step : 0;
+	lock_release (&c->lock);
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->objs = (uint8_t *) s + c->objs_ofs + color;
+	s->in_use = 0;
+	s->free = 0;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		s->next[i] = i + 1 < c->objs_per_slab ? i + 1 : FREE_END;
+		if (c->ctor != NULL)
+			c->ctor (s->objs + i * c->size);
+	}
+	return s;
+}
+
+/* Returns the slab that object OBJ of cache C is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	/* Check that the slab is valid and that OBJ is an object in
+	   it. */
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT ((uint8_t *) obj >= s->objs);
+	ASSERT (((uint8_t *) obj - s->objs) % c->size == 0);
+	ASSERT (((uint8_t *) obj - s->objs) / c->size < c->objs_per_slab);
+
+	return s;
+}
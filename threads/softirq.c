@@ -0,0 +1,97 @@
+#include "threads/softirq.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+/* A deferred-work handler and its statistics.  Every CPU updates
+   the statistics, so they are only changed with atomic adds. */
+struct softirq_action {
+	softirq_func *func;         /* Handler. */
+	const char *name;           /* For statistics. */
+	long long raise_cnt;        /* Times raised. */
+	long long run_cnt;          /* Times run. */
+	uint64_t cycles;            /* TSC cycles spent running. */
+};
+
+static struct softirq_action actions[SOFTIRQ_CNT];
+
+/* Maximum number of passes softirq_run() makes over softirqs that
+   keep getting raised while it runs.  Whatever is still pending
+   after that waits for the next interrupt, so that a flood of
+   interrupts cannot keep the interrupted thread from running. */
+#define SOFTIRQ_RESTART_MAX 10
+
+/* Registers FUNC to run for softirq NR, which is called NAME for
+   statistics. */
+void
+softirq_register (enum softirq nr, softirq_func *func, const char *name) {
+	ASSERT (nr < SOFTIRQ_CNT);
+	ASSERT (actions[nr].func == NULL);
+
+	actions[nr].func = func;
+	actions[nr].name = name;
+}
+
+/* Marks softirq NR pending on the running CPU, to be run when the
+   current interrupt returns.  Interrupts must be off. */
+void
+softirq_raise (enum softirq nr) {
+	ASSERT (nr < SOFTIRQ_CNT);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	this_cpu ()->softirq_pending |= 1u << nr;
+	__atomic_fetch_add (&actions[nr].raise_cnt, 1, __ATOMIC_RELAXED);
+}
+
+/* Runs the running CPU's pending softirqs with interrupts on.
+   Called by intr_handler() once an external interrupt has been
+   acknowledged, with interrupts off, and returns with them off.
+   Does nothing if softirqs are already running on this CPU, as
+   when the interrupt arrived while they ran: the outer call
+   picks up whatever it raised.
+
+   The CPU cannot change while softirqs run, because an interrupt
+   that arrives meanwhile does not yield. */
+void
+softirq_run (void) {
+	struct cpu *c = this_cpu ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (c->in_softirq || c->softirq_pending == 0)
+		return;
+
+	c->in_softirq = true;
+	for (int pass = 0; pass < SOFTIRQ_RESTART_MAX && c->softirq_pending != 0;
+			pass++) {
+		unsigned pending = c->softirq_pending;
+
+		c->softirq_pending = 0;
+		intr_enable ();
+		for (int nr = 0; nr < SOFTIRQ_CNT; nr++)
+			if (pending & (1u << nr)) {
+				uint64_t start = rdtsc ();
+
+				actions[nr].func ();
+				__atomic_fetch_add (&actions[nr].run_cnt, 1, __ATOMIC_RELAXED);
+				__atomic_fetch_add (&actions[nr].cycles, rdtsc () - start,
+						__ATOMIC_RELAXED);
+			}
+		intr_disable ();
+	}
+	c->in_softirq = false;
+}
+
+/* Prints softirq statistics. */
+void
+softirq_print_stats (void) {
+	for (int nr = 0; nr < SOFTIRQ_CNT; nr++)
+		if (actions[nr].run_cnt > 0)
+			printf ("Softirq: %s: %lld raised, %lld runs, %"PRIu64" us\n",
+					actions[nr].name, actions[nr].raise_cnt, actions[nr].run_cnt,
+					timer_cycles_to_us (actions[nr].cycles));
+}
@@ -27,11 +27,318 @@
    */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+/* If true, record contention statistics for every semaphore,
+   lock, and condition variable with a lock_class. */
+bool lock_profiling;
+
+/* Classes that have recorded something, most recent first. */
+static struct lock_class *lock_classes;
+
+/* Statistics of one profiled semaphore, lock, or condition
+   variable.  Records are handed out from lockstats[] on an
+   object's first profiled acquisition and never freed, so they
+   outlive objects that go away, such as locks on the stack.  An
+   object initialized again gets a new record. */
+struct lockstat {
+	const void *obj;            /* The object, as a name for it. */
+	struct lock_class *class;   /* Where it was initialized. */
+	struct lock_stats stats;
+};
+
+/* Number of objects whose statistics are kept.  Objects beyond
+   are only counted in their class. */
+#define LOCKSTAT_CNT 512
+
+static struct lockstat lockstats[LOCKSTAT_CNT];
+static int lockstat_cnt;
+
+/* Protects lock_classes, lockstats[], and the statistics in every
+   class and record. */
+static struct spinlock lockstat_lock;
+
+/* Serializes priority donation; see synch.h.  Zero-initialized
+   storage is an unlocked spinlock. */
+struct spinlock donation_lock;
+
+/* Number of objects and of classes printed by lock_print_stats(). */
+#define LOCKSTAT_TOP 10
+
+static void lockstat_acquired (const void *obj, struct lock_class *,
+		struct lockstat **, bool contended, uint64_t wait);
+static void lockstat_released (struct lock_class *, struct lockstat *,
+		uint64_t hold);
+static bool waitqueue_donates (const struct waitqueue *);
+static void waitqueue_lock (struct waitqueue *);
+static void waitqueue_unlock (struct waitqueue *);
+static struct thread *waitqueue_holder (const struct waitqueue *);
+static void waitqueue_insert (struct waitqueue *, struct thread *);
+static void waitqueue_remove (struct waitqueue *, struct thread *);
+static bool waitqueue_block (struct waitqueue *, int64_t deadline);
+static void waitqueue_timeout (void *t_);
+static bool sema_down_until (struct semaphore *, int64_t deadline);
+static bool lock_acquire_until (struct lock *, int64_t deadline);
+static void lock_take (struct lock *, struct thread *);
+static void lock_drop (struct lock *);
+static bool cond_wait_until (struct condition *, struct lock *,
+		int64_t deadline);
+static int64_t timeout_to_deadline (int64_t ticks);
+
+/* Initializes wait queue WQ.  If LOCK is nonnull, WQ holds the
+   threads waiting for LOCK, which donate their priority to its
+   holder. */
+void
+waitqueue_init (struct waitqueue *wq, struct lock *lock) {
+	ASSERT (wq != NULL);
+
+	spin_init (&wq->spin);
+	heap_init (&wq->waiters, thread_priority_less, NULL);
+	wq->lock = lock;
+}
+
+/* Blocks the running thread on WQ until another thread wakes it
+   with waitqueue_wake_one() or waitqueue_wake_all(), or until
+   timer_ticks() reaches DEADLINE, whichever comes first.  Pass
+   WAIT_FOREVER for no deadline.  Returns true if woken, false if
+   the deadline passed.  The caller must recheck whatever it was
+   waiting for, since another thread may have run in between.
+
+   WQ must be locked, as by waitqueue_lock(), so that a wakeup
+   between checking the condition and calling this function
+   cannot be lost.  It is unlocked while the thread sleeps and
+   locked again before returning. */
+bool
+waitqueue_wait (struct waitqueue *wq, int64_t deadline) {
+	ASSERT (wq != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (spin_held (&wq->spin));
+
+	if (deadline != WAIT_FOREVER && timer_ticks () >= deadline)
+		return false;
 
+	waitqueue_insert (wq, thread_current ());
+	return waitqueue_block (wq, deadline);
+}
+
+/* Wakes the highest-priority thread waiting on WQ, if any, and
+   returns it, or returns a null pointer if WQ is empty.  The
+   thread may already be running elsewhere by the time this
+   returns.  The caller decides whether to yield.  WQ must be
+   locked.
+
+   This function may be called from an interrupt handler. */
+struct thread *
+waitqueue_wake_one (struct waitqueue *wq) {
+	struct thread *t;
+
+	ASSERT (wq != NULL);
+	ASSERT (spin_held (&wq->spin));
+
+	if (heap_empty (&wq->waiters))
+		return NULL;
+	t = heap_entry (heap_max (&wq->waiters), struct thread, wait_elem);
+	waitqueue_remove (wq, t);
+
+	/* A thread on its way into cond_wait() is queued before it
+	   blocks, and notices on its own that it was woken. */
+	if (t->status == THREAD_BLOCKED)
+		thread_unblock (t);
+	return t;
+}
+
+/* Wakes every thread waiting on WQ, highest priority first, and
+   returns how many there were.  WQ must be locked. */
+int
+waitqueue_wake_all (struct waitqueue *wq) {
+	int cnt = 0;
+
+	while (waitqueue_wake_one (wq) != NULL)
+		cnt++;
+	return cnt;
+}
+
+/* Returns true if no thread is waiting on WQ. */
+bool
+waitqueue_empty (const struct waitqueue *wq) {
+	return heap_empty (&wq->waiters);
+}
+
+/* Returns the priority of the highest-priority thread waiting on
+   WQ, or PRI_MIN - 1 if WQ is empty. */
+int
+waitqueue_max_priority (const struct waitqueue *wq) {
+	if (heap_empty (&wq->waiters))
+		return PRI_MIN - 1;
+	return heap_entry (heap_max (&wq->waiters),
+			struct thread, wait_elem)->priority;
+}
+
+/* Returns true if WQ's waiters donate their priority to the
+   holder of its lock. */
+static bool
+waitqueue_donates (const struct waitqueue *wq) {
+	return wq->lock != NULL && !thread_mlfqs;
+}
+
+/* Locks WQ: turns off interrupts, which the caller must restore,
+   and takes WQ's spinlock, preceded by donation_lock if WQ
+   donates. */
+static void
+waitqueue_lock (struct waitqueue *wq) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (waitqueue_donates (wq))
+		spin_lock (&donation_lock);
+	spin_lock (&wq->spin);
+}
+
+/* Unlocks WQ, locked by waitqueue_lock(). */
+static void
+waitqueue_unlock (struct waitqueue *wq) {
+	spin_unlock (&wq->spin);
+	if (waitqueue_donates (wq))
+		spin_unlock (&donation_lock);
+}
+
+/* Returns the thread that WQ's waiters donate priority to, or a
+   null pointer if there is none. */
+static struct thread *
+waitqueue_holder (const struct waitqueue *wq) {
+	if (!waitqueue_donates (wq))
+		return NULL;
+	return wq->lock->holder;
+}
+
+/* Adds T to WQ, which must be locked.  If WQ belongs to a lock,
+   the lock's place among its holder's held locks depends on its
+   highest waiter, so the lock is taken out around the change and
+   the holder's priority recomputed after.  A holder only keeps
+   the locks that have waiters among its held locks. */
+static void
+waitqueue_insert (struct waitqueue *wq, struct thread *t) {
+	struct thread *holder = waitqueue_holder (wq);
+
+	ASSERT (spin_held (&wq->spin));
+	ASSERT (t->waitqueue == NULL);
+
+	if (holder != NULL && !heap_empty (&wq->waiters))
+		heap_remove (&holder->held_locks, &wq->lock->elem);
+	spin_lock (&t->wake_lock);
+	t->waitqueue = wq;
+	t->wait_timed_out = false;
+	heap_push (&wq->waiters, &t->wait_elem);
+	spin_unlock (&t->wake_lock);
+	if (holder != NULL) {
+		heap_push (&holder->held_locks, &wq->lock->elem);
+		thread_refresh_priority (holder);
+	}
+}
+
+/* Removes T from WQ, the reverse of waitqueue_insert(). */
+static void
+waitqueue_remove (struct waitqueue *wq, struct thread *t) {
+	struct thread *holder = waitqueue_holder (wq);
+
+	ASSERT (spin_held (&wq->spin));
+	ASSERT (t->waitqueue == wq);
+
+	if (holder != NULL)
+		heap_remove (&holder->held_locks, &wq->lock->elem);
+	spin_lock (&t->wake_lock);
+	heap_remove (&wq->waiters, &t->wait_elem);
+	t->waitqueue = NULL;
+	spin_unlock (&t->wake_lock);
+	if (holder != NULL) {
+		if (!heap_empty (&wq->waiters))
+			heap_push (&holder->held_locks, &wq->lock->elem);
+		thread_refresh_priority (holder);
+	}
+}
+
+/* Blocks the running thread, which waitqueue_insert() put on WQ,
+   until a wakeup takes it off again or timer_ticks() reaches
+   DEADLINE.  Returns at once if it is no longer on WQ.  WQ must
+   be locked; it is unlocked while the thread sleeps.  Returns
+   true unless the deadline passed. */
+static bool
+waitqueue_block (struct waitqueue *wq, int64_t deadline) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (spin_held (&wq->spin));
+
+	if (curr->waitqueue != wq)
+		return true;
+	if (deadline != WAIT_FOREVER) {
+		if (timer_ticks () >= deadline) {
+			waitqueue_remove (wq, curr);
+			return false;
+		}
+		timer_event_init (&curr->wait_timer, waitqueue_timeout, curr);
+		timer_event_add (&curr->wait_timer, deadline);
+	}
+	if (waitqueue_donates (wq))
+		spin_unlock (&donation_lock);
+	thread_block_unlock (&wq->spin);
+
+	/* Wakers leave the timer alone: cancelling it waits for a
+	   callback that may be spinning on WQ. */
+	if (deadline != WAIT_FOREVER)
+		timer_event_cancel (&curr->wait_timer);
+	waitqueue_lock (wq);
+	return !curr->wait_timed_out;
+}
+
+/* Timer callback that ends thread T_'s wait when its deadline
+   passes.  Runs in the timer softirq, so preemption is requested
+   on return instead of yielding here.  T's wait queue can only
+   be locked in the usual order after T's wake_lock is dropped,
+   so it is tried while holding wake_lock, and the attempt
+   repeated until it succeeds or T is no longer waiting. */
+static void
+waitqueue_timeout (void *t_) {
+	struct thread *t = t_;
+	struct waitqueue *wq;
+
+	ASSERT (intr_context ());
+
+	spin_lock (&donation_lock);
+	for (;;) {
+		spin_lock (&t->wake_lock);
+		wq = t->waitqueue;
+		if (wq == NULL) {
+			spin_unlock (&t->wake_lock);
+			spin_unlock (&donation_lock);
+			return;
+		}
+		if (spin_trylock (&wq->spin))
+			break;
+		spin_unlock (&t->wake_lock);
+		asm volatile ("pause");
+	}
+	spin_unlock (&t->wake_lock);
+
+	waitqueue_remove (wq, t);
+	t->wait_timed_out = true;
+	spin_unlock (&wq->spin);
+	spin_unlock (&donation_lock);
+	thread_unblock (t);
+	test_max_priority ();
+}
+
+/* Returns the timer tick at which a wait of TICKS timer ticks
+   starting now ends. */
+static int64_t
+timeout_to_deadline (int64_t ticks) {
+	return ticks > 0 ? timer_ticks () + ticks : timer_ticks ();
+}
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -43,16 +350,15 @@
    - up or "V": increment the value (and wake up one waiting
    thread, if any). */
 
-
-bool cmp_sema_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
-
-
 void
-sema_init (struct semaphore *sema, unsigned value) {
+sema_init_class (struct semaphore *sema, unsigned value,
+		struct lock_class *class) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	waitqueue_init (&sema->waiters, NULL);
+	sema->class = class;
+	sema->stats = NULL;
 }
 
 /* sema_down 함수는 특정 리소스에 대한 액세스를 제어하기 위해 세마포어를 사용하는데,
@@ -64,19 +370,50 @@ sema_init (struct semaphore *sema, unsigned value) {
  이런 식으로 sema_down 함수는 세마포어를 이용해 공유 리소스에 대한 스레드 접근을 동기화하고 제어하는 역할을 합니다. */
 void
 sema_down (struct semaphore *sema) {
+	sema_down_until (sema, WAIT_FOREVER);
+}
+
+/* Down or "P" operation on a semaphore, giving up after TICKS
+   timer ticks.  Returns true if the semaphore is decremented,
+   false if the time ran out first.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+sema_down_timeout (struct semaphore *sema, int64_t ticks) {
+	return sema_down_until (sema, timeout_to_deadline (ticks));
+}
+
+/* Waits for SEMA's value to become positive and decrements it,
+   or gives up once timer_ticks() reaches DEADLINE.  Returns true
+   if successful. */
+static bool
+sema_down_until (struct semaphore *sema, int64_t deadline) {
 	enum intr_level old_level;
+	uint64_t start = 0;
+	bool contended;
 
 	ASSERT (sema != NULL);
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	while (sema->value == 0) {
-		// list_push_back (&sema->waiters, &thread_current ()->elem);
-		list_insert_ordered(&sema->waiters, &thread_current()->elem, cmp_sema_priority, NULL);
-		thread_block ();
-	}
+	waitqueue_lock (&sema->waiters);
+	contended = sema->value == 0;
+	if (contended && lock_profiling)
+		start = rdtsc ();
+	while (sema->value == 0)
+		if (!waitqueue_wait (&sema->waiters, deadline)) {
+			waitqueue_unlock (&sema->waiters);
+			intr_set_level (old_level);
+			return false;
+		}
 	sema->value--;
+	waitqueue_unlock (&sema->waiters);
+	if (lock_profiling && sema->class != NULL)
+		lockstat_acquired (sema, sema->class, &sema->stats, contended,
+				rdtsc () - start);
 	intr_set_level (old_level);
+	return true;
 }
 
 /* Down or "P" operation on a semaphore, but only if the
@@ -92,13 +429,13 @@ sema_try_down (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	if (sema->value > 0)
-	{
+	waitqueue_lock (&sema->waiters);
+	success = sema->value > 0;
+	if (success)
 		sema->value--;
-		success = true;
-	}
-	else
-		success = false;
+	waitqueue_unlock (&sema->waiters);
+	if (success && lock_profiling && sema->class != NULL)
+		lockstat_acquired (sema, sema->class, &sema->stats, false, 0);
 	intr_set_level (old_level);
 
 	return success;
@@ -115,13 +452,11 @@ sema_up (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	list_sort(&sema->waiters, cmp_priority, NULL);
-	if (!list_empty (&sema->waiters))
-		thread_unblock (list_entry (list_pop_front (&sema->waiters),
-					struct thread, elem));
-		
+	waitqueue_lock (&sema->waiters);
 	sema->value++;
-	test_max_priority();
+	waitqueue_wake_one (&sema->waiters);
+	waitqueue_unlock (&sema->waiters);
+	test_max_priority ();
 	intr_set_level (old_level);
 }
 
@@ -168,13 +503,16 @@ sema_test_helper (void *sema_) {
 동작:
 - lock이 NULL인지 확인하고, NULL이 아니라면 ASSERT를 통해 확인합니다.
 - lock의 holder를 NULL로 설정합니다.
-- lock의 semaphore를 1로 초기화합니다. */
+- lock의 waiters 힙을 초기화합니다. */
 void
-lock_init (struct lock *lock) {
+lock_init_class (struct lock *lock, struct lock_class *class) {
 	ASSERT (lock != NULL);
 
 	lock->holder = NULL;
-	sema_init (&lock->semaphore, 1);
+	waitqueue_init (&lock->waiters, lock);
+	lock->class = class;
+	lock->stats = NULL;
+	lock->acquire_time = 0;
 }
 
 /* 
@@ -186,31 +524,69 @@ ASSERT (!intr_context ()); : 현재 코드가 인터럽트 컨텍스트 내에
 
 ASSERT (!lock_held_by_current_thread (lock)); : 현재 스레드가 이미 lock을 가지고 있지 않은지 확인합니다. 재진입을 방지하기 위한 것으로, 이미 lock을 가지고 있는 스레드가 다시 lock을 획득하려고 시도하는 것을 방지합니다.
 
-sema_down (&lock->semaphore); : 세마포어를 사용하여 lock 획득을 시도합니다. 이 함수는 lock이 사용 가능해질 때까지 현재 스레드를 차단합니다.
+waitqueue_wait (&lock->waiters, deadline); : lock이 사용 중이면 현재 스레드를 lock의 waiters 큐에 넣고 lock 소유자에게 우선순위를 기부한 뒤, lock이 해제될 때까지 현재 스레드를 차단합니다.
 
 lock->holder = thread_current (); : lock을 획득한 후에, 이 함수는 lock의 소유자를 현재 스레드로 설정합니다. 이는 다른 스레드가 이 lock을 사용하려는 시도를 방지합니다.
 
 결국, 이 함수는 전달받은 lock을 안전하게 획득하는 역할을 합니다. 만약 lock이 이미 다른 스레드에 의해 사용 중이라면, 해당 lock이 해제될 때까지 기다립니다.*/
 void
 lock_acquire (struct lock *lock) {
-	
-	int curr_priority = thread_get_priority();
+	lock_acquire_until (lock, WAIT_FOREVER);
+}
+
+/* Acquires LOCK like lock_acquire(), but gives up after TICKS
+   timer ticks.  Returns true if LOCK was acquired, false if the
+   time ran out first, in which case the priority the current
+   thread donated while waiting is withdrawn.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+lock_acquire_timeout (struct lock *lock, int64_t ticks) {
+	return lock_acquire_until (lock, timeout_to_deadline (ticks));
+}
+
+/* Acquires LOCK, sleeping until it becomes available or
+   timer_ticks() reaches DEADLINE.  Returns true if successful. */
+static bool
+lock_acquire_until (struct lock *lock, int64_t deadline) {
+	enum intr_level old_level;
+	uint64_t start = 0;
+	bool contended = false;
 
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
-	/*🙌*/
-	// if (lock->holder != NULL)
-	// {
-	// 	thread_current()->waiting_lock = lock;
-	// 	if (lock->holder->priority < curr_priority)	
-	// 		nested_donation(lock, curr_priority);
-	// 	list_push_back(&lock->holder->donations, &thread_current()->d_elem);		
-	// }
-	sema_down (&lock->semaphore);
-	lock->holder = thread_current ();
-	thread_current()->waiting_lock = NULL;
-	
+
+	/* A free lock without waiters involves no donation, so it is
+	   taken with only its wait queue's spinlock. */
+	old_level = intr_disable ();
+	spin_lock (&lock->waiters.spin);
+	if (lock->holder == NULL && waitqueue_empty (&lock->waiters)) {
+		lock_take (lock, thread_current ());
+		spin_unlock (&lock->waiters.spin);
+	} else {
+		spin_unlock (&lock->waiters.spin);
+		waitqueue_lock (&lock->waiters);
+		contended = lock->holder != NULL;
+		if (contended && lock_profiling)
+			start = rdtsc ();
+		while (lock->holder != NULL)
+			if (!waitqueue_wait (&lock->waiters, deadline)) {
+				waitqueue_unlock (&lock->waiters);
+				intr_set_level (old_level);
+				return false;
+			}
+		lock_take (lock, thread_current ());
+		waitqueue_unlock (&lock->waiters);
+	}
+	if (lock_profiling && lock->class != NULL) {
+		lockstat_acquired (lock, lock->class, &lock->stats, contended,
+				rdtsc () - start);
+		lock->acquire_time = rdtsc ();
+	}
+	intr_set_level (old_level);
+	return true;
 }
 
 /* 해당 코드는 LOCK을 획득하려고 시도하고, 성공하면 true를 반환하고 실패하면 false를 반환합니다.
@@ -218,71 +594,124 @@ lock_acquire (struct lock *lock) {
  이 함수는 슬립하지 않으므로 인터럽트 핸들러 내에서 호출될 수 있습니다. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	success = sema_try_down (&lock->semaphore);
-	if (success)
-		lock->holder = thread_current ();
+	old_level = intr_disable ();
+	spin_lock (&lock->waiters.spin);
+	success = lock->holder == NULL;
+	if (success && !waitqueue_empty (&lock->waiters)) {
+		/* Taking over the waiters takes over their donations. */
+		spin_unlock (&lock->waiters.spin);
+		waitqueue_lock (&lock->waiters);
+		success = lock->holder == NULL;
+		if (success)
+			lock_take (lock, thread_current ());
+		waitqueue_unlock (&lock->waiters);
+	} else {
+		if (success)
+			lock_take (lock, thread_current ());
+		spin_unlock (&lock->waiters.spin);
+	}
+	if (success) {
+		if (lock_profiling && lock->class != NULL) {
+			lockstat_acquired (lock, lock->class, &lock->stats, false, 0);
+			lock->acquire_time = rdtsc ();
+		}
+	}
+	intr_set_level (old_level);
 	return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
-   This is lock_release function.
+   This is lock_release function.  Wakes the highest-priority
+   waiter and gives up the priority donated through LOCK.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
 void
 lock_release (struct lock *lock) {
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
-	/*👍*/
-	if (thread_mlfqs == false) {
-		remove_lock(lock);
-		donate_priority();
+
+	old_level = intr_disable ();
+	lock_drop (lock);
+	test_max_priority ();
+	intr_set_level (old_level);
+}
+
+/* Releases LOCK, which the running thread holds, and wakes its
+   highest-priority waiter, without yielding.  Interrupts must be
+   off. */
+static void
+lock_drop (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	struct waitqueue *wq = &lock->waiters;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (lock_profiling && lock->class != NULL)
+		lockstat_released (lock->class, lock->stats,
+				rdtsc () - lock->acquire_time);
+
+	spin_lock (&wq->spin);
+	if (waitqueue_empty (wq)) {
+		lock->holder = NULL;
+		spin_unlock (&wq->spin);
+		return;
 	}
+	spin_unlock (&wq->spin);
 
+	/* The waiters' donations go with the lock. */
+	waitqueue_lock (wq);
+	if (waitqueue_donates (wq) && !waitqueue_empty (wq))
+		heap_remove (&curr->held_locks, &lock->elem);
 	lock->holder = NULL;
-	sema_up (&lock->semaphore);
-	// {
-	// 	int holder_priority;
-	// 	int donor_priority;
-	// 	holder_priority = lock->holder->original_priority;
-	// 	/* donation list 에서 스레드를 제거하고
-	// 	우선순위를 다시 계산하도록 remove_with_lock():donation list에서 스레드 엔트리를 제거 *
-	// 	, refresh_priority():우선순위를 다시 계산 함수를 호출 */
-
-	// 	if (!list_empty(&lock->holder->donations))
-	// 	{
-	// 		/*donation list에서 스레드 엔트리를 제거*/
-	// 		remove_released_thread(lock);
-	// 		/* priority를 다시 계산 함수를 호출
-	// 			lock holder의 priority 무조건 최대로하기
-	// 		*/
-	// 		/*multiple donation*/
-	// 		donor_priority = find_max_priority(&lock->holder->donations);
-	// 		if (donor_priority > holder_priority) /*lock들고 있는 thread의 priority가 크다면 그값을 갖고 아니면 donate 전 값이 높다면 그 값으로 */
-	// 			lock->holder->priority = donor_priority;
-	// 		else
-	// 			lock->holder->priority = holder_priority;
-	// 	}
-	// 	/*lock 대기 중인 thread 있음*/
-	// 	if (lock->holder->waiting_lock != NULL)
-	// 	{ /*thread priority 물려주기*/
-	// 		nested_donation(lock->holder->waiting_lock, lock->holder->priority);
-	// 	}
-	// }
-	
-	
-	lock->holder = NULL;
-	sema_up (&lock->semaphore);
+	waitqueue_wake_one (wq);
+	if (waitqueue_donates (wq))
+		thread_refresh_priority (curr);
+	waitqueue_unlock (wq);
 }
 
+/* Makes T, the running thread, the holder of free LOCK.  Threads
+   still waiting for LOCK donate their priority to T, which
+   requires LOCK's wait queue to be locked; a lock without waiters
+   only needs the queue's spinlock. */
+static void
+lock_take (struct lock *lock, struct thread *t) {
+	ASSERT (spin_held (&lock->waiters.spin));
+	ASSERT (lock->holder == NULL);
+
+	lock->holder = t;
+	if (waitqueue_donates (&lock->waiters)
+			&& !waitqueue_empty (&lock->waiters)) {
+		ASSERT (spin_held (&donation_lock));
+		heap_push (&t->held_locks, &lock->elem);
+		thread_refresh_priority (t);
+	}
+}
 
+/* Returns the priority LOCK donates to its holder: that of its
+   highest-priority waiter, or PRI_MIN - 1 if it has none. */
+int
+lock_donated_priority (const struct lock *lock) {
+	return waitqueue_max_priority (&lock->waiters);
+}
 
+/* Returns true if the lock with elem A donates less priority
+   than the lock with elem B. */
+bool
+lock_donation_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return lock_donated_priority (heap_entry (a, struct lock, elem))
+		< lock_donated_priority (heap_entry (b, struct lock, elem));
+}
 
 /* Returns true if the current thread holds LOCK, false
    otherwise.  (Note that testing whether some other thread holds
@@ -294,21 +723,16 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
-	struct semaphore semaphore;         /* This semaphore. */
-	int priority;
-};
-
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
 void
-cond_init (struct condition *cond) {
+cond_init_class (struct condition *cond, struct lock_class *class) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	waitqueue_init (&cond->waiters, NULL);
+	cond->class = class;
+	cond->stats = NULL;
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -333,19 +757,56 @@ cond_init (struct condition *cond) {
    we need to sleep. */
 void
 cond_wait (struct condition *cond, struct lock *lock) {
-	struct semaphore_elem waiter;
+	cond_wait_until (cond, lock, WAIT_FOREVER);
+}
+
+/* Like cond_wait(), but gives up waiting for COND after TICKS
+   timer ticks.  LOCK is reacquired before returning either way.
+   Returns true if COND was signaled, false if the time ran out
+   first.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+cond_wait_timeout (struct condition *cond, struct lock *lock, int64_t ticks) {
+	return cond_wait_until (cond, lock, timeout_to_deadline (ticks));
+}
+
+/* Releases LOCK, waits for COND to be signaled or timer_ticks()
+   to reach DEADLINE, and reacquires LOCK.  Returns true if COND
+   was signaled.  Waiters are woken in order of their priority at
+   signal time, so donations received while waiting count. */
+static bool
+cond_wait_until (struct condition *cond, struct lock *lock,
+		int64_t deadline) {
+	enum intr_level old_level;
+	uint64_t start;
+	bool signaled;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
-	/*😂*/
-	waiter.priority = thread_get_priority();
-	sema_init (&waiter.semaphore, 0);
-	list_insert_ordered(&cond->waiters, &waiter.elem, cmp_sema_priority, NULL);
-	lock_release (lock);
-	sema_down (&waiter.semaphore);
+
+	/* Joining COND's queue before releasing LOCK keeps a signal
+	   from slipping in between.  The signal may then come before
+	   this thread blocks, which waitqueue_block() notices. */
+	old_level = intr_disable ();
+	start = rdtsc ();
+	spin_lock (&cond->waiters.spin);
+	waitqueue_insert (&cond->waiters, thread_current ());
+	spin_unlock (&cond->waiters.spin);
+	lock_drop (lock);
+	spin_lock (&cond->waiters.spin);
+	signaled = waitqueue_block (&cond->waiters, deadline);
+	spin_unlock (&cond->waiters.spin);
+	if (lock_profiling && cond->class != NULL)
+		lockstat_acquired (cond, cond->class, &cond->stats, true,
+				rdtsc () - start);
+	intr_set_level (old_level);
+
 	lock_acquire (lock);
+	return signaled;
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
@@ -357,14 +818,21 @@ cond_wait (struct condition *cond, struct lock *lock) {
    interrupt handler. */
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) {
+	enum intr_level old_level;
+	bool woken;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters))
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	old_level = intr_disable ();
+	spin_lock (&cond->waiters.spin);
+	woken = waitqueue_wake_one (&cond->waiters) != NULL;
+	spin_unlock (&cond->waiters.spin);
+	if (woken)
+		test_max_priority ();
+	intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -375,19 +843,524 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
    interrupt handler. */
 void
 cond_broadcast (struct condition *cond, struct lock *lock) {
+	enum intr_level old_level;
+	bool woken;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (lock_held_by_current_thread (lock));
 
-	while (!list_empty (&cond->waiters))
-		cond_signal (cond, lock);
+	old_level = intr_disable ();
+	spin_lock (&cond->waiters.spin);
+	woken = waitqueue_wake_all (&cond->waiters) > 0;
+	spin_unlock (&cond->waiters.spin);
+	if (woken)
+		test_max_priority ();
+	intr_set_level (old_level);
 }
 
-bool cmp_sema_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
-{
-	int priority_a = list_entry(a, struct semaphore_elem, elem)->priority;/*list_entry 함수를 사용하여 첫 번째 리스트 원소(a)를 struct thread 타입으로 변환합니다.*/
-	int priority_b = list_entry(b, struct semaphore_elem, elem)->priority;/*list_entry 함수를 사용하여 두 번째 리스트 원소(b)를 struct thread 타입으로 변환합니다.*/
-	
-	return priority_a > priority_b;	/*첫 번째 스레드(thread_a)의 우선 순위가 두 번째 스레드(thread_b)의 우선 순위보다 높으면 true를 반환합니다.*/
-	
-};
+/* Initializes readers-writer lock RW.  If PREFER_WRITERS is true,
+   a reader that arrives while a writer holds or is waiting for
+   RW waits until the writer is done, so that a steady stream of
+   readers cannot starve writers.  Otherwise readers may join
+   other readers until a writer has actually taken RW.  CLASS
+   collects lock profiling statistics.
+
+   The reader count and the writing flag are protected by the
+   spinlock of RW's lock's wait queue, which also protects that
+   lock's holder, so that a reader can check for a writer and
+   count itself in one step. */
+void
+rwlock_init_class (struct rwlock *rw, bool prefer_writers,
+		struct lock_class *class) {
+	int i;
+
+	ASSERT (rw != NULL);
+
+	lock_init_class (&rw->lock, class);
+	for (i = 0; i < RWLOCK_HOLDS; i++)
+		lock_init_class (&rw->holds[i], NULL);
+	sema_init_class (&rw->drained, 0, NULL);
+	rw->readers = 0;
+	rw->writing = false;
+	rw->draining = false;
+	rw->prefer_writers = prefer_writers;
+}
+
+/* Returns true if a new reader of RW must wait for a writer.
+   The spinlock of RW's lock's wait queue must be held. */
+static bool
+rwlock_reader_must_wait (const struct rwlock *rw) {
+	return rw->lock.holder != NULL && (rw->writing || rw->prefer_writers);
+}
 
+/* Takes a free read hold of RW for the current thread and
+   returns it, or returns a null pointer if all are in use.
+   Never sleeps. */
+static struct lock *
+rwlock_take_hold (struct rwlock *rw) {
+	int i;
+
+	for (i = 0; i < RWLOCK_HOLDS; i++)
+		if (!lock_held_by_current_thread (&rw->holds[i])
+				&& lock_try_acquire (&rw->holds[i]))
+			return &rw->holds[i];
+	return NULL;
+}
+
+/* Returns a read hold of RW that the current thread holds, or a
+   null pointer if it was only counted. */
+static struct lock *
+rwlock_own_hold (struct rwlock *rw) {
+	int i;
+
+	for (i = 0; i < RWLOCK_HOLDS; i++)
+		if (lock_held_by_current_thread (&rw->holds[i]))
+			return &rw->holds[i];
+	return NULL;
+}
+
+/* Releases HOLD, if nonnull. */
+static void
+rwlock_drop_hold (struct lock *hold) {
+	if (hold != NULL)
+		lock_release (hold);
+}
+
+/* Counts a reader into RW if none has to wait for a writer, and
+   returns true if it did. */
+static bool
+rwlock_enter_read (struct rwlock *rw) {
+	enum intr_level old_level = intr_disable ();
+	bool success;
+
+	spin_lock (&rw->lock.waiters.spin);
+	success = !rwlock_reader_must_wait (rw);
+	if (success)
+		rw->readers++;
+	spin_unlock (&rw->lock.waiters.spin);
+	intr_set_level (old_level);
+	return success;
+}
+
+/* Adds DELTA to RW's reader count and sets its writing flag to
+   WRITING.  Returns the new reader count. */
+static unsigned
+rwlock_update (struct rwlock *rw, int delta, bool writing) {
+	enum intr_level old_level = intr_disable ();
+	unsigned readers;
+
+	spin_lock (&rw->lock.waiters.spin);
+	ASSERT (delta >= 0 || rw->readers > 0);
+	readers = rw->readers += delta;
+	rw->writing = writing;
+	spin_unlock (&rw->lock.waiters.spin);
+	intr_set_level (old_level);
+	return readers;
+}
+
+/* Acquires RW for reading, sleeping until no writer has it.  A
+   reader that has to wait queues on RW's lock, which donates its
+   priority to the writer.  The reader takes its read hold before
+   it counts itself in, so that a writer that sees it counted
+   can find it, and gives the hold back while it waits, since the
+   writer may be waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	struct lock *hold;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!lock_held_by_current_thread (&rw->lock));
+
+	hold = rwlock_take_hold (rw);
+	if (!rwlock_enter_read (rw)) {
+		rwlock_drop_hold (hold);
+		lock_acquire (&rw->lock);
+		rwlock_take_hold (rw);
+		rwlock_update (rw, 1, false);
+		lock_release (&rw->lock);
+	}
+}
+
+/* Tries to acquire RW for reading without sleeping.  Returns
+   true if successful, false otherwise. */
+bool
+rwlock_try_acquire_read (struct rwlock *rw) {
+	struct lock *hold;
+
+	ASSERT (rw != NULL);
+
+	hold = rwlock_take_hold (rw);
+	if (rwlock_enter_read (rw))
+		return true;
+	rwlock_drop_hold (hold);
+	return false;
+}
+
+/* Releases RW, which the current thread holds for reading.  The
+   last reader out wakes a writer waiting on RW's drained
+   semaphore; giving back the read hold wakes a writer waiting
+   for this reader in particular. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	enum intr_level old_level;
+	bool drained;
+
+	ASSERT (rw != NULL);
+
+	old_level = intr_disable ();
+	spin_lock (&rw->lock.waiters.spin);
+	ASSERT (rw->readers > 0);
+	drained = --rw->readers == 0 && rw->draining;
+	if (drained)
+		rw->draining = false;
+	spin_unlock (&rw->lock.waiters.spin);
+	if (drained)
+		sema_up (&rw->drained);
+	intr_set_level (old_level);
+	rwlock_drop_hold (rwlock_own_hold (rw));
+}
+
+/* Waits until RW has no readers, then marks the current thread,
+   which holds RW's lock, as the writer.  While a reader holds a
+   read hold, the writer waits by acquiring that hold, donating
+   its priority to the reader; once only counted readers remain,
+   it sleeps on RW's drained semaphore until the last one
+   leaves. */
+static void
+rwlock_drain (struct rwlock *rw) {
+	ASSERT (lock_held_by_current_thread (&rw->lock));
+
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		struct lock *hold = NULL;
+		int i;
+
+		spin_lock (&rw->lock.waiters.spin);
+		if (rw->readers == 0) {
+			rw->writing = true;
+			spin_unlock (&rw->lock.waiters.spin);
+			intr_set_level (old_level);
+			return;
+		}
+		/* Readers take their holds before counting themselves
+		   in, so every reader counted with a hold shows up
+		   here.  A hold found just as its reader leaves is
+		   only waited for briefly. */
+		for (i = 0; i < RWLOCK_HOLDS && hold == NULL; i++)
+			if (rw->holds[i].holder != NULL)
+				hold = &rw->holds[i];
+		if (hold == NULL)
+			rw->draining = true;
+		spin_unlock (&rw->lock.waiters.spin);
+		intr_set_level (old_level);
+
+		if (hold != NULL) {
+			lock_acquire (hold);
+			lock_release (hold);
+		} else
+			sema_down (&rw->drained);
+	}
+}
+
+/* Acquires RW for writing, sleeping until other writers and all
+   readers are done.  Other writers are waited for on RW's lock,
+   and readers on their read holds, with the usual priority
+   donation.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	lock_acquire (&rw->lock);
+	rwlock_drain (rw);
+}
+
+/* Tries to acquire RW for writing without sleeping.  Returns
+   true if successful, false otherwise. */
+bool
+rwlock_try_acquire_write (struct rwlock *rw) {
+	enum intr_level old_level;
+	bool success = false;
+
+	ASSERT (rw != NULL);
+
+	old_level = intr_disable ();
+	if (rw->readers == 0 && lock_try_acquire (&rw->lock)) {
+		/* A reader may have slipped in since the unlocked peek. */
+		spin_lock (&rw->lock.waiters.spin);
+		success = rw->readers == 0;
+		if (success)
+			rw->writing = true;
+		spin_unlock (&rw->lock.waiters.spin);
+		if (!success)
+			lock_drop (&rw->lock);
+	}
+	intr_set_level (old_level);
+	return success;
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	ASSERT (rwlock_held_for_write (rw));
+
+	rwlock_update (rw, 0, false);
+	lock_release (&rw->lock);
+}
+
+/* Converts the current thread's read hold on RW into a write
+   hold, waiting for any other readers to leave.  Fails, keeping
+   the read hold, if another writer holds or is acquiring RW:
+   two readers that both waited to upgrade would deadlock.  The
+   caller must then release RW and acquire it for writing, and
+   recheck whatever it read.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+rwlock_try_upgrade (struct rwlock *rw) {
+	struct lock *hold;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw->readers > 0);
+
+	hold = rwlock_own_hold (rw);
+	if (!lock_try_acquire (&rw->lock))
+		return false;
+	rwlock_update (rw, -1, false);
+	rwlock_drop_hold (hold);
+	rwlock_drain (rw);
+	return true;
+}
+
+/* Converts the current thread's write hold on RW into a read
+   hold, letting waiting readers in.  Never sleeps. */
+void
+rwlock_downgrade (struct rwlock *rw) {
+	ASSERT (rwlock_held_for_write (rw));
+
+	rwlock_take_hold (rw);
+	rwlock_update (rw, 1, false);
+	lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return rw->writing && lock_held_by_current_thread (&rw->lock);
+}
+
+/* Initializes spinlock L.  A spinlock can be held by at most a
+   single CPU at any given time, and it is not recursive. */
+void
+spin_init (struct spinlock *l) {
+	ASSERT (l != NULL);
+
+	l->locked = 0;
+	l->cpu = NULL;
+}
+
+/* Acquires spinlock L, busy-waiting until it becomes available.
+   L must not already be held by the current CPU.  Interrupts
+   must be off, or an interrupt handler that takes L on the same
+   CPU would spin forever, and the holder must not sleep until it
+   releases L. */
+void
+spin_lock (struct spinlock *l) {
+	ASSERT (l != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (!spin_held (l));
+
+	/* Spin on a plain read so that waiting CPUs do not keep
+	   stealing the cache line from the holder. */
+	while (__atomic_exchange_n (&l->locked, 1, __ATOMIC_ACQUIRE))
+		while (l->locked)
+			asm volatile ("pause");
+	l->cpu = this_cpu ();
+	l->cpu->spin_cnt++;
+}
+
+/* Tries to acquire spinlock L and returns true if successful or
+   false on failure.  Never spins.  Interrupts must be off. */
+bool
+spin_trylock (struct spinlock *l) {
+	ASSERT (l != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (!spin_held (l));
+
+	if (__atomic_exchange_n (&l->locked, 1, __ATOMIC_ACQUIRE))
+		return false;
+	l->cpu = this_cpu ();
+	l->cpu->spin_cnt++;
+	return true;
+}
+
+/* Releases spinlock L, which must be held by the current CPU. */
+void
+spin_unlock (struct spinlock *l) {
+	ASSERT (l != NULL);
+	ASSERT (spin_held (l));
+
+	l->cpu->spin_cnt--;
+	l->cpu = NULL;
+	__atomic_store_n (&l->locked, 0, __ATOMIC_RELEASE);
+}
+
+/* Returns true if the current CPU holds L, false otherwise. */
+bool
+spin_held (const struct spinlock *l) {
+	ASSERT (l != NULL);
+
+	return l->locked && l->cpu == this_cpu ();
+}
+
+/* Adds an acquisition, which blocked for WAIT TSC cycles if
+   CONTENDED, to STATS. */
+static void
+lock_stats_acquired (struct lock_stats *stats, bool contended,
+		uint64_t wait) {
+	stats->acquired++;
+	if (contended) {
+		stats->contended++;
+		stats->wait_time += wait;
+		if (wait > stats->max_wait_time)
+			stats->max_wait_time = wait;
+	}
+}
+
+/* Adds a hold of HOLD TSC cycles to STATS. */
+static void
+lock_stats_released (struct lock_stats *stats, uint64_t hold) {
+	stats->hold_time += hold;
+	if (hold > stats->max_hold_time)
+		stats->max_hold_time = hold;
+}
+
+/* Records an acquisition of OBJ, of CLASS, which blocked for WAIT
+   TSC cycles if CONTENDED.  *STATS is OBJ's record, which is
+   assigned on the first call if one is left.  Interrupts must be
+   off. */
+static void
+lockstat_acquired (const void *obj, struct lock_class *class,
+		struct lockstat **stats, bool contended, uint64_t wait) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	spin_lock (&lockstat_lock);
+	if (!class->registered) {
+		class->registered = true;
+		class->next = lock_classes;
+		lock_classes = class;
+	}
+	if (*stats == NULL && lockstat_cnt < LOCKSTAT_CNT) {
+		*stats = &lockstats[lockstat_cnt++];
+		(*stats)->obj = obj;
+		(*stats)->class = class;
+	}
+	lock_stats_acquired (&class->total, contended, wait);
+	if (*stats != NULL)
+		lock_stats_acquired (&(*stats)->stats, contended, wait);
+	spin_unlock (&lockstat_lock);
+}
+
+/* Records that a lock of CLASS, with record STATS if it has one,
+   was held for HOLD TSC cycles.  Interrupts must be off. */
+static void
+lockstat_released (struct lock_class *class, struct lockstat *stats,
+		uint64_t hold) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	spin_lock (&lockstat_lock);
+	lock_stats_released (&class->total, hold);
+	if (stats != NULL)
+		lock_stats_released (&stats->stats, hold);
+	spin_unlock (&lockstat_lock);
+}
+
+/* Inserts a copy of NEW into TOP, which holds *CNT copies sorted
+   by decreasing wait time, if it is among the LOCKSTAT_TOP
+   longest waits. */
+static void
+lockstat_rank (struct lockstat top[], int *cnt, const struct lockstat *new) {
+	int i;
+
+	for (i = *cnt; i > 0
+			&& top[i - 1].stats.wait_time < new->stats.wait_time; i--)
+		if (i < LOCKSTAT_TOP)
+			top[i] = top[i - 1];
+	if (i < LOCKSTAT_TOP) {
+		top[i] = *new;
+		if (*cnt < LOCKSTAT_TOP)
+			(*cnt)++;
+	}
+}
+
+/* Prints statistics S of the object or class named by LABEL,
+   initialized at CLASS. */
+static void
+lockstat_print (const char *label, const struct lock_class *class,
+		const struct lock_stats *s) {
+	printf ("Lockstat: %s %s (%s:%d): %"PRIu64" acquired, "
+			"%"PRIu64" contended, wait %"PRIu64" us (max %"PRIu64"), "
+			"hold %"PRIu64" us (max %"PRIu64")\n",
+			label, class->name, class->file, class->line, s->acquired,
+			s->contended, timer_cycles_to_us (s->wait_time),
+			timer_cycles_to_us (s->max_wait_time),
+			timer_cycles_to_us (s->hold_time),
+			timer_cycles_to_us (s->max_hold_time));
+}
+
+/* Prints the LOCKSTAT_TOP objects that spent the longest time
+   blocked, then the LOCKSTAT_TOP classes, each the sum of its
+   objects, if lock profiling is enabled. */
+void
+lock_print_stats (void) {
+	struct lockstat objs[LOCKSTAT_TOP], classes[LOCKSTAT_TOP];
+	struct lock_class *class;
+	enum intr_level old_level;
+	int obj_cnt = 0, obj_total, class_cnt = 0, class_total = 0;
+	char label[32];
+
+	if (!lock_profiling)
+		return;
+
+	/* Copy out the top entries first, since printing acquires the
+	   console lock and so updates the statistics. */
+	old_level = intr_disable ();
+	spin_lock (&lockstat_lock);
+	obj_total = lockstat_cnt;
+	for (int i = 0; i < lockstat_cnt; i++)
+		lockstat_rank (objs, &obj_cnt, &lockstats[i]);
+	for (class = lock_classes; class != NULL; class = class->next) {
+		struct lockstat sum = { .obj = NULL, .class = class,
+			.stats = class->total };
+
+		class_total++;
+		lockstat_rank (classes, &class_cnt, &sum);
+	}
+	spin_unlock (&lockstat_lock);
+	intr_set_level (old_level);
+
+	printf ("Lockstat: top %d of %d objects by wait time\n",
+			obj_cnt, obj_total);
+	for (int i = 0; i < obj_cnt; i++) {
+		snprintf (label, sizeof label, "%p", objs[i].obj);
+		lockstat_print (label, objs[i].class, &objs[i].stats);
+	}
+	printf ("Lockstat: top %d of %d classes by wait time\n",
+			class_cnt, class_total);
+	for (int i = 0; i < class_cnt; i++)
+		lockstat_print ("class", classes[i].class, &classes[i].stats);
+}
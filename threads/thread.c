@@ -1,15 +1,21 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -46,18 +52,22 @@ magic 멤버는 스택 오버플로우를 감지하기 위한 보조적인 수
  이들을 스케줄링하여 CPU를 공정하게 할당하는 데 도움이 됩니다.
  이 목록은 실행 대기 중인 프로세스들의 상태를 파악하고,
  프로세스 스케줄링 알고리즘에 의해 이들을 실행으로 전환할 수 있도록 도와줍니다. */
-static struct list ready_list;
-
-/*슬립 상태에 있는 스레드란, 일시적으로 실행을 중지하고 대기 상태에 있는 스레드를 말합니다.
- 스레드가 특정 이벤트의 발생을 기다리거나, 특정 시간 지연 후에 다시 실행되어야 할 때 슬립 상태에 들어갈 수 있습니다. */
-static struct list sleep_list;
+/* Each CPU has its own run queues, in struct cpu: ready_list[P]
+   holds the THREAD_READY threads of priority P, and bit P of
+   ready_mask is set iff ready_list[P] is non-empty, so the
+   highest runnable priority is a single find-first-set away.
+   With -cfs, cfs_ready takes the place of ready_list[]. */
 
 static struct list wait_list;
 
-/* 유휴 스레드 
- 예를 들어, 시스템에서는 CPU의 낭비를 방지하기 위해 유휴 상태일 때 주기적으로 타이머 인터럽트를 처리하거나,
- 전력 관리를 위한 작업을 수행할 수 있습니다. */
-static struct thread *idle_thread;
+/* List of all live threads, for the 4.4BSD scheduler's
+   once-per-second recomputation.  all_lock protects it and
+   load_avg. */
+static struct list all_list;
+static struct spinlock all_lock;
+
+/* Threads mlfqs_daemon() recomputes per critical section. */
+#define MLFQS_BATCH 16
 
 /* 초기 스레드
  "init.c:main()"을 실행 중인 스레드를 의미합니다.
@@ -71,41 +81,71 @@ static struct thread *initial_thread;
  tid_lock은 allocate_tid() 함수에서 스레드 식별자를 할당할 때 사용되는 락으로, 스레드 식별자 할당 작업이 동시에 실행되는 것을 방지하여 충돌을 예방합니다.*/
 static struct lock tid_lock;
 
-/* 스레드 소멸 요청을 관리하기 위한 리스트입니다 */
-/*destruction_req 리스트는 스레드 소멸 요청을 저장하고 관리하는 데 사용됩니다.
- 소멸 요청은 스레드가 종료되어야 할 때, 해당 스레드의 자원을 해제하고 정리하기 위해 사용됩니다.
- 이 리스트를 통해 스레드 소멸 요청을 추가하거나 처리할 수 있습니다.*/
-static struct list destruction_req;
-
-int64_t global_tick;
-
-/* Statistics. */
-static long long idle_ticks;    /* # 유휴 상태에서 소비한 타이머 틱의 수를 나타내는 long long 형식의 변수입니다. */
-static long long kernel_ticks;  /* # 커널 스레드가 실행되는 동안 소비한 타이머 틱의 수를 추적합니다. 커널 스레드는 운영 체제의 핵심 부분을 실행하는 스레드입니다. */
-static long long user_ticks;    /* # 용자 프로그램이 실행되는 동안 소비한 타이머 틱의 수를 추적합니다. 사용자 프로그램은 커널이 아닌 일반 응용 프로그램을 의미합니다. */
+/* 4.4BSD scheduler state.  The per-second recomputation of
+   load_avg, recent_cpu and every priority is O(threads), so the
+   timer interrupt only wakes mlfqs_thread to do it. */
+static fixed_t load_avg;                /* System load average. */
+static struct thread *mlfqs_thread;     /* Runs mlfqs_update(). */
+static struct semaphore mlfqs_sema;     /* Upped once per second. */
+static int64_t mlfqs_second;            /* Second of the last update. */
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # 각 스레드에 할당되는 타이머 틱의 수를 나타내는 상수입니다. 각 스레드는 TIME_SLICE 값만큼의 타이머 틱을 사용할 수 있습니다. */
-static unsigned thread_ticks;   /* # 마지막으로 스레드가 양보(yield)한 이후로 경과한 타이머 틱의 수를 나타내는 unsigned 형식의 변수입니다. */
 
 /* "만약 false인 경우 (기본값), 라운드 로빈 스케줄러를 사용합니다.
 	만약 true인 경우, 멀티레벨 피드백 큐 스케줄러를 사용합니다.
 	이는 커널 커맨드라인 옵션 '-o mlfqs'에 의해 제어됩니다." */
 /*mlfqs="Multi-Level Feedback Queue Scheduling"의 약자로, 멀티레벨 피드백 큐 스케줄링을 의미합니다.*/
 bool thread_mlfqs;
+
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* Completely fair scheduler tuning, in timer ticks.  Each ready
+   thread should run once every CFS_LATENCY ticks, unless that
+   would cut slices below CFS_MIN_GRANULARITY.  A waking thread
+   may be placed up to CFS_SLEEPER_CREDIT ticks of virtual time
+   behind the CPU's least vruntime, and preempts a running thread
+   that is more than CFS_WAKEUP_GRANULARITY ticks ahead of it. */
+#define CFS_LATENCY 6
+#define CFS_MIN_GRANULARITY 1
+#define CFS_SLEEPER_CREDIT (CFS_LATENCY / 2)
+#define CFS_WAKEUP_GRANULARITY 1
+
+/* Load weight of nice value N is cfs_weights[N - NICE_MIN].
+   Each step of niceness is worth about 10% of CPU time against a
+   thread one step away, so the weights shrink by about 1.25x per
+   step, with NICE_DEFAULT at CFS_WEIGHT_0. */
+#define CFS_WEIGHT_0 1024
+static const unsigned cfs_weights[NICE_MAX - NICE_MIN + 1] = {
+	88761, 71755, 56483, 46273, 36291,
+	29154, 23254, 18705, 14949, 11916,
+	9548, 7620, 6100, 4904, 3906,
+	3121, 2501, 1991, 1586, 1277,
+	1024, 820, 655, 526, 423,
+	335, 272, 215, 172, 137,
+	110, 87, 70, 56, 45,
+	36, 29, 23, 18, 15,
+	12,
+};
+
+/* If true, print scheduler accounting as threads exit.
+   Controlled by kernel command-line option "-schedstat". */
+bool thread_schedstat;
 /*커널 스레드를 생성하는 함수입니다. 주어진 함수 포인터 thread_func와 aux 인자를 사용하여 스레드를 생성합니다.*/
 static void kernel_thread (thread_func *, void *aux);
 /*Idle 스레드의 실행 함수입니다. Idle 스레드는 CPU에 아무 작업도 수행하지 않고 대기하는 역할을 합니다. 해당 함수는 aux 인자를 사용하지 않으며, 비사용(UNUSED) 특성을 가지고 있습니다.*/
 static void idle (void *aux UNUSED);
+static void idle_loop (void) NO_RETURN;
 /*실행할 다음 스레드를 선택하는 함수입니다. 다음에 실행될 스레드를 결정하는 스케줄링 알고리즘에 따라 선택됩니다.*/
 static struct thread *next_thread_to_run (void);
 /*스레드를 초기화하는 함수입니다. 주어진 이름(name)과 우선순위(priority)를 사용하여 스레드를 초기화합니다.*/
 static void init_thread (struct thread *, const char *name, int priority);
-/*스케줄링을 수행하는 함수입니다. 주어진 스레드 상태(status)에 따라 스케줄링을 수행합니다.*/
-static void do_schedule(int status);
 /*다음 실행할 스레드를 선택하고, 현재 실행 중인 스레드와 선택된 스레드 간의 전환을 수행하는 함수입니다.
  스케줄링 알고리즘에 따라 실행할 스레드를 선택하고, 컨텍스트 전환을 통해 선택된 스레드를 실행합니다.*/
 static void schedule (void);
+static void schedule_tail (void);
 /* 스레드에 할당할 고유한 식별자(tid)를 생성하는 함수입니다. 새로운 스레드가 생성될 때마다 호출되어 고유한 식별자를 할당합니다.*/
 static tid_t allocate_tid (void);
 /*cmp_priority라는 함수는 주어진 두 개의 list_elem 구조체를 비교하고 불리언 값을 반환하는 것으로 보입니다.
@@ -113,6 +153,62 @@ static tid_t allocate_tid (void);
  UNUSED 매크로는 이 변수가 현재 함수에서 사용되지 않는다는 것을 나타내는 것으로 보입니다.
  UNUSED는 변수를 사용하지 않음으로 인한 경고를 방지하는 것일 수 있습니다.*/
 bool cmp_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
+/* Run queue helpers.  The queues' CPU's rq_lock must be held. */
+static void ready_push (struct cpu *, struct thread *);
+static struct thread *ready_pop (struct cpu *);
+static void ready_remove (struct thread *);
+static struct thread *ready_steal (struct cpu *, struct cpu *victim, int min);
+static int cpu_max_priority (const struct cpu *);
+static int ready_max_priority (void);
+static bool cpu_is_idle (const struct cpu *);
+static struct cpu *choose_cpu (struct thread *);
+static struct cpu *thread_rq_lock (struct thread *);
+static bool thread_may_run_on (const struct thread *, const struct cpu *);
+static bool thread_is_idle (const struct thread *);
+static void sched_account (struct thread *curr, struct thread *next,
+		bool preempted);
+
+/* A copy of what print_sched_stats() prints about a thread, taken
+   while the thread cannot go away. */
+struct sched_snapshot {
+	char name[16];
+	tid_t tid;
+	enum thread_status status;
+	struct sched_stats stats;
+	bool edf;                           /* In the EDF class? */
+	int64_t edf_period, edf_runtime;
+	unsigned edf_misses, edf_throttles;
+	int nice;
+	unsigned cfs_weight;
+	uint64_t cfs_vruntime;
+};
+
+static void sched_snapshot (const struct thread *, struct sched_snapshot *);
+static void print_sched_stats (const struct sched_snapshot *);
+static void set_priority_requeue (struct thread *, int priority);
+static bool thread_should_yield (struct thread *);
+static bool thread_is_edf (const struct thread *);
+static void edf_join (struct thread *, struct cpu *, int64_t period,
+		int64_t runtime, unsigned util);
+static void edf_leave (struct thread *);
+static void edf_replenish (void *t_);
+static bool thread_in_cfs (const struct thread *);
+static unsigned cfs_weight (int nice);
+static void cfs_charge (struct cpu *, struct thread *);
+static void cfs_update_min (struct cpu *, const struct thread *curr);
+static void cfs_place (struct cpu *, struct thread *);
+static void cfs_migrate (struct thread *, struct cpu *from, struct cpu *to);
+static int64_t cfs_slice (const struct cpu *, const struct thread *);
+static bool cfs_should_preempt (struct cpu *, struct thread *curr);
+static struct thread *cfs_pick (struct cpu *);
+static void thread_change_priority (struct thread *, int priority);
+static int thread_donated_priority (const struct thread *);
+static struct thread *thread_page_alloc (void);
+static void thread_page_free (struct thread *);
+static void thread_wakeup (void *t_);
+static int mlfqs_priority (const struct thread *);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_daemon (void *aux UNUSED);
 
 
 
@@ -161,17 +257,22 @@ thread_init (void) { //인터럽트가 비활성화된 상태에서 실행되어
 
 	/* 전역 스레드 컨텍스트를 초기화 */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
-	list_init (&destruction_req);
-	list_init (&sleep_list);
+	cpu_init (&cpus[0], 0);
+	cpus[0].started = true;
+	list_init (&all_list);
+	spin_init (&all_lock);
+	sema_init (&mlfqs_sema, 0);
+	load_avg = 0;
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid ();
+	initial_thread->cpu = &cpus[0];
+	initial_thread->on_cpu = true;
+	cpus[0].curr = initial_thread;
 
-	global_tick = 0x7FFFFFFFFFFFFFFF;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -188,6 +289,9 @@ thread_start (void) {
 
 	/* Wait for the idle thread to initialize idle_thread. */
 	sema_down (&idle_started);
+
+	if (thread_mlfqs)
+		thread_create ("mlfqs", PRI_MAX, mlfqs_daemon, NULL);
 }
 
 /*  이 함수는 타이머 인터럽트 핸들러의 호출에 응답하여 타이머 틱마다 실행되며,
@@ -195,27 +299,94 @@ thread_start (void) {
  이 함수는 인터럽트 컨텍스트에서 실행되므로 인터럽트에 관련된 처리를 수행하는 데 유용하게 사용될 수 있습니다. */
 void
 thread_tick (void) {
+	struct cpu *c = this_cpu ();
 	struct thread *t = thread_current ();
 	/* Update statistics. */
-	if (t == idle_thread)
-		idle_ticks++;
+	t->stats.ticks++;
+	if (t == c->idle_thread)
+		c->idle_ticks++;
 #ifdef USERPROG
 	else if (t->pml4 != NULL)
-		user_ticks++;
+		c->user_ticks++;
 #endif
 	else
-		kernel_ticks++;
+		c->kernel_ticks++;
+
+	if (thread_mlfqs)
+		mlfqs_tick (t);
+
+	/* Charge EDF budget, throttling the thread once it runs out. */
+	spin_lock (&c->rq_lock);
+	if (thread_is_edf (t) && !t->edf.throttled && --t->edf.budget <= 0) {
+		t->edf.throttled = true;
+		t->edf.throttles++;
+		intr_yield_on_return ();
+	}
 
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	c->thread_ticks++;
+	if (thread_in_cfs (t)) {
+		cfs_charge (c, t);
+		if (c->thread_ticks >= cfs_slice (c, t))
+			intr_yield_on_return ();
+	} else if (c->thread_ticks >= TIME_SLICE)
 		intr_yield_on_return ();
+	spin_unlock (&c->rq_lock);
 }
 
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
+	long long idle_ticks = 0, kernel_ticks = 0, user_ticks = 0;
+
+	for (int i = 0; i < cpu_cnt; i++) {
+		idle_ticks += cpus[i].idle_ticks;
+		kernel_ticks += cpus[i].kernel_ticks;
+		user_ticks += cpus[i].user_ticks;
+	}
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+	if (cpu_cnt > 1)
+		for (int i = 0; i < cpu_cnt; i++)
+			printf ("Thread: CPU %d: %lld idle ticks, %lld kernel ticks, "
+					"%lld user ticks\n", i, cpus[i].idle_ticks,
+					cpus[i].kernel_ticks, cpus[i].user_ticks);
+	if (timer_tickless)
+		printf ("Thread: %"PRId64" idle ticks suppressed by tickless idle\n",
+				timer_suppressed_ticks ());
+}
+
+/* Prints the scheduler accounting of every thread, in order of
+   tid.  Printing may sleep, so each thread is copied out under
+   all_lock and printed after it is dropped. */
+void
+thread_print_sched_stats (void) {
+	struct sched_snapshot s;
+	tid_t last = 0;
+
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		struct thread *next = NULL;
+		struct list_elem *e;
+
+		spin_lock (&all_lock);
+		for (e = list_begin (&all_list); e != list_end (&all_list);
+				e = list_next (e)) {
+			struct thread *t = list_entry (e, struct thread, allelem);
+
+			if (t->tid > last && (next == NULL || t->tid < next->tid))
+				next = t;
+		}
+		if (next != NULL)
+			sched_snapshot (next, &s);
+		spin_unlock (&all_lock);
+		intr_set_level (old_level);
+
+		if (next == NULL)
+			break;
+		print_sched_stats (&s);
+		last = s.tid;
+	}
 }
 
 void
@@ -248,6 +419,7 @@ thread_compare(struct thread *t1, struct thread *t2) {
 tid_t
 thread_create (const char *name, int priority,
 		thread_func *function, void *aux) {
+	struct switch_threads_frame *sf;
 	struct thread *t;
 	tid_t tid;
 	
@@ -255,7 +427,7 @@ thread_create (const char *name, int priority,
 	ASSERT (function != NULL);
 
 	/* thread의 위치 */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_alloc ();
 	if (t == NULL)
 		return TID_ERROR;
 
@@ -263,16 +435,18 @@ thread_create (const char *name, int priority,
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();
 
-	/* "만약 스케줄링이 되면 kernel_thread를 호출하십시오.
-		참고) rdi는 첫 번째 인자이고, rsi는 두 번째 인자입니다." */
-	t->tf.rip = (uintptr_t) kernel_thread;
-	t->tf.R.rdi = (uint64_t) function;
-	t->tf.R.rsi = (uint64_t) aux;
-	t->tf.ds = SEL_KDSEG;
-	t->tf.es = SEL_KDSEG;
-	t->tf.ss = SEL_KDSEG;
-	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
+	/* The first switch to the thread "returns" into switch_entry(),
+	   which calls kernel_thread (FUNCTION, AUX).  Like any thread
+	   returning from schedule(), it starts with interrupts off and
+	   its CPU's run queue locked; kernel_thread() finishes the
+	   switch with schedule_tail() and turns interrupts on. */
+	sf = (struct switch_threads_frame *) ((uint8_t *) t + PGSIZE) - 1;
+	memset (sf, 0, sizeof *sf);
+	sf->rbx = (uint64_t) kernel_thread;
+	sf->r12 = (uint64_t) function;
+	sf->r13 = (uint64_t) aux;
+	sf->rip = switch_entry;
+	t->switch_rsp = (uint64_t) sf;
 
 	/* Add to run queue. */
 	thread_unblock (t);//현재 실행중인 스레드
@@ -295,9 +469,26 @@ thread_create (const char *name, int priority,
    primitives in synch.h. */
 void
 thread_block (void) {
+	thread_block_unlock (NULL);
+}
+
+/* Like thread_block(), but also releases spinlock L, if nonnull,
+   once the running thread is marked blocked.  A thread that finds
+   it under L and wakes it then cannot lose the wakeup:
+   thread_unblock() waits for it to be switched out. */
+void
+thread_block_unlock (struct spinlock *l) {
+	struct thread *curr = thread_current ();
+	struct cpu *c;
+
 	ASSERT (!intr_context ());
 	ASSERT (intr_get_level () == INTR_OFF);
-	thread_current ()->status = THREAD_BLOCKED;
+
+	curr->status = THREAD_BLOCKED;
+	if (l != NULL)
+		spin_unlock (l);
+	c = this_cpu ();
+	spin_lock (&c->rq_lock);
 	schedule ();
 }
 
@@ -312,13 +503,33 @@ thread_block (void) {
 void
 thread_unblock (struct thread *t) {
 	enum intr_level old_level;
+	struct cpu *c;
+	uint64_t now;
 
 	ASSERT (is_thread (t));
 
 	old_level = intr_disable ();
+	spin_lock (&t->wake_lock);
 	ASSERT (t->status == THREAD_BLOCKED);
-	list_insert_ordered(&ready_list, & t->elem, cmp_priority, NULL);/**/
+
+	/* T may have marked itself blocked on another CPU without
+	   having switched away yet. */
+	while (__atomic_load_n (&t->on_cpu, __ATOMIC_ACQUIRE))
+		asm volatile ("pause");
+
+	c = choose_cpu (t);
+	spin_lock (&c->rq_lock);
+	now = rdtsc ();
+	t->stats.blocked_time += now - t->stats.stamp;
+	t->stats.stamp = now;
+	if (thread_in_cfs (t))
+		cfs_place (c, t);
+	ready_push (c, t);
 	t->status = THREAD_READY;
+	spin_unlock (&c->rq_lock);
+	spin_unlock (&t->wake_lock);
+	if (c != this_cpu ())
+		lapic_send_ipi (c->lapic_id, LAPIC_RESCHED_VEC);
 	intr_set_level (old_level); /*"매개변수로 전달된 상태를 인터럽트의 상태로 설정하고 이전 인터럽트 상태를 반환한다."*/
 }
 
@@ -354,16 +565,34 @@ thread_tid (void) {
    returns to the caller. */
 void
 thread_exit (void) {
+	struct thread *curr = thread_current ();
+	struct cpu *c;
+
 	ASSERT (!intr_context ());
 
 #ifdef USERPROG
 	process_exit ();
 #endif
 
+	if (thread_schedstat) {
+		struct sched_snapshot s;
+
+		sched_snapshot (curr, &s);
+		print_sched_stats (&s);
+	}
+
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
-	do_schedule (THREAD_DYING);
+	if (thread_is_edf (curr))
+		edf_leave (curr);
+	spin_lock (&all_lock);
+	list_remove (&curr->allelem);
+	spin_unlock (&all_lock);
+	c = this_cpu ();
+	spin_lock (&c->rq_lock);
+	curr->status = THREAD_DYING;
+	schedule ();
 	NOT_REACHED ();
 }
 
@@ -377,17 +606,51 @@ void
 thread_yield (void) {
 	struct thread *curr = thread_current ();
 	enum intr_level old_level;
+	struct cpu *c;
 
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();//인터럽트를 비활성화 하고 이전의 인터럽트 상태를 반환한다.
-	if (curr != idle_thread)
-		list_insert_ordered(&ready_list, & curr->elem, cmp_priority, NULL);/**/
+	c = this_cpu ();
+	spin_lock (&c->rq_lock);
+	if (thread_in_cfs (curr))
+		cfs_charge (c, curr);
+	if (!thread_is_idle (curr))
+		ready_push (c, curr);
 	curr->status = THREAD_READY;
 	schedule ();
 	
 	intr_set_level (old_level);
 }
+
+/* Binds the running thread to CPU C, which must have started, so
+   that it only ever runs there, migrating to C first if need be.
+   A null C lifts the binding.  Deadline threads are already
+   bound to the CPU of their reservation. */
+void
+thread_bind (struct cpu *c) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+	ASSERT (c == NULL || c->started);
+
+	old_level = intr_disable ();
+	ASSERT (!thread_is_edf (curr));
+	curr->bound_cpu = c;
+	if (c != NULL && c != this_cpu ()) {
+		struct cpu *here = this_cpu ();
+
+		/* Block, and let schedule_tail() wake us on C once we are
+		   off this CPU's stack. */
+		spin_lock (&here->rq_lock);
+		if (thread_in_cfs (curr))
+			cfs_charge (here, curr);
+		curr->status = THREAD_BLOCKED;
+		schedule ();
+	}
+	intr_set_level (old_level);
+}
 //현재 스레드를 나타내는 포인터 curr를 얻는다. 이후 인터럽트 레벨을 저장하기 위한 변수 old_level을 선언한다.
 //intr_context()함수를 사용하여 현재 코드가 인터럽트 컨텍스트에서 실행 중인지 확인한다. 인터럽트 컨텍스트에서는 스레드를 양보하는 것이 불가능하다.
 //ASSERT문을 사용하여 이를 확인한다.
@@ -403,17 +666,256 @@ thread_yield (void) {
 /* "현재 스레드의 우선 순위를 NEW_PRIORITY로 설정합니다." */
 void
 thread_set_priority (int new_priority) {
-	thread_current ()->priority = new_priority;
-	// if(list_entry (list_front(&ready_list), struct thread, elem)->priority > new_priority)
-	// 	thread_yield();
-	test_max_priority();
-	
+	/* The 4.4BSD scheduler computes priorities itself. */
+	if (thread_mlfqs)
+		return;
+
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	bool edf;
+
+	/* Donations received keep counting on top of the new base
+	   priority.  An EDF thread takes its new priority when it
+	   leaves the EDF class. */
+	old_level = intr_disable ();
+	spin_lock (&donation_lock);
+	edf = thread_is_edf (curr);
+	if (edf)
+		curr->edf.saved_priority = new_priority;
+	else {
+		curr->original_priority = new_priority;
+		thread_refresh_priority (curr);
+	}
+	spin_unlock (&donation_lock);
+	if (!edf)
+		test_max_priority ();
+	intr_set_level (old_level);
 }
 //readylist의 우선순위가 가장 높은 값이랑 현재 running_thread의 우선순위를 비교 // !list_empty(&ready_list) && 예외처리 무조건 해줘야함!!!!!!!!!!!!!
 void
 test_max_priority(void) {
-	if(!list_empty(&ready_list) && list_entry (list_front(&ready_list), struct thread, elem)->priority > thread_current()->priority)
-		thread_yield();
+	enum intr_level old_level = intr_disable ();
+	struct cpu *c = this_cpu ();
+	bool yield;
+
+	/* Yielding with a spinlock held would deadlock. */
+	ASSERT (c->spin_cnt == 0);
+
+	spin_lock (&c->rq_lock);
+	yield = thread_should_yield (thread_current ());
+	spin_unlock (&c->rq_lock);
+	intr_set_level (old_level);
+
+	if (yield) {
+		if (intr_context ())
+			intr_yield_on_return ();
+		else
+			thread_yield ();
+	}
+}
+
+/* Called in an interrupt handler when another CPU may have queued
+   a thread for this one: yields on return if the running thread
+   is idle or no longer has the highest priority. */
+void
+thread_preempt (void) {
+	ASSERT (intr_context ());
+
+	if (thread_is_idle (thread_current ()))
+		intr_yield_on_return ();
+	else
+		test_max_priority ();
+}
+
+/* Returns true if CURR, the running thread, should give up the
+   CPU.  EDF threads run ahead of all other threads, earliest
+   deadline first, unless throttled; the rest run by priority, or
+   with -cfs by virtual run time.  This CPU's rq_lock must be
+   held; other CPUs' run queues are only peeked at. */
+static bool
+thread_should_yield (struct thread *curr) {
+	struct cpu *c = this_cpu ();
+
+	ASSERT (spin_held (&c->rq_lock));
+
+	if (!heap_empty (&c->edf_ready)) {
+		struct thread *t = heap_entry (heap_max (&c->edf_ready),
+				struct thread, edf.elem);
+
+		if (!thread_is_edf (curr) || t->edf.deadline < curr->edf.deadline)
+			return true;
+	}
+	if (thread_is_edf (curr))
+		return curr->edf.throttled;
+	if (thread_cfs)
+		return cfs_should_preempt (c, curr);
+	return ready_max_priority () > curr->priority;
+}
+
+/* Puts the running thread in the earliest-deadline-first class,
+   reserving RUNTIME timer ticks of CPU time in every PERIOD
+   ticks starting now, or returns it to the priority class if
+   PERIOD is 0.  EDF threads run ahead of every priority-class
+   thread, earliest deadline first.  One that uses up RUNTIME
+   within a period is throttled until the next period starts,
+   and one that is still runnable with budget left when a period
+   ends records a deadline miss.
+
+   The reservation is made on the running CPU, where the thread
+   then stays.  It is refused, leaving the thread's class as it
+   was, if it would take the CPU's reserved share past
+   EDF_UTIL_MAX.  Returns true if successful. */
+bool
+thread_set_deadline (int64_t period, int64_t runtime) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	unsigned util = 0, old_util;
+	struct cpu *c;
+	bool success;
+
+	ASSERT (!intr_context ());
+
+	if (period < 0 || (period > 0 && (runtime <= 0 || runtime > period)))
+		return false;
+	if (period > 0)
+		util = DIV_ROUND_UP (runtime * EDF_UTIL_SCALE, period);
+
+	/* Only threads running on C join or leave its EDF class, so
+	   with interrupts off its reserved share cannot change under
+	   us. */
+	old_level = intr_disable ();
+	c = this_cpu ();
+	old_util = thread_is_edf (curr) ? curr->edf.util : 0;
+	success = c->edf_util - old_util + util <= EDF_UTIL_MAX;
+	if (success) {
+		if (thread_is_edf (curr))
+			edf_leave (curr);
+		if (period > 0)
+			edf_join (curr, c, period, runtime, util);
+		test_max_priority ();
+	}
+	intr_set_level (old_level);
+	return success;
+}
+
+/* Returns true if T is in the EDF class. */
+static bool
+thread_is_edf (const struct thread *t) {
+	return t->edf.period != 0;
+}
+
+/* Makes running thread T an EDF thread on CPU C with the given
+   parameters, starting its first period.  While in the class, T
+   donates as if it had priority PRI_MAX, so that priority-class
+   lock holders cannot hold it up for long.  Interrupts must be
+   off and no spinlock held. */
+static void
+edf_join (struct thread *t, struct cpu *c, int64_t period, int64_t runtime,
+		unsigned util) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_RUNNING);
+
+	spin_lock (&c->rq_lock);
+	if (thread_in_cfs (t))
+		cfs_charge (c, t);
+	t->edf.period = period;
+	t->edf.runtime = runtime;
+	t->edf.util = util;
+	t->edf.cpu = c;
+	c->edf_util += util;
+
+	t->edf.deadline = timer_ticks () + period;
+	t->edf.budget = runtime;
+	t->edf.throttled = false;
+	timer_event_init (&t->edf.timer, edf_replenish, t);
+	timer_event_add (&t->edf.timer, t->edf.deadline);
+	spin_unlock (&c->rq_lock);
+
+	if (!thread_mlfqs) {
+		spin_lock (&donation_lock);
+		t->edf.saved_priority = t->original_priority;
+		t->original_priority = PRI_MAX;
+		thread_refresh_priority (t);
+		spin_unlock (&donation_lock);
+	}
+}
+
+/* Returns running EDF thread T to the priority class and frees
+   its reservation.  Its miss and throttle counts are kept.
+   Interrupts must be off and no spinlock held. */
+static void
+edf_leave (struct thread *t) {
+	struct cpu *c = t->edf.cpu;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_RUNNING);
+
+	timer_event_cancel (&t->edf.timer);
+	spin_lock (&c->rq_lock);
+	c->edf_util -= t->edf.util;
+	t->edf.period = 0;
+	t->edf.throttled = false;
+
+	/* Rejoin the fair class without a claim to the time spent in
+	   the EDF class. */
+	if (thread_cfs) {
+		t->cfs.exec_start = rdtsc ();
+		if (t->cfs.vruntime < c->cfs_min_vruntime)
+			t->cfs.vruntime = c->cfs_min_vruntime;
+	}
+	spin_unlock (&c->rq_lock);
+
+	if (!thread_mlfqs) {
+		spin_lock (&donation_lock);
+		t->original_priority = t->edf.saved_priority;
+		thread_refresh_priority (t);
+		spin_unlock (&donation_lock);
+	}
+}
+
+/* Timer callback that ends EDF thread T_'s period and starts the
+   next one with a full budget.  A thread that could have run but
+   did not get its RUNTIME in the period that ended missed its
+   deadline. */
+static void
+edf_replenish (void *t_) {
+	struct thread *t = t_;
+	struct cpu *c = t->edf.cpu;
+	bool ready;
+
+	ASSERT (intr_context ());
+
+	/* EDF threads never leave C, so C's rq_lock covers T. */
+	spin_lock (&c->rq_lock);
+	if (t->edf.budget > 0 && t->status != THREAD_BLOCKED)
+		t->edf.misses++;
+
+	/* The deadline is T's key in C's EDF queue. */
+	ready = t->status == THREAD_READY;
+	if (ready)
+		ready_remove (t);
+	t->edf.deadline += t->edf.period;
+	t->edf.budget = t->edf.runtime;
+	t->edf.throttled = false;
+	if (ready)
+		ready_push (c, t);
+	timer_event_add (&t->edf.timer, t->edf.deadline);
+	spin_unlock (&c->rq_lock);
+
+	if (c == this_cpu ())
+		test_max_priority ();
+	else if (ready)
+		lapic_send_ipi (c->lapic_id, LAPIC_RESCHED_VEC);
+}
+
+/* Returns true if the thread with edf.elem A has a later deadline
+   than the thread with edf.elem B, so that the EDF queue's
+   greatest element is the earliest deadline. */
+bool
+thread_deadline_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct thread, edf.elem)->edf.deadline
+		> heap_entry (b, struct thread, edf.elem)->edf.deadline;
 }
 
 /* 현재 스레드의 우선순위를 반환한다. */
@@ -422,33 +924,186 @@ thread_get_priority (void) {
 	return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE, which sets its
+   priority under -mlfqs and its weight under -cfs, and yields if
+   it should no longer run. */
 void
-thread_set_nice (int nice UNUSED) {
-	/* TODO: Your implementation goes here */
+thread_set_nice (int nice) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	struct cpu *c;
+
+	ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+	old_level = intr_disable ();
+	c = this_cpu ();
+	spin_lock (&c->rq_lock);
+	if (thread_in_cfs (curr))
+		cfs_charge (c, curr);
+	curr->nice = nice;
+	curr->cfs.weight = cfs_weight (nice);
+	spin_unlock (&c->rq_lock);
+	if (thread_mlfqs && curr != mlfqs_thread) {
+		spin_lock (&curr->wake_lock);
+		curr->priority = mlfqs_priority (curr);
+		spin_unlock (&curr->wake_lock);
+	}
+	test_max_priority ();
+	intr_set_level (old_level);
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int load;
+
+	spin_lock (&all_lock);
+	load = fp_round (fp_mul_int (load_avg, 100));
+	spin_unlock (&all_lock);
+	intr_set_level (old_level);
+	return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int recent = fp_round (fp_mul_int (thread_current ()->recent_cpu, 100));
+	intr_set_level (old_level);
+	return recent;
+}
+
+/* Returns T's 4.4BSD priority,
+   PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped to the valid
+   range. */
+static int
+mlfqs_priority (const struct thread *t) {
+	int priority = PRI_MAX - fp_to_int (fp_div_int (t->recent_cpu, 4))
+		- t->nice * 2;
+
+	if (priority < PRI_MIN)
+		return PRI_MIN;
+	if (priority > PRI_MAX)
+		return PRI_MAX;
+	return priority;
 }
 
+/* 4.4BSD bookkeeping done on every timer tick for running thread
+   T.  Only T's own priority changes here; everything that needs
+   to look at every thread is left to mlfqs_daemon(), which the
+   first CPU wakes. */
+static void
+mlfqs_tick (struct thread *t) {
+	int64_t now = timer_ticks ();
+
+	if (!thread_is_idle (t) && t != mlfqs_thread) {
+		bool slice_end = now % TIME_SLICE == 0;
+
+		/* T is running, so wake_lock alone guards its priority. */
+		spin_lock (&t->wake_lock);
+		t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+		if (slice_end)
+			t->priority = mlfqs_priority (t);
+		spin_unlock (&t->wake_lock);
+		if (slice_end && ready_max_priority () > t->priority)
+			intr_yield_on_return ();
+	}
+
+	if (this_cpu () == &cpus[0] && now / TIMER_FREQ != mlfqs_second
+			&& mlfqs_thread != NULL) {
+		mlfqs_second = now / TIMER_FREQ;
+		sema_up (&mlfqs_sema);
+	}
+}
+
+/* Once per second, recomputes load_avg, and then recent_cpu and
+   priority of every thread, moving ready threads to their new run
+   queue.  Runs in its own PRI_MAX thread so that the O(threads)
+   walk stays out of the timer interrupt; it is not counted as a
+   ready thread and its own priority is never recomputed.
+
+   The walk goes MLFQS_BATCH threads at a time, dropping its locks
+   and turning interrupts back on in between, so that interrupts
+   are held off for a bounded time however many threads there
+   are.  The daemon's own element in all_list serves as the
+   cursor: it is moved past each thread as that thread is done,
+   so threads that exit in between do not disturb the walk. */
+static void
+mlfqs_daemon (void *aux UNUSED) {
+	struct list_elem *cursor;
+
+	mlfqs_thread = thread_current ();
+	mlfqs_thread->priority = PRI_MAX;
+	cursor = &mlfqs_thread->allelem;
+
+	for (;;) {
+		enum intr_level old_level;
+		fixed_t coef;
+		int ready_threads;
+		bool done = false;
+
+		sema_down (&mlfqs_sema);
+
+		old_level = intr_disable ();
+		spin_lock (&all_lock);
+
+		/* The daemon itself is running; count the threads that would
+		   be running or ready without it. */
+		ready_threads = 0;
+		for (int i = 0; i < cpu_cnt; i++) {
+			struct cpu *c = &cpus[i];
+
+			ready_threads += c->ready_cnt;
+			if (c->started && c->curr != c->idle_thread
+					&& c->curr != mlfqs_thread)
+				ready_threads++;
+		}
+		load_avg = fp_add (fp_mul (fp_div_int (fp_from_int (59), 60), load_avg),
+				fp_mul_int (fp_div_int (fp_from_int (1), 60), ready_threads));
+		coef = fp_div (fp_mul_int (load_avg, 2),
+				fp_add_int (fp_mul_int (load_avg, 2), 1));
+
+		list_remove (cursor);
+		list_push_front (&all_list, cursor);
+		spin_unlock (&all_lock);
+		intr_set_level (old_level);
+
+		while (!done) {
+			old_level = intr_disable ();
+			spin_lock (&all_lock);
+			spin_lock (&donation_lock);
+			for (int i = 0; i < MLFQS_BATCH; i++) {
+				struct list_elem *e = list_next (cursor);
+				struct thread *t;
+
+				if (e == list_end (&all_list)) {
+					done = true;
+					break;
+				}
+				list_remove (cursor);
+				list_insert (list_next (e), cursor);
+
+				t = list_entry (e, struct thread, allelem);
+				if (thread_is_idle (t))
+					continue;
+				spin_lock (&t->wake_lock);
+				t->recent_cpu = fp_add_int (fp_mul (coef, t->recent_cpu), t->nice);
+				spin_unlock (&t->wake_lock);
+				thread_change_priority (t, mlfqs_priority (t));
+			}
+			spin_unlock (&donation_lock);
+			spin_unlock (&all_lock);
+			intr_set_level (old_level);
+		}
+	}
+}
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
@@ -463,35 +1118,81 @@ static void
 idle (void *idle_started_ UNUSED) {
 	struct semaphore *idle_started = idle_started_;
 
-	idle_thread = thread_current ();
+	this_cpu ()->idle_thread = thread_current ();
 	sema_up (idle_started);
 
+	idle_loop ();
+}
+
+/* Body of every CPU's idle thread. */
+static void
+idle_loop (void) {
 	for (;;) {
 		/* Let someone else run. */
 		intr_disable ();
 		thread_block ();
 
-		/* Re-enable interrupts and wait for the next one.
+		/* Zero pages for PAL_ZERO allocations while there is
+		   nothing else to do, a page at a time so that a thread
+		   that becomes ready meanwhile need not wait long.  If one
+		   does, let it run instead of halting. */
+		while (this_cpu ()->ready_cnt == 0 && palloc_zero_idle ())
+			continue;
+		if (this_cpu ()->ready_cnt > 0)
+			continue;
 
-		   The `sti' instruction disables interrupts until the
-		   completion of the next instruction, so these two
-		   instructions are executed atomically.  This atomicity is
-		   important; otherwise, an interrupt could be handled
-		   between re-enabling interrupts and waiting for the next
-		   one to occur, wasting as much as one clock tick worth of
-		   time.
+		/* Re-enable interrupts and wait for the next one.
 
-		   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-		   7.11.1 "HLT Instruction". */
-		asm volatile ("sti; hlt" : : : "memory");
+		   The enabling and the waiting must be atomic; otherwise,
+		   an interrupt could be handled between re-enabling
+		   interrupts and waiting for the next one to occur,
+		   wasting as much as one clock tick worth of time.
+		   intr_halt() takes care of that. */
+		timer_idle_enter ();
+		intr_halt ();
 	}
 }
 
+/* Creates the idle thread of application processor C, which the
+   processor starts out running, and returns the top of its
+   stack, or a null pointer if memory is short. */
+void *
+thread_ap_prepare (struct cpu *c) {
+	struct thread *t;
+	char name[16];
+
+	t = thread_page_alloc ();
+	if (t == NULL)
+		return NULL;
+
+	snprintf (name, sizeof name, "idle%d", c->id);
+	init_thread (t, name, PRI_MIN);
+	t->tid = allocate_tid ();
+	t->status = THREAD_RUNNING;
+	t->cpu = c;
+	t->on_cpu = true;
+	c->idle_thread = c->curr = t;
+	return (uint8_t *) t + PGSIZE;
+}
+
+/* Joins the scheduler on an application processor, running its
+   idle thread.  Interrupts must be off. */
+void
+thread_ap_main (void) {
+	struct cpu *c = this_cpu ();
+
+	ASSERT (thread_current () == c->idle_thread);
+
+	c->started = true;
+	idle_loop ();
+}
+
 /* Function used as the basis for a kernel thread. */
 static void
 kernel_thread (thread_func *function, void *aux) {
 	ASSERT (function != NULL);
 
+	schedule_tail ();     /* Finish the switch to this thread. */
 	intr_enable ();       /* The scheduler runs with interrupts off. */
 	function (aux);       /* Execute the thread function. */
 	thread_exit ();       /* If function() returns, kill the thread. */
@@ -503,6 +1204,8 @@ kernel_thread (thread_func *function, void *aux) {
 새로운 스레드를 안전하게 초기화하는 작업을 수행합니다. */
 static void
 init_thread (struct thread *t, const char *name, int priority) {
+	enum intr_level old_level;
+
 	ASSERT (t != NULL);//ASSERT (t != NULL); : 입력으로 들어온 스레드 t가 NULL이 아닌지 확인합니다. 만약 NULL이면, 프로그램은 에러를 발생시킵니다.
 	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);//ASSERT (PRI_MIN <= priority && priority <= PRI_MAX); : 주어진 priority가 허용된 범위 내에 있는지 확인합니다. priority 값이 PRI_MIN보다 작거나 PRI_MAX보다 크면, 프로그램은 에러를 발생시킵니다.
 	ASSERT (name != NULL);//ASSERT (name != NULL); : name이 NULL이 아닌지 확인합니다. name이 NULL이면 프로그램은 에러를 발생시킵니다.
@@ -514,26 +1217,465 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->priority = priority;//t->priority = priority; : 주어진 priority를 스레드의 우선순위로 설정합니다.
 	t->magic = THREAD_MAGIC;//t->magic = THREAD_MAGIC; : 스레드의 '마법 값'을 설정합니다. 이 값은 주로 디버깅에서 스레드가 올바르게 초기화되었는지 확인하는 데 사용됩니다.
 	t->original_priority = priority;
-	list_init(&t->donations);
-	
+	heap_init (&t->held_locks, lock_donation_less, NULL);
+	if (t != initial_thread) {
+		t->nice = running_thread ()->nice;
+		t->recent_cpu = running_thread ()->recent_cpu;
+	}
+	if (thread_mlfqs)
+		t->priority = t->original_priority = mlfqs_priority (t);
+	t->cfs.weight = cfs_weight (t->nice);
+	timer_event_init (&t->sleep_timer, thread_wakeup, t);
+	t->stats.stamp = rdtsc ();
+	t->cfs.exec_start = t->stats.stamp;
+	spin_init (&t->wake_lock);
+
+	old_level = intr_disable ();
+	spin_lock (&all_lock);
+	list_push_back (&all_list, &t->allelem);
+	spin_unlock (&all_lock);
+	intr_set_level (old_level);
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   the CPU's idle thread.
+
+   With several CPUs, this CPU's own run queues are searched
+   first, but a ready thread of strictly higher priority queued
+   on another CPU is stolen instead, so the highest-priority
+   threads run wherever there is a CPU for them.  When this CPU's
+   queues are empty, that is plain work stealing.
+
+   This CPU's rq_lock must be held.  Other CPUs' queues are picked
+   by peeking without their locks, and the victim's lock is only
+   tried, since run queue locks have no order among themselves;
+   a busy victim is left alone until the next switch. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
+	struct cpu *c = this_cpu ();
+	struct cpu *victim = NULL;
+	int pri = cpu_max_priority (c);
+
+	ASSERT (spin_held (&c->rq_lock));
+
+	/* EDF threads stay on the CPU they reserved time on. */
+	if (!heap_empty (&c->edf_ready)) {
+		struct thread *t = heap_entry (heap_pop (&c->edf_ready),
+				struct thread, edf.elem);
+		c->ready_cnt--;
+		return t;
+	}
+
+	if (thread_cfs)
+		return cfs_pick (c);
+
+	for (int i = 0; i < cpu_cnt; i++) {
+		struct cpu *o = &cpus[i];
+
+		if (o != c && o->started && cpu_max_priority (o) > pri) {
+			victim = o;
+			pri = cpu_max_priority (o);
+		}
+	}
+	if (victim != NULL && spin_trylock (&victim->rq_lock)) {
+		struct thread *t = ready_steal (c, victim, cpu_max_priority (c));
+
+		spin_unlock (&victim->rq_lock);
+		if (t != NULL)
+			return t;
+	}
+
+	if (c->ready_mask == 0)
+		return c->idle_thread;
 	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+		return ready_pop (c);
 }
 
-/* Use iretq to launch the thread */
+/* Appends T to the run queue of its priority on CPU C.  Threads
+   of equal priority are served in FIFO order. */
+static void
+ready_push (struct cpu *c, struct thread *t) {
+	ASSERT (spin_held (&c->rq_lock));
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	/* A throttled EDF thread waits off the queues until
+	   edf_replenish() pushes it again. */
+	if (thread_is_edf (t)) {
+		ASSERT (c == t->edf.cpu);
+		t->cpu = c;
+		if (!t->edf.throttled) {
+			heap_push (&c->edf_ready, &t->edf.elem);
+			c->ready_cnt++;
+		}
+		return;
+	}
+
+	if (thread_cfs) {
+		rb_insert (&c->cfs_ready, &t->cfs.elem);
+		c->cfs_load += t->cfs.weight;
+		c->ready_cnt++;
+		t->cpu = c;
+		return;
+	}
+
+	list_push_back (&c->ready_list[t->priority], &t->elem);
+	c->ready_mask |= 1ULL << t->priority;
+	c->ready_cnt++;
+	t->cpu = c;
+}
+
+/* Removes and returns the first thread of the highest non-empty
+   run queue on CPU C.  C's run queues must not all be empty. */
+static struct thread *
+ready_pop (struct cpu *c) {
+	int pri = cpu_max_priority (c);
+	struct thread *t;
+
+	ASSERT (spin_held (&c->rq_lock));
+	ASSERT (pri >= PRI_MIN);
+
+	t = list_entry (list_pop_front (&c->ready_list[pri]), struct thread, elem);
+	if (list_empty (&c->ready_list[pri]))
+		c->ready_mask &= ~(1ULL << pri);
+	c->ready_cnt--;
+	return t;
+}
+
+/* Removes ready thread T from its run queue, e.g. before its
+   priority is changed. */
+static void
+ready_remove (struct thread *t) {
+	struct cpu *c = t->cpu;
+
+	ASSERT (spin_held (&c->rq_lock));
+	ASSERT (t->status == THREAD_READY);
+
+	if (thread_is_edf (t)) {
+		if (!t->edf.throttled) {
+			heap_remove (&c->edf_ready, &t->edf.elem);
+			c->ready_cnt--;
+		}
+		return;
+	}
+
+	if (thread_cfs) {
+		rb_remove (&c->cfs_ready, &t->cfs.elem);
+		c->cfs_load -= t->cfs.weight;
+		c->ready_cnt--;
+		return;
+	}
+
+	list_remove (&t->elem);
+	if (list_empty (&c->ready_list[t->priority]))
+		c->ready_mask &= ~(1ULL << t->priority);
+	c->ready_cnt--;
+}
+
+/* Removes and returns the highest-priority thread above priority
+   MIN in VICTIM's run queues that may run on CPU C, or a null
+   pointer if there is none.  Both CPUs' rq_locks must be held;
+   the thread then belongs to C. */
+static struct thread *
+ready_steal (struct cpu *c, struct cpu *victim, int min) {
+	uint64_t mask = victim->ready_mask;
+
+	ASSERT (spin_held (&c->rq_lock) && spin_held (&victim->rq_lock));
+
+	while (mask != 0) {
+		int pri = 63 - __builtin_clzll (mask);
+		struct list_elem *e;
+
+		if (pri <= min)
+			break;
+		for (e = list_begin (&victim->ready_list[pri]);
+				e != list_end (&victim->ready_list[pri]); e = list_next (e)) {
+			struct thread *t = list_entry (e, struct thread, elem);
+
+			if (!thread_may_run_on (t, c))
+				continue;
+			ready_remove (t);
+			t->cpu = c;
+			return t;
+		}
+		mask &= ~(1ULL << pri);
+	}
+	return NULL;
+}
+
+/* Returns true if CPU C is running its idle thread with nothing
+   queued. */
+static bool
+cpu_is_idle (const struct cpu *c) {
+	return c->started && c->curr == c->idle_thread && c->ready_cnt == 0;
+}
+
+/* Chooses the CPU whose run queue T should join when it becomes
+   ready: preferably an idle CPU, starting with the one T last ran
+   on, and otherwise the running CPU. */
+static struct cpu *
+choose_cpu (struct thread *t) {
+	if (thread_is_edf (t))
+		return t->edf.cpu;
+	if (t->bound_cpu != NULL)
+		return t->bound_cpu;
+	if (!smp_active)
+		return this_cpu ();
+
+	if (t->cpu != NULL && cpu_is_idle (t->cpu))
+		return t->cpu;
+	for (int i = 0; i < cpu_cnt; i++)
+		if (cpu_is_idle (&cpus[i]))
+			return &cpus[i];
+	return this_cpu ();
+}
+
+/* Returns true if ready thread T may be moved to CPU C's run
+   queue. */
+static bool
+thread_may_run_on (const struct thread *t, const struct cpu *c) {
+	return t->bound_cpu == NULL || t->bound_cpu == c;
+}
+
+/* Returns true if T is scheduled by the completely fair
+   scheduler: with -cfs, every thread but EDF and idle threads. */
+static bool
+thread_in_cfs (const struct thread *t) {
+	return thread_cfs && !thread_is_edf (t) && !thread_is_idle (t);
+}
+
+/* Returns the load weight of nice value NICE. */
+static unsigned
+cfs_weight (int nice) {
+	ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+	return cfs_weights[nice - NICE_MIN];
+}
+
+/* Charges T, running on CPU C, for the time since it was last
+   charged, in virtual time scaled by its weight. */
+static void
+cfs_charge (struct cpu *c, struct thread *t) {
+	uint64_t now = rdtsc ();
+
+	t->cfs.vruntime += (now - t->cfs.exec_start) * CFS_WEIGHT_0 / t->cfs.weight;
+	t->cfs.exec_start = now;
+	cfs_update_min (c, t);
+}
+
+/* Advances CPU C's cfs_min_vruntime to the least vruntime among
+   CURR, the fair-class thread running on C or a null pointer,
+   and the threads ready on C.  It never moves back, so that
+   threads placed relative to it gain nothing by sleeping. */
+static void
+cfs_update_min (struct cpu *c, const struct thread *curr) {
+	struct rb_elem *e = rb_min (&c->cfs_ready);
+	uint64_t min;
+
+	if (curr != NULL)
+		min = curr->cfs.vruntime;
+	else if (e != NULL)
+		min = rb_entry (e, struct thread, cfs.elem)->cfs.vruntime;
+	else
+		return;
+	if (e != NULL && rb_entry (e, struct thread, cfs.elem)->cfs.vruntime < min)
+		min = rb_entry (e, struct thread, cfs.elem)->cfs.vruntime;
+	if (min > c->cfs_min_vruntime)
+		c->cfs_min_vruntime = min;
+}
+
+/* Sets the vruntime of T, which is new or waking up, for joining
+   CPU C's queue.  A new thread starts level with C's least
+   vruntime.  One that slept keeps its own, carried over from the
+   CPU it last ran on, but is credited with at most
+   CFS_SLEEPER_CREDIT ticks of lag: enough to preempt promptly,
+   not enough to bank CPU time by sleeping. */
+static void
+cfs_place (struct cpu *c, struct thread *t) {
+	uint64_t credit = timer_ticks_to_cycles (CFS_SLEEPER_CREDIT);
+
+	if (t->cpu == NULL) {
+		t->cfs.vruntime = c->cfs_min_vruntime;
+		return;
+	}
+	if (t->cpu != c)
+		cfs_migrate (t, t->cpu, c);
+	if (t->cfs.vruntime + credit < c->cfs_min_vruntime)
+		t->cfs.vruntime = c->cfs_min_vruntime - credit;
+}
+
+/* Moves T's vruntime from CPU FROM's virtual clock to CPU TO's,
+   keeping its lead or lag on the least vruntime. */
+static void
+cfs_migrate (struct thread *t, struct cpu *from, struct cpu *to) {
+	int64_t lag = t->cfs.vruntime - from->cfs_min_vruntime;
+
+	if (lag < 0 && (uint64_t) -lag > to->cfs_min_vruntime)
+		t->cfs.vruntime = 0;
+	else
+		t->cfs.vruntime = to->cfs_min_vruntime + lag;
+}
+
+/* Returns the number of ticks that T, running on CPU C, may run
+   before yielding: its weight's share of the scheduling period,
+   which is CFS_LATENCY ticks, or long enough to give every
+   thread CFS_MIN_GRANULARITY if many are ready. */
+static int64_t
+cfs_slice (const struct cpu *c, const struct thread *t) {
+	int64_t nr = rb_size (&c->cfs_ready) + 1;
+	int64_t period = CFS_LATENCY;
+	int64_t slice;
+
+	if (nr * CFS_MIN_GRANULARITY > period)
+		period = nr * CFS_MIN_GRANULARITY;
+	slice = period * t->cfs.weight / (c->cfs_load + t->cfs.weight);
+	return slice > CFS_MIN_GRANULARITY ? slice : CFS_MIN_GRANULARITY;
+}
+
+/* Returns true if CURR, running on CPU C, should yield to the
+   ready thread there with the least vruntime: always for the
+   idle thread, otherwise if CURR is ahead of it by more than
+   CFS_WAKEUP_GRANULARITY, so that a wakeup preempts without
+   every small lead causing a switch. */
+static bool
+cfs_should_preempt (struct cpu *c, struct thread *curr) {
+	struct rb_elem *e = rb_min (&c->cfs_ready);
+
+	if (e == NULL)
+		return false;
+	if (!thread_in_cfs (curr))
+		return thread_is_idle (curr);
+
+	cfs_charge (c, curr);
+	return curr->cfs.vruntime
+		> rb_entry (e, struct thread, cfs.elem)->cfs.vruntime
+		+ timer_ticks_to_cycles (CFS_WAKEUP_GRANULARITY);
+}
+
+/* Removes and returns the ready thread with the least vruntime
+   on CPU C, or, if C has none, from the CPU with the most ready
+   threads.  Returns C's idle thread if there is nothing to
+   run. */
+static struct thread *
+cfs_pick (struct cpu *c) {
+	struct cpu *victim = c;
+	struct thread *next = c->idle_thread;
+	struct rb_elem *e;
+
+	/* The victim is picked and locked as in next_thread_to_run(). */
+	if (rb_empty (&c->cfs_ready))
+		for (int i = 0; i < cpu_cnt; i++)
+			if (cpus[i].started
+					&& rb_size (&cpus[i].cfs_ready) > rb_size (&victim->cfs_ready))
+				victim = &cpus[i];
+	if (victim != c && !spin_trylock (&victim->rq_lock))
+		return next;
+
+	for (e = rb_min (&victim->cfs_ready); e != NULL; e = rb_next (e)) {
+		struct thread *t = rb_entry (e, struct thread, cfs.elem);
+
+		if (!thread_may_run_on (t, c))
+			continue;
+		ready_remove (t);
+		if (victim != c)
+			cfs_migrate (t, victim, c);
+		t->cpu = c;
+		cfs_update_min (c, t);
+		next = t;
+		break;
+	}
+	if (victim != c)
+		spin_unlock (&victim->rq_lock);
+	return next;
+}
+
+/* Returns true if the thread with cfs.elem A has less vruntime
+   than the thread with cfs.elem B. */
+bool
+thread_vruntime_less (const struct rb_elem *a, const struct rb_elem *b,
+		void *aux UNUSED) {
+	return rb_entry (a, struct thread, cfs.elem)->cfs.vruntime
+		< rb_entry (b, struct thread, cfs.elem)->cfs.vruntime;
+}
+
+/* Returns true if T is some CPU's idle thread. */
+static bool
+thread_is_idle (const struct thread *t) {
+	return t->cpu != NULL && t == t->cpu->idle_thread;
+}
+
+/* Locks and returns the CPU whose rq_lock covers T, which is
+   ready or running: the CPU T is queued or running on.  T may be
+   stolen by another CPU until the lock is held, so T's `cpu' is
+   checked again under it. */
+static struct cpu *
+thread_rq_lock (struct thread *t) {
+	for (;;) {
+		struct cpu *c = t->cpu;
+
+		spin_lock (&c->rq_lock);
+		if (c == t->cpu)
+			return c;
+		spin_unlock (&c->rq_lock);
+	}
+}
+
+/* Changes T's effective priority to PRIORITY, moving T to the
+   matching run queue if it is ready.  T's wake_lock must be
+   held, so that a blocked T stays blocked meanwhile. */
+static void
+set_priority_requeue (struct thread *t, int priority) {
+	struct cpu *c;
+
+	ASSERT (spin_held (&t->wake_lock));
+
+	if (t->status == THREAD_BLOCKED) {
+		t->priority = priority;
+		return;
+	}
+
+	c = thread_rq_lock (t);
+	if (t->status == THREAD_READY) {
+		ready_remove (t);
+		t->priority = priority;
+		ready_push (c, t);
+	} else
+		t->priority = priority;
+	spin_unlock (&c->rq_lock);
+}
+
+/* Returns the highest priority among ready threads on CPU C, or
+   PRI_MIN - 1 if no thread is ready there. */
+static int
+cpu_max_priority (const struct cpu *c) {
+	if (c->ready_mask == 0)
+		return PRI_MIN - 1;
+	return 63 - __builtin_clzll (c->ready_mask);
+}
+
+/* Returns the highest priority among ready threads on any CPU,
+   or PRI_MIN - 1 if no thread is ready. */
+static int
+ready_max_priority (void) {
+	int max = PRI_MIN - 1;
+
+	for (int i = 0; i < cpu_cnt; i++)
+		if (cpu_max_priority (&cpus[i]) > max)
+			max = cpu_max_priority (&cpus[i]);
+	return max;
+}
+
+/* Uses iretq to start running the context in TF.  Switches
+   between threads go through switch_threads() instead, so this
+   is only needed to enter user mode. */
 void
 do_iret (struct intr_frame *tf) {
+	/* iretq will turn interrupts on behind intr_enable()'s back,
+	   so end the interrupts-off span being traced here. */
+	if ((tf->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+		intr_trace_end ();
+
 	__asm __volatile(
 			"movq %0, %%rsp\n"
 			"movq 0(%%rsp),%%r15\n"
@@ -559,105 +1701,57 @@ do_iret (struct intr_frame *tf) {
 			: : "g" ((uint64_t) tf) : "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-   tables, and, if the previous thread is dying, destroying it.
-
-   At this function's invocation, we just switched from thread
-   PREV, the new thread is already running, and interrupts are
-   still disabled.
+/* Switches from the running thread to TH, returning when the
+   running thread is switched back to.  Only the callee-saved
+   registers, the stack pointer and the return address are saved;
+   see threads/switch.h.
 
-   It's not safe to call printf() until the thread switch is
-   complete.  In practice that means that printf()s should be
-   added at the end of the function. */
+   At this function's invocation, TH's address space is already
+   active, TH is marked running and interrupts are disabled.  It's
+   not safe to call printf() until the thread switch is
+   complete. */
 static void
 thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
 	ASSERT (intr_get_level () == INTR_OFF);
 
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
-}
-
-/* Schedules a new process. At entry, interrupts must be off.
- * This function modify current thread's status to status and then
- * finds another thread to run and switches to it.
- * It's not safe to call printf() in the schedule(). */
-static void
-do_schedule(int status) {
-	ASSERT (intr_get_level () == INTR_OFF);
-	ASSERT (thread_current()->status == THREAD_RUNNING);
-	while (!list_empty (&destruction_req)) {
-		struct thread *victim =
-			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
-	}
-	thread_current ()->status = status;
-	schedule ();
+	switch_threads (&running_thread ()->switch_rsp, th->switch_rsp);
 }
-/*schedule() 스케줄러는 실행할 스레드를 결정하고, 해당 스레드로 컨텍스트를 전환합니다. */
+
+/* Switches from the running thread, whose status the caller has
+   already changed, to the next thread to run.  At entry,
+   interrupts must be off and this CPU's rq_lock, and no other
+   spinlock, must be held.  The lock stays held across the switch
+   and is released by schedule_tail() in the thread switched to,
+   so no other CPU can take the previous thread before it is off
+   this CPU.  It's not safe to call printf() in schedule(). */
 static void
 schedule (void) {
+	struct cpu *c = this_cpu ();
 	struct thread *curr = running_thread ();/*현재 실행 중인 스레드를 가져온다.*/
-	struct thread *next = next_thread_to_run ();/*다음에 실행할 스레드를 결정한다.*/
+	struct thread *next;
+	bool preempted = c->yield_on_return;
 
 	ASSERT (intr_get_level () == INTR_OFF);/*이후 인터럽트가 꺼져 있는지 (INTR_OFF) */
+	ASSERT (spin_held (&c->rq_lock) && c->spin_cnt == 1);
 	ASSERT (curr->status != THREAD_RUNNING);/* 현재 스레드가 실행 중인 상태가 아닌지*/
+
+	next = next_thread_to_run ();/*다음에 실행할 스레드를 결정한다.*/
 	ASSERT (is_thread (next));/*그리고 선택한 다음 스레드가 유효한지를 확인합니다.*/
+	ASSERT (next == curr || !next->on_cpu);
+	if (thread_cfs) {
+		/* A yielding thread was charged before it was queued. */
+		if (curr->status != THREAD_READY && thread_in_cfs (curr))
+			cfs_charge (c, curr);
+		next->cfs.exec_start = rdtsc ();
+	}
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
+	next->cpu = c;
+	c->curr = next;
 
 	/* Start new time slice. */
-	thread_ticks = 0;
+	c->thread_ticks = 0;
+	c->yield_on_return = false;
 	
 
 #ifdef USERPROG
@@ -665,21 +1759,212 @@ schedule (void) {
 	process_activate (next);
 #endif
 
+	c->prev = NULL;
 	if (curr != next) {
-		/*  스레드가 종료 상태(THREAD_DYING)인 경우,
-		 그 스레드의 구조체를 파괴하도록 설계되어 있음을 설명합니다.
-		 이 작업은 thread_exit() 함수가 자신이 필요로 하는 데이터를 파괴하지 않도록 하기 위해 나중에 수행됩니다.
-		 이 함수는 Pintos의 멀티태스킹 기능을 관리하는 핵심 부분 중 하나입니다.
-		 다른 스레드가 CPU를 사용할 수 있도록 현재 실행 중인 스레드를 중지하고, 새로운 스레드를 실행합니다. */
-		if (curr && curr->status == THREAD_DYING && curr != initial_thread) {
-			ASSERT (curr != next);
-			list_push_back (&destruction_req, &curr->elem);
-		}
+		sched_account (curr, next, preempted);
+		next->on_cpu = true;
+		c->prev = curr;
 
 		/* Before switching the thread, we first save the information
 		 * of current running. */
 		thread_launch (next);
 	}
+	schedule_tail ();
+}
+
+/* Finishes a thread switch, in the thread switched to: marks the
+   previous thread as off its CPU and releases the rq_lock that
+   schedule() held across the switch.  Then frees the previous
+   thread's page if it died, and wakes it on its new CPU if
+   thread_bind() is moving it; both had to wait until we were off
+   its stack. */
+static void
+schedule_tail (void) {
+	struct cpu *c = this_cpu ();
+	struct thread *prev = c->prev;
+	bool migrate;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (spin_held (&c->rq_lock));
+
+	c->prev = NULL;
+	if (prev == NULL) {
+		spin_unlock (&c->rq_lock);
+		return;
+	}
+
+	/*  스레드가 종료 상태(THREAD_DYING)인 경우,
+	 그 스레드의 구조체를 파괴하도록 설계되어 있음을 설명합니다.
+	 이 작업은 thread_exit() 함수가 자신이 필요로 하는 데이터를 파괴하지 않도록 하기 위해 나중에 수행됩니다. */
+	if (prev->status == THREAD_DYING) {
+		spin_unlock (&c->rq_lock);
+		if (prev != initial_thread)
+			thread_page_free (prev);
+		return;
+	}
+
+	/* Once on_cpu is clear, a blocked PREV may be woken anywhere. */
+	migrate = prev->status == THREAD_BLOCKED && prev->bound_cpu != NULL
+		&& prev->bound_cpu != c;
+	__atomic_store_n (&prev->on_cpu, false, __ATOMIC_RELEASE);
+	spin_unlock (&c->rq_lock);
+	if (migrate)
+		thread_unblock (prev);
+}
+
+/* Charges the time since their last state change to CURR, which
+   is leaving the CPU, and to NEXT, which is about to run there.
+   CURR was preempted if it is still ready and PREEMPTED says an
+   interrupt handler asked for the yield. */
+static void
+sched_account (struct thread *curr, struct thread *next, bool preempted) {
+	uint64_t now = rdtsc ();
+	uint64_t wait = now - next->stats.stamp;
+	int b;
+
+	curr->stats.run_time += now - curr->stats.stamp;
+	curr->stats.stamp = now;
+	if (curr->status == THREAD_READY && preempted)
+		curr->stats.involuntary++;
+	else
+		curr->stats.voluntary++;
+
+	next->stats.ready_time += wait;
+	next->stats.stamp = now;
+	b = (wait >> SCHED_LAT_SHIFT) != 0
+		? 63 - __builtin_clzll (wait) - SCHED_LAT_SHIFT : 0;
+	if (b >= SCHED_LAT_BUCKETS)
+		b = SCHED_LAT_BUCKETS - 1;
+	next->stats.latency[b]++;
+}
+
+/* Copies what print_sched_stats() prints about T into S. */
+static void
+sched_snapshot (const struct thread *t, struct sched_snapshot *s) {
+	strlcpy (s->name, t->name, sizeof s->name);
+	s->tid = t->tid;
+	s->status = t->status;
+	s->stats = t->stats;
+	s->edf = thread_is_edf (t);
+	s->edf_period = t->edf.period;
+	s->edf_runtime = t->edf.runtime;
+	s->edf_misses = t->edf.misses;
+	s->edf_throttles = t->edf.throttles;
+	s->nice = t->nice;
+	s->cfs_weight = t->cfs.weight;
+	s->cfs_vruntime = t->cfs.vruntime;
+}
+
+/* Prints the scheduler accounting in T, charging the time since
+   the thread's last state change to its state. */
+static void
+print_sched_stats (const struct sched_snapshot *t) {
+	struct sched_stats s = t->stats;
+	uint64_t now = rdtsc ();
+
+	if (t->status == THREAD_RUNNING)
+		s.run_time += now - s.stamp;
+	else if (t->status == THREAD_READY)
+		s.ready_time += now - s.stamp;
+	else if (t->status == THREAD_BLOCKED)
+		s.blocked_time += now - s.stamp;
+
+	printf ("Thread %s (tid %d): %"PRId64" ticks, run %"PRIu64" us, "
+			"ready %"PRIu64" us, blocked %"PRIu64" us, "
+			"%u voluntary and %u involuntary switches\n",
+			t->name, t->tid, s.ticks, timer_cycles_to_us (s.run_time),
+			timer_cycles_to_us (s.ready_time),
+			timer_cycles_to_us (s.blocked_time),
+			s.voluntary, s.involuntary);
+	if (t->edf || t->edf_misses != 0 || t->edf_throttles != 0)
+		printf ("  EDF: period %"PRId64" ticks, runtime %"PRId64" ticks, "
+				"%u deadline misses, %u throttled periods\n",
+				t->edf_period, t->edf_runtime, t->edf_misses,
+				t->edf_throttles);
+	if (thread_cfs)
+		printf ("  CFS: nice %d, weight %u, vruntime %"PRIu64" us\n",
+				t->nice, t->cfs_weight, timer_cycles_to_us (t->cfs_vruntime));
+
+	/* Bucket 0 also holds everything shorter than its lower bound. */
+	printf ("  dispatch latency:");
+	for (int b = 0; b < SCHED_LAT_BUCKETS; b++)
+		if (s.latency[b] != 0)
+			printf (" %s%"PRIu64"us:%u", b == 0 ? "<" : ">=",
+					timer_cycles_to_us (1ULL << (SCHED_LAT_SHIFT + b
+							+ (b == 0))),
+					s.latency[b]);
+	printf ("\n");
+}
+
+/* Returns a page for a new thread, preferably one left by a
+   thread that died on this CPU, so that thread churn need not
+   go through the page allocator.  The page is not zeroed:
+   init_thread() clears the struct thread at its start, and the
+   rest is stack. */
+static struct thread *
+thread_page_alloc (void) {
+	enum intr_level old_level;
+	struct thread *t = NULL;
+	struct cpu *c;
+
+	old_level = intr_disable ();
+	c = this_cpu ();
+	spin_lock (&c->rq_lock);
+	if (c->thread_page_cnt > 0)
+		t = c->thread_pages[--c->thread_page_cnt];
+	spin_unlock (&c->rq_lock);
+	intr_set_level (old_level);
+
+	if (t == NULL)
+		t = palloc_get_page (0);
+	return t;
+}
+
+/* Frees the page of dead thread T, keeping it in this CPU's
+   cache if there is room.  Interrupts must be off. */
+static void
+thread_page_free (struct thread *t) {
+	struct cpu *c = this_cpu ();
+	bool cached = false;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	spin_lock (&c->rq_lock);
+	if (c->thread_page_cnt < THREAD_CACHE_PAGES) {
+		c->thread_pages[c->thread_page_cnt++] = t;
+		cached = true;
+	}
+	spin_unlock (&c->rq_lock);
+	if (!cached)
+		palloc_free_page (t);
+}
+
+/* Returns every CPU's cached thread pages to the page allocator,
+   which calls this when it runs out of kernel pages.  Returns
+   the number of pages freed. */
+int
+thread_page_cache_trim (void) {
+	int cnt = 0;
+
+	for (int i = 0; i < cpu_cnt; i++) {
+		void *pages[THREAD_CACHE_PAGES];
+		enum intr_level old_level = intr_disable ();
+		int n;
+
+		/* The pool's lock comes after rq_lock, so free the pages
+		   only once it is dropped. */
+		spin_lock (&cpus[i].rq_lock);
+		n = cpus[i].thread_page_cnt;
+		memcpy (pages, cpus[i].thread_pages, n * sizeof *pages);
+		cpus[i].thread_page_cnt = 0;
+		spin_unlock (&cpus[i].rq_lock);
+		intr_set_level (old_level);
+
+		for (int j = 0; j < n; j++)
+			palloc_free_page (pages[j]);
+		cnt += n;
+	}
+	return cnt;
 }
 
 /* Returns a tid to use for a new thread. */
@@ -695,62 +1980,44 @@ allocate_tid (void) {
 	return tid;
 }
 
-/*주어진 두 개의 list_elem 구조체를 비교하여 그들이 가리키는 thread 구조체의 wakeup_ticks 값을 비교합니다.
- wakeup_ticks 값이 작은 thread를 먼저 오도록 하여 정렬 순서를 결정합니다.*/
-bool wakeup_tick_less_function(const struct list_elem *a, const struct list_elem *b,
-                               void *aux UNUSED)
-{
-    struct thread *thread_a = list_entry(a, struct thread, elem);
-    struct thread *thread_b = list_entry(b, struct thread, elem);
-    return thread_a->wakeup_ticks < thread_b->wakeup_ticks;
+/* Puts the running thread to sleep until timer_ticks() reaches
+   TICKS.  The thread is woken by its own timer event, so going
+   to sleep and waking up are both O(1) in the number of
+   sleepers. */
+void
+thread_sleep (int64_t ticks) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	if (!thread_is_idle (curr)) {
+		struct cpu *c = this_cpu ();
+
+		/* The event may fire on another CPU at once, so the thread
+		   must already be marked blocked; thread_unblock() waits
+		   for it to switch away. */
+		curr->wakeup_ticks = ticks;
+		curr->status = THREAD_BLOCKED;
+		timer_event_add (&curr->sleep_timer, ticks);
+		spin_lock (&c->rq_lock);
+		schedule ();
+	}
+	intr_set_level (old_level);
 }
 
+/* Timer callback that wakes sleeping thread T_.  Runs in the
+   timer softirq, so preemption is requested on return instead
+   of yielding here. */
+static void
+thread_wakeup (void *t_) {
+	struct thread *t = t_;
 
+	ASSERT (intr_context ());
 
-/*스레드를 잠들게 하는 역할을 수행한다.*/
-void thread_sleep(int64_t ticks)
-{
-	
-    struct thread *curr = thread_current();/*함수를 사용하여 현재 실행 중인 스레드를 가져온다.*/
-    enum intr_level old_level;
-    ASSERT(!intr_context());/*intr_context함수를 사용하여 현재 스레드가 인터럽트 컨텍스에서 실행 중인지 확인하다. 인터럽트 컨텍스트에서 thread_sleep함수를 호출하는 것을 방지하기 위해 사용한다.*/
-    old_level = intr_disable(); /* 인터럽트 비활성화*/
-    if (curr != idle_thread)    /*만약 스레드가 유휴스레드가 아닌 경우 why? 유휴 스레드는 대기 상태에 들어가지 않으며 항상 실행 가능한 상태로 유지한다. */
-    {
-		if (ticks < global_tick)
-			global_tick =ticks;/*ticks값이 global_tick보다 작을 경우, global_tick값을 ticks로 업데이트 한다. 스레드가 일시적으로 블록된 상태에서 특정 시간이 지났을 때 재게될수 있도록한다.*/
-        /*localtick을 wakeup_tick에 저장해준다. why? wakeup_ticks 변수에 ticks값을 저장한다. 이는 스레드가 얼마나 오랫동안 잠들어 있어야 하는 지를 나타낸다.*/
-        curr->wakeup_ticks = ticks;
-        /*list_insert_ordered함수를 통해서 "tick" 값에 따라 sleep_list에 스레드를 작은 값부터 큰 값의 순서대로 삽입한다.*/
-        list_insert_ordered(&sleep_list, &curr->elem, wakeup_tick_less_function, NULL);
-        // do_schedule(THREAD_BLOCKED);
-		thread_block(); /*현재 스레드를 블록 상태로 전환한다. 이로써 스레드는 실행 가능한 상태에서 제외되고, 일정 시간이 지나면 다시 스케줄링되어 실행될 수 있다.*/
-		
-	}
-    intr_set_level(old_level); /*해당 함수를 사용하여 이전의 인터럽트 상태를 복원한다. 이전에 비활성화 된 인터럽트를 다시 활성화 한다.*/
-}
-
-
-/*잠들어 있는 스레드를 깨우는 역할을 수행한다.*/
-void thread_wakeup(void)
-{
-	struct thread *sleep_thread;/*sleep_thread라는 구조체 포인터를 선언한다. 이변수는 잠들어 있는 스레드를 가리킬 것이다.*/
-
-	if (!list_empty(&sleep_list)) /*sleep_list가 비어있는 지 확인한다. 만약 비어있는 상태가 아니라면*/
-	{
-		sleep_thread = list_entry(list_pop_front(&sleep_list), struct thread, elem); /*list_pop_front 함수를 사용하여 sleep_list에서 맨 앞의 스레드를 가져온다. 이는 잠들어 있던 스레드 중 가장 일찍 깨어나야 하는 스레드를 의미한다.*/
-		
-		if (!list_empty(&sleep_list)) /*다른 스레드들이 여전히 잠들어 있는 확인한다.*/
-			global_tick = list_entry(list_begin(&sleep_list), struct thread, elem)->wakeup_ticks; /* global_tick값을 다음으로 일찍 깨어나야 하는 스레드의 wakeup_ticks값으로 설정한다. 이는 sleep_list의 첫 번째 원소가 가장 일찍 깨어나야 하는 스레드이기 때문이다.*/
-		else
-			global_tick = global_tick = 0x7FFFFFFFFFFFFFFF; /*잠들어있는 스레드가 없는 경우 global_tick값을 매우 큰 값으로 설정한다.why?다음으로 깨어나야할 스레드가 없음을 의미한다.*/
-		list_insert_ordered(&ready_list, &sleep_thread->elem, cmp_priority, NULL); /*ready_list에 깨어난 스레드를 우선순위로 삽입한다. ready_list는 실행가능한 스레드들을 저장하는 리스트이다.*/
-		sleep_thread->status = THREAD_READY; /*깨어난 스레드의 상태를 Thread_ready로 설정한다.*/	
-			
-	
-	};
-	
-		
+	thread_unblock (t);
+	test_max_priority ();
 }
 
 /* 비교 함수 cmp_priority는 두 개의 리스트 원소를 받아와 그들의 우선 순위를 비교합니다.
@@ -772,23 +2039,102 @@ bool cmp_priority(const struct list_elem *a, const struct list_elem *b, void *au
 	
 };
 
-void
-donate_priority(void) {
-	int depth;
-	depth = 0;
-	struct thread *temp;
-
-	while (temp->waiting_lock != NULL && depth < 8)
-	{
-		depth++;
-		if (temp->waiting_lock->holder == NULL)
-			break;
-		if (temp->waiting_lock->holder->priority >= temp->priority)
-			break;	
-		temp->waiting_lock->holder->priority = temp->priority;
-		temp = temp->waiting_lock->holder;
+/* Returns true if the priority of the thread with wait_elem A
+   is less than that of the thread with wait_elem B. */
+bool
+thread_priority_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct thread, wait_elem)->priority
+		< heap_entry (b, struct thread, wait_elem)->priority;
+}
+
+/* Returns T's base priority, raised to the highest priority
+   donated to it through the locks it holds. */
+static int
+thread_donated_priority (const struct thread *t) {
+	int priority = t->original_priority;
+
+	if (!heap_empty (&t->held_locks)) {
+		struct lock *lock = heap_entry (heap_max (&t->held_locks),
+				struct lock, elem);
+		int donated = lock_donated_priority (lock);
+
+		if (donated > priority)
+			priority = donated;
 	}
+	return priority;
 }
 
+/* Recomputes T's effective priority after its base priority or
+   the set of locks it holds or their waiters changed, and passes
+   the change on to the threads T's priority is donated to.
+   donation_lock must be held. */
+void
+thread_refresh_priority (struct thread *t) {
+	ASSERT (spin_held (&donation_lock));
+	ASSERT (!thread_mlfqs);
 
+	thread_change_priority (t, thread_donated_priority (t));
+}
+
+/* Changes T's effective priority to PRIORITY.  If T is blocked
+   on a wait queue, this moves T within the queue.  If the queue
+   belongs to a lock, that may change the priority donated to
+   the lock's holder, so the holder is updated in turn, and so on
+   down the chain of waiting threads until a priority stays the
+   same.  Every step takes O(log n) time, and there is no limit
+   on the length of the chain.  donation_lock must be held.
+
+   Each step locks T's wake_lock, which keeps T on its wait queue,
+   before the queue's lock.  Wait queue code takes them the other
+   way around, so the queue's lock is only tried, and the step
+   starts over if it is busy. */
+static void
+thread_change_priority (struct thread *t, int priority) {
+	ASSERT (spin_held (&donation_lock));
+
+	for (;;) {
+		struct waitqueue *wq;
+		struct lock *lock;
+		struct thread *holder;
+
+		spin_lock (&t->wake_lock);
+		if (t->priority == priority) {
+			spin_unlock (&t->wake_lock);
+			return;
+		}
+		wq = t->waitqueue;
+		if (wq == NULL) {
+			set_priority_requeue (t, priority);
+			spin_unlock (&t->wake_lock);
+			return;
+		}
+		if (!spin_trylock (&wq->spin)) {
+			spin_unlock (&t->wake_lock);
+			asm volatile ("pause");
+			continue;
+		}
 
+		/* Keys may not change inside a heap, so take T out of
+		   the queue, and the lock out of its holder's held
+		   locks, around the change.  The 4.4BSD scheduler does
+		   not donate, but still wakes waiters in priority
+		   order. */
+		lock = wq->lock;
+		holder = lock != NULL && !thread_mlfqs ? lock->holder : NULL;
+		if (holder != NULL)
+			heap_remove (&holder->held_locks, &lock->elem);
+		heap_remove (&wq->waiters, &t->wait_elem);
+		t->priority = priority;
+		heap_push (&wq->waiters, &t->wait_elem);
+		if (holder != NULL)
+			heap_push (&holder->held_locks, &lock->elem);
+		spin_unlock (&wq->spin);
+		spin_unlock (&t->wake_lock);
+		if (holder == NULL)
+			return;
+
+		t = holder;
+		priority = thread_donated_priority (holder);
+	}
+}
@@ -0,0 +1,478 @@
+#include "threads/workpool.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* Number of slots in a worker's deque.  Must be a power of 2.
+   Work that does not fit goes to the shared queue instead. */
+#define DEQUE_SIZE 64
+
+/* A work-stealing deque, after Chase and Lev, "Dynamic Circular
+   Work-Stealing Deque" (SPAA 2005), with the memory ordering of
+   Lê et al., "Correct and Efficient Work-Stealing for Weak
+   Memory Models" (PPoPP 2013).  The owner pushes and takes at
+   the bottom; any other worker may steal from the top at the
+   same time, with interrupts on, so the indexes are only touched
+   with atomic operations.  The array does not grow. */
+struct deque {
+	int64_t top;                /* Index of the next work to steal. */
+	int64_t bottom;             /* Index of the next free slot. */
+	struct work *slots[DEQUE_SIZE];
+};
+
+/* A worker thread. */
+struct worker {
+	struct deque deque;         /* Work submitted by this worker. */
+	struct thread *thread;      /* The worker itself. */
+	struct cpu *cpu;            /* CPU it is bound to. */
+	struct work *current;       /* Work running now, or NULL. */
+	struct semaphore wakeup;    /* Upped to wake the worker when idle. */
+	struct list_elem idle_elem; /* Element in idle_workers. */
+
+	/* Statistics. */
+	uint64_t start;             /* TSC when the worker started. */
+	uint64_t busy_cycles;       /* TSC cycles spent running work. */
+	long long run_cnt;          /* Work run. */
+	long long steal_cnt;        /* Work stolen from other workers. */
+};
+
+/* Someone waiting in work_flush() or workpool_flush(). */
+struct flush_waiter {
+	struct list_elem elem;      /* Element in flush_waiters. */
+	struct work *work;          /* Work waited for, or NULL for all. */
+	struct semaphore sema;      /* Upped when the wait is over. */
+};
+
+static struct worker workers[CPU_MAX];
+static int worker_cnt;
+
+/* The rest is protected by workpool_lock, taken with interrupts
+   off.  Semaphores are only upped once it is released. */
+static struct spinlock workpool_lock;
+static struct list priority_queue;  /* Shared work served first. */
+static struct list shared_queue;    /* Other work from non-workers. */
+static struct list idle_workers;    /* Workers waiting for work. */
+static struct list flush_waiters;   /* Threads in a flush. */
+static int active_cnt;              /* Work submitted and not finished. */
+
+static void worker_main (void *);
+static struct worker *current_worker (void);
+static struct work *worker_next (struct worker *);
+static void worker_idle (struct worker *);
+static void worker_run (struct worker *, struct work *);
+static bool submit (struct work *, bool priority);
+static bool work_available (void);
+static bool work_busy (const struct work *);
+static struct worker *idle_worker (void);
+static void wake_flushers (struct work *);
+static bool deque_push (struct deque *, struct work *);
+static struct work *deque_take (struct deque *);
+static struct work *deque_steal (struct deque *);
+static bool deque_empty (const struct deque *);
+
+/* Starts one worker for each CPU that is running, bound to that
+   CPU.  Must be called with interrupts on, after smp_init(). */
+void
+workpool_init (void) {
+	list_init (&priority_queue);
+	list_init (&shared_queue);
+	list_init (&idle_workers);
+	list_init (&flush_waiters);
+	spin_init (&workpool_lock);
+
+	for (int i = 0; i < cpu_cnt; i++) {
+		struct worker *w = &workers[worker_cnt];
+		char name[16];
+
+		if (!cpus[i].started)
+			continue;
+		w->cpu = &cpus[i];
+		sema_init (&w->wakeup, 0);
+		snprintf (name, sizeof name, "kworker/%d", i);
+		worker_cnt++;
+		if (thread_create (name, PRI_DEFAULT, worker_main, w) == TID_ERROR)
+			PANIC ("cannot start worker for CPU %d", i);
+	}
+}
+
+/* Returns the number of workers. */
+int
+workpool_size (void) {
+	return worker_cnt;
+}
+
+/* Initializes WORK to run FUNC with auxiliary data AUX. */
+void
+work_init (struct work *work, work_func *func, void *aux) {
+	ASSERT (work != NULL);
+	ASSERT (func != NULL);
+
+	work->func = func;
+	work->aux = aux;
+	work->pending = false;
+}
+
+/* Submits WORK to run on some worker.  Returns false, doing
+   nothing, if WORK is already pending; work that is running may
+   be submitted again.  May be called from an interrupt
+   handler. */
+bool
+work_submit (struct work *work) {
+	return submit (work, false);
+}
+
+/* Like work_submit(), but WORK runs ahead of all work submitted
+   with work_submit(), as soon as a worker is free. */
+bool
+work_submit_priority (struct work *work) {
+	return submit (work, true);
+}
+
+/* Waits until WORK is neither pending nor running.  Must not be
+   called by work, which could end up waiting for itself. */
+void
+work_flush (struct work *work) {
+	struct flush_waiter waiter;
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+	ASSERT (current_worker () == NULL);
+
+	old_level = intr_disable ();
+	spin_lock (&workpool_lock);
+	if (work_busy (work)) {
+		waiter.work = work;
+		sema_init (&waiter.sema, 0);
+		list_push_back (&flush_waiters, &waiter.elem);
+		spin_unlock (&workpool_lock);
+		intr_set_level (old_level);
+		sema_down (&waiter.sema);
+	} else {
+		spin_unlock (&workpool_lock);
+		intr_set_level (old_level);
+	}
+}
+
+/* Waits until no work is pending or running, including work
+   submitted during the wait.  Must not be called by work. */
+void
+workpool_flush (void) {
+	work_flush (NULL);
+}
+
+/* Prints each worker's statistics: the work it ran, how much of
+   that it stole, and the share of its life spent running work. */
+void
+workpool_print_stats (void) {
+	for (int i = 0; i < worker_cnt; i++) {
+		struct worker *w = &workers[i];
+		uint64_t life = rdtsc () - w->start;
+
+		printf ("Workpool: %s: %lld run, %lld stolen, %"PRIu64"%% busy\n",
+				w->thread != NULL ? w->thread->name : "?", w->run_cnt,
+				w->steal_cnt, life != 0 ? w->busy_cycles * 100 / life : 0);
+	}
+}
+
+/* A worker thread.  Runs whatever work it can find, and sleeps
+   when there is none. */
+static void
+worker_main (void *w_) {
+	struct worker *w = w_;
+
+	if (smp_active)
+		thread_bind (w->cpu);
+	w->thread = thread_current ();
+	w->start = rdtsc ();
+
+	for (;;) {
+		struct work *work = worker_next (w);
+
+		if (work != NULL)
+			worker_run (w, work);
+		else
+			worker_idle (w);
+	}
+}
+
+/* Returns the worker that is running, or a null pointer if the
+   running thread is not a worker. */
+static struct worker *
+current_worker (void) {
+	struct thread *t = thread_current ();
+
+	for (int i = 0; i < worker_cnt; i++)
+		if (workers[i].thread == t)
+			return &workers[i];
+	return NULL;
+}
+
+/* Finds the next work for W to run: priority work first, then
+   W's own work, newest first, then shared work, then work stolen
+   from the other workers, oldest first.  Returns a null pointer
+   if there is none. */
+static struct work *
+worker_next (struct worker *w) {
+	struct work *work = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	spin_lock (&workpool_lock);
+	if (!list_empty (&priority_queue))
+		work = list_entry (list_pop_front (&priority_queue), struct work, elem);
+	spin_unlock (&workpool_lock);
+	intr_set_level (old_level);
+	if (work != NULL)
+		return work;
+
+	work = deque_take (&w->deque);
+	if (work != NULL)
+		return work;
+
+	old_level = intr_disable ();
+	spin_lock (&workpool_lock);
+	if (!list_empty (&shared_queue))
+		work = list_entry (list_pop_front (&shared_queue), struct work, elem);
+	spin_unlock (&workpool_lock);
+	intr_set_level (old_level);
+	if (work != NULL)
+		return work;
+
+	for (int i = 1; i < worker_cnt; i++) {
+		struct worker *victim = &workers[(w - workers + i) % worker_cnt];
+
+		work = deque_steal (&victim->deque);
+		if (work != NULL) {
+			w->steal_cnt++;
+			return work;
+		}
+	}
+	return NULL;
+}
+
+/* Puts W to sleep until new work arrives, unless there is work
+   it could already take. */
+static void
+worker_idle (struct worker *w) {
+	enum intr_level old_level = intr_disable ();
+
+	spin_lock (&workpool_lock);
+	if (!work_available ()) {
+		list_push_back (&idle_workers, &w->idle_elem);
+		spin_unlock (&workpool_lock);
+		intr_set_level (old_level);
+		sema_down (&w->wakeup);
+	} else {
+		spin_unlock (&workpool_lock);
+		intr_set_level (old_level);
+	}
+}
+
+/* Runs WORK on worker W. */
+static void
+worker_run (struct worker *w, struct work *work) {
+	enum intr_level old_level;
+	uint64_t start;
+
+	old_level = intr_disable ();
+	spin_lock (&workpool_lock);
+	work->pending = false;
+	w->current = work;
+	spin_unlock (&workpool_lock);
+	intr_set_level (old_level);
+
+	start = rdtsc ();
+	work->func (work->aux);
+	w->busy_cycles += rdtsc () - start;
+	w->run_cnt++;
+
+	/* WORK may have been freed by now, so it is only compared. */
+	old_level = intr_disable ();
+	spin_lock (&workpool_lock);
+	w->current = NULL;
+	active_cnt--;
+	wake_flushers (work);
+	intr_set_level (old_level);
+}
+
+/* Queues WORK, ahead of other work if PRIORITY is true.
+   Returns false if it was already pending. */
+static bool
+submit (struct work *work, bool priority) {
+	struct worker *w = intr_context () ? NULL : current_worker ();
+	struct worker *idle;
+	enum intr_level old_level;
+
+	ASSERT (work != NULL);
+	ASSERT (worker_cnt > 0);
+
+	old_level = intr_disable ();
+	spin_lock (&workpool_lock);
+	if (work->pending) {
+		spin_unlock (&workpool_lock);
+		intr_set_level (old_level);
+		return false;
+	}
+	work->pending = true;
+	active_cnt++;
+	if (priority)
+		list_push_back (&priority_queue, &work->elem);
+	else if (w == NULL || !deque_push (&w->deque, work))
+		list_push_back (&shared_queue, &work->elem);
+	idle = idle_worker ();
+	spin_unlock (&workpool_lock);
+	if (idle != NULL)
+		sema_up (&idle->wakeup);
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Returns true if any worker could find work to run. */
+static bool
+work_available (void) {
+	ASSERT (spin_held (&workpool_lock));
+
+	if (!list_empty (&priority_queue) || !list_empty (&shared_queue))
+		return true;
+	for (int i = 0; i < worker_cnt; i++)
+		if (!deque_empty (&workers[i].deque))
+			return true;
+	return false;
+}
+
+/* Returns true if WORK is pending or running, or, if WORK is
+   null, if any work is. */
+static bool
+work_busy (const struct work *work) {
+	ASSERT (spin_held (&workpool_lock));
+
+	if (work == NULL)
+		return active_cnt > 0;
+	if (work->pending)
+		return true;
+	for (int i = 0; i < worker_cnt; i++)
+		if (workers[i].current == work)
+			return true;
+	return false;
+}
+
+/* Removes and returns an idle worker for the caller to wake, or
+   returns a null pointer if there is none. */
+static struct worker *
+idle_worker (void) {
+	ASSERT (spin_held (&workpool_lock));
+
+	if (list_empty (&idle_workers))
+		return NULL;
+	return list_entry (list_pop_front (&idle_workers), struct worker,
+			idle_elem);
+}
+
+/* Wakes the threads whose flush ended when WORK finished.
+   Releases workpool_lock, which must be held. */
+static void
+wake_flushers (struct work *work) {
+	struct list done;
+	struct list_elem *e;
+
+	ASSERT (spin_held (&workpool_lock));
+
+	list_init (&done);
+	for (e = list_begin (&flush_waiters); e != list_end (&flush_waiters); ) {
+		struct flush_waiter *waiter = list_entry (e, struct flush_waiter, elem);
+
+		e = list_next (e);
+		if ((waiter->work == NULL || waiter->work == work)
+				&& !work_busy (waiter->work)) {
+			list_remove (&waiter->elem);
+			list_push_back (&done, &waiter->elem);
+		}
+	}
+	spin_unlock (&workpool_lock);
+
+	/* A waiter may return, and its flush_waiter go away, as soon
+	   as its semaphore is up, so step past it first. */
+	for (e = list_begin (&done); e != list_end (&done); ) {
+		struct flush_waiter *waiter = list_entry (e, struct flush_waiter, elem);
+
+		e = list_next (e);
+		sema_up (&waiter->sema);
+	}
+}
+
+/* Pushes WORK at the bottom of D, which must belong to the
+   running worker.  Returns false if D is full. */
+static bool
+deque_push (struct deque *d, struct work *work) {
+	int64_t b = __atomic_load_n (&d->bottom, __ATOMIC_RELAXED);
+	int64_t t = __atomic_load_n (&d->top, __ATOMIC_ACQUIRE);
+
+	if (b - t >= DEQUE_SIZE)
+		return false;
+	__atomic_store_n (&d->slots[b & (DEQUE_SIZE - 1)], work, __ATOMIC_RELAXED);
+	__atomic_store_n (&d->bottom, b + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/* Removes and returns the work at the bottom of D, which must
+   belong to the running worker, or returns a null pointer if D
+   is empty.  Only a race for the last work needs the
+   compare-and-swap a thief uses. */
+static struct work *
+deque_take (struct deque *d) {
+	int64_t b = __atomic_load_n (&d->bottom, __ATOMIC_RELAXED) - 1;
+	int64_t t;
+	struct work *work;
+
+	__atomic_store_n (&d->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+	t = __atomic_load_n (&d->top, __ATOMIC_RELAXED);
+
+	if (t > b) {
+		/* Empty. */
+		__atomic_store_n (&d->bottom, b + 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+	work = __atomic_load_n (&d->slots[b & (DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+	if (t == b) {
+		/* Last one: whoever moves `top' first gets it. */
+		if (!__atomic_compare_exchange_n (&d->top, &t, t + 1, false,
+					__ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			work = NULL;
+		__atomic_store_n (&d->bottom, b + 1, __ATOMIC_RELAXED);
+	}
+	return work;
+}
+
+/* Removes and returns the work at the top of D, or returns a null
+   pointer if D is empty or another worker got there first. */
+static struct work *
+deque_steal (struct deque *d) {
+	int64_t t = __atomic_load_n (&d->top, __ATOMIC_ACQUIRE);
+	int64_t b;
+	struct work *work;
+
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+	b = __atomic_load_n (&d->bottom, __ATOMIC_ACQUIRE);
+	if (t >= b)
+		return NULL;
+
+	work = __atomic_load_n (&d->slots[t & (DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+	if (!__atomic_compare_exchange_n (&d->top, &t, t + 1, false,
+				__ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		return NULL;
+	return work;
+}
+
+/* Returns true if D looks empty. */
+static bool
+deque_empty (const struct deque *d) {
+	return __atomic_load_n (&d->top, __ATOMIC_ACQUIRE)
+		>= __atomic_load_n (&d->bottom, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,157 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Fast user-space mutexes.
+
+   A futex is just an int in user memory.  User code manipulates
+   it with atomic instructions and only makes a system call when
+   it has to sleep or wake someone up: futex_wait() sleeps if the
+   int still holds the value the caller last saw, and
+   futex_wake() wakes sleepers on the same int.  Checking the
+   value and going to sleep are atomic with respect to
+   futex_wake(), so a wakeup between user code's check and the
+   system call is never lost.
+
+   Waiters are kept in a fixed hash table of wait queues.  A
+   futex is identified by the kernel address of the int, that
+   is, by the physical memory behind the caller's virtual
+   address, so the same int reached through different address
+   spaces is still one futex. */
+
+/* Number of wait queues.  Must be a power of 2. */
+#define FUTEX_BUCKETS 64
+
+/* A wait queue for every futex that hashes to it. */
+struct futex_bucket {
+	struct lock lock;           /* Protects waiters. */
+	struct list waiters;        /* List of struct futex_waiter. */
+};
+
+/* A thread sleeping in futex_wait(). */
+struct futex_waiter {
+	struct list_elem elem;      /* Element in futex_bucket's waiters. */
+	const int *key;             /* Kernel address of the futex. */
+	struct thread *thread;      /* The sleeping thread. */
+	struct semaphore sema;      /* Upped to wake the thread. */
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+static const int *futex_key (const int *uaddr);
+static struct futex_bucket *futex_bucket (const int *key);
+static struct futex_waiter *futex_first_waiter (struct futex_bucket *,
+		const int *key);
+
+/* Initializes the futex wait queues. */
+void
+futex_init (void) {
+	for (int i = 0; i < FUTEX_BUCKETS; i++) {
+		lock_init (&buckets[i].lock);
+		list_init (&buckets[i].waiters);
+	}
+}
+
+/* If the int at user address UADDR equals VAL, sleeps until
+   futex_wake() is called on it and returns 0.  Otherwise,
+   returns -1 at once, as it also does if UADDR is not a valid,
+   aligned, mapped user address. */
+int
+futex_wait (const int *uaddr, int val) {
+	const int *key = futex_key (uaddr);
+	struct futex_bucket *b;
+	struct futex_waiter w;
+
+	if (key == NULL)
+		return -1;
+
+	b = futex_bucket (key);
+	lock_acquire (&b->lock);
+	if (*(volatile const int *) key != val) {
+		lock_release (&b->lock);
+		return -1;
+	}
+	w.key = key;
+	w.thread = thread_current ();
+	sema_init (&w.sema, 0);
+	list_push_back (&b->waiters, &w.elem);
+	lock_release (&b->lock);
+
+	/* A wakeup between releasing the bucket and sleeping just
+	   leaves the semaphore up. */
+	sema_down (&w.sema);
+	return 0;
+}
+
+/* Wakes up to N threads sleeping on the int at user address
+   UADDR, highest priority first, and returns the number woken,
+   or -1 if UADDR is not a valid, aligned, mapped user
+   address. */
+int
+futex_wake (const int *uaddr, int n) {
+	const int *key = futex_key (uaddr);
+	struct futex_bucket *b;
+	int woken = 0;
+
+	if (key == NULL)
+		return -1;
+
+	b = futex_bucket (key);
+	lock_acquire (&b->lock);
+	while (woken < n) {
+		struct futex_waiter *w = futex_first_waiter (b, key);
+		if (w == NULL)
+			break;
+		list_remove (&w->elem);
+		sema_up (&w->sema);
+		woken++;
+	}
+	lock_release (&b->lock);
+	return woken;
+}
+
+/* Returns the kernel address of the int at user address UADDR
+   in the running process, or a null pointer if UADDR is not a
+   mapped, aligned user address. */
+static const int *
+futex_key (const int *uaddr) {
+	struct thread *t = thread_current ();
+
+	if (t->pml4 == NULL || !is_user_vaddr (uaddr)
+			|| (uintptr_t) uaddr % sizeof *uaddr != 0)
+		return NULL;
+	return pml4_get_page (t->pml4, uaddr);
+}
+
+/* Returns the wait queue for the futex at kernel address KEY. */
+static struct futex_bucket *
+futex_bucket (const int *key) {
+	return &buckets[hash_bytes (&key, sizeof key) & (FUTEX_BUCKETS - 1)];
+}
+
+/* Returns the highest-priority waiter in B on the futex at KEY,
+   or a null pointer if there is none.  Priorities are compared
+   at wakeup time, so donations received while asleep count.
+   B's lock must be held. */
+static struct futex_waiter *
+futex_first_waiter (struct futex_bucket *b, const int *key) {
+	struct futex_waiter *best = NULL;
+	struct list_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&b->lock));
+
+	for (e = list_begin (&b->waiters); e != list_end (&b->waiters);
+			e = list_next (e)) {
+		struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+		if (w->key == key
+				&& (best == NULL || w->thread->priority > best->thread->priority))
+			best = w;
+	}
+	return best;
+}
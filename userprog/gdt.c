@@ -1,6 +1,8 @@
 #include "userprog/gdt.h"
 #include <debug.h>
+#include <string.h>
 #include "userprog/tss.h"
+#include "threads/cpu.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -61,7 +63,9 @@ struct segment_descriptor64 {
 	type, 1, dpl, 1, (unsigned) (lim) >> 28, 0, 1, 0, 1, \
 	(unsigned) (base) >> 24 }
 
-static struct segment_desc gdt[SEL_CNT] = {
+/* The descriptors every CPU's GDT starts from.  Only the TSS
+ * descriptor, filled in by gdt_init(), differs between CPUs. */
+static const struct segment_desc gdt_template[SEL_CNT] = {
 	[SEL_NULL >> 3] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 	[SEL_KCSEG >> 3] = SEG64 (0xa, 0x0, 0xffffffff, 0),
 	[SEL_KDSEG >> 3] = SEG64 (0x2, 0x0, 0xffffffff, 0),
@@ -72,20 +76,26 @@ static struct segment_desc gdt[SEL_CNT] = {
 	[7] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 };
 
-struct desc_ptr gdt_ds = {
-	.size = sizeof(gdt) - 1,
-	.address = (uint64_t) gdt
-};
+/* One GDT per CPU, since each has its own TSS. */
+static struct segment_desc gdt[CPU_MAX][SEL_CNT];
 
-/* Sets up a proper GDT.  The bootstrap loader's GDT didn't
-   include user-mode selectors or a TSS, but we need both now. */
+/* Sets up a proper GDT for the running CPU.  The bootstrap
+   loader's GDT didn't include user-mode selectors or a TSS, but
+   we need both now.  Call tss_init() first. */
 void
 gdt_init (void) {
 	/* Initialize GDT. */
+	struct segment_desc *cpu_gdt = gdt[this_cpu ()->id];
+	struct desc_ptr gdt_ds = {
+		.size = sizeof gdt_template - 1,
+		.address = (uint64_t) cpu_gdt
+	};
 	struct segment_descriptor64 *tss_desc =
-		(struct segment_descriptor64 *) &gdt[SEL_TSS >> 3];
+		(struct segment_descriptor64 *) &cpu_gdt[SEL_TSS >> 3];
 	struct task_state *tss = tss_get ();
 
+	memcpy (cpu_gdt, gdt_template, sizeof gdt_template);
+
 	*tss_desc = (struct segment_descriptor64) {
 		.lim_15_0 = (uint64_t) (sizeof (struct task_state)) & 0xffff,
 		.base_15_0 = (uint64_t) (tss) & 0xffff,
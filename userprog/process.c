@@ -22,6 +22,11 @@
 #include "vm/vm.h"
 #endif
 
+/* If true, load() maps each aligned 2 MB run of a segment that is
+   all zero-fill, such as a large BSS, with a single large page.
+   Controlled by the kernel command-line option "-largepages". */
+bool user_large_pages;
+
 static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
@@ -93,6 +98,26 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 
 	/* 1. TODO: If the parent_page is kernel page, then return immediately. */
 
+	/* A large page, loaded with -largepages, is copied whole into
+	 * a large page of the child's own.  The kernel's large pages
+	 * are already in the child's pml4. */
+	if (is_large_pte (pte)) {
+		if (is_kernel_vaddr (va))
+			return true;
+		parent_page = ptov (LPTE_ADDR (*pte));
+		newpage = palloc_get_multiple (PAL_USER, LPG_PAGES);
+		if (newpage == NULL)
+			return false;
+		ASSERT (lpg_ofs (newpage) == 0);
+		memcpy (newpage, parent_page, LPGSIZE);
+		writable = (*pte & PTE_W) != 0;
+		if (!pml4_set_large_page (current->pml4, va, newpage, writable)) {
+			palloc_free_multiple (newpage, LPG_PAGES);
+			return false;
+		}
+		return true;
+	}
+
 	/* 2. Resolve VA from the parent's page map level 4. */
 	parent_page = pml4_get_page (parent->pml4, va);
 
@@ -477,6 +502,7 @@ validate_segment (const struct Phdr *phdr, struct file *file) {
 
 /* load() helpers. */
 static bool install_page (void *upage, void *kpage, bool writable);
+static bool install_large_page (void *upage, bool writable);
 
 /* Loads a segment starting at offset OFS in FILE at address
  * UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual
@@ -501,6 +527,17 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 
 	file_seek (file, ofs);
 	while (read_bytes > 0 || zero_bytes > 0) {
+		/* Back an aligned large page's worth of zero-fill with a large
+		 * page, if enabled.  Falls back to small pages if no large
+		 * page is available. */
+		if (user_large_pages && read_bytes == 0 && zero_bytes >= LPGSIZE
+				&& lpg_ofs (upage) == 0
+				&& install_large_page (upage, writable)) {
+			zero_bytes -= LPGSIZE;
+			upage += LPGSIZE;
+			continue;
+		}
+
 		/* Do calculate how to fill this page.
 		 * We will read PAGE_READ_BYTES bytes from FILE
 		 * and zero the final PAGE_ZERO_BYTES bytes. */
@@ -569,6 +606,28 @@ install_page (void *upage, void *kpage, bool writable) {
 	return (pml4_get_page (t->pml4, upage) == NULL
 			&& pml4_set_page (t->pml4, upage, kpage, writable));
 }
+
+/* Maps a zeroed large page at user virtual address UPAGE, which
+ * must be aligned on LPGSIZE and have nothing in its range mapped
+ * yet.  The page allocator aligns a block of LPG_PAGES pages on
+ * its size, as a large page requires.
+ * Returns true on success, false if no large page is available or
+ * if memory allocation fails. */
+static bool
+install_large_page (void *upage, bool writable) {
+	struct thread *t = thread_current ();
+	uint8_t *kpage;
+
+	kpage = palloc_get_multiple (PAL_USER | PAL_ZERO, LPG_PAGES);
+	if (kpage == NULL)
+		return false;
+	ASSERT (lpg_ofs (kpage) == 0);
+	if (!pml4_set_large_page (t->pml4, upage, kpage, writable)) {
+		palloc_free_multiple (kpage, LPG_PAGES);
+		return false;
+	}
+	return true;
+}
 #else
 /* From here, codes will be used after project 3.
  * If you want to implement the function for only project 2, implement it on the
@@ -1,15 +1,43 @@
 #include "userprog/syscall.h"
+#include <round.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/loader.h"
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "threads/flags.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
+static int64_t ms_to_ticks (unsigned ms);
+
+/* A system call that needs nothing but its arguments, ARGS[0]
+   through ARGS[5], taken from rdi, rsi, rdx, r10, r8 and r9.
+   Returns the value for rax. */
+typedef uint64_t syscall_func (const uint64_t args[6]);
+
+static syscall_func sys_futex_wait;
+static syscall_func sys_futex_wake;
+static syscall_func sys_set_deadline;
+static syscall_func sys_getpid;
+
+/* System calls taken on syscall-entry.S's fast path, which does
+   not build a `struct intr_frame', indexed by SYS_* number.
+   Calls with no entry here, which must include those that need
+   the user context, such as fork, exec and exit, go to
+   syscall_handler() instead. */
+syscall_func *const syscall_fast_table[] = {
+	[SYS_FUTEX_WAIT] = sys_futex_wait,
+	[SYS_FUTEX_WAKE] = sys_futex_wake,
+	[SYS_SET_DEADLINE] = sys_set_deadline,
+	[SYS_GETPID] = sys_getpid,
+};
+const uint64_t syscall_fast_cnt =
+	sizeof syscall_fast_table / sizeof *syscall_fast_table;
 
 /* System call.
  *
@@ -26,6 +54,14 @@ void syscall_handler (struct intr_frame *);
 
 void
 syscall_init (void) {
+	syscall_init_ap ();
+	futex_init ();
+}
+
+/* Points the running CPU's syscall instruction at syscall_entry.
+   Every CPU has its own copy of these MSRs. */
+void
+syscall_init_ap (void) {
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
 			((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t) syscall_entry);
@@ -37,10 +73,39 @@ syscall_init (void) {
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 }
 
-/* The main system call interface */
+/* The main system call interface, for calls that are not in
+   syscall_fast_table. */
 void
 syscall_handler (struct intr_frame *f UNUSED) {
 	// TODO: Your implementation goes here.
 	printf ("system call!\n");
 	thread_exit ();
 }
+
+static uint64_t
+sys_futex_wait (const uint64_t args[6]) {
+	return futex_wait ((const int *) args[0], (int) args[1]);
+}
+
+static uint64_t
+sys_futex_wake (const uint64_t args[6]) {
+	return futex_wake ((const int *) args[0], (int) args[1]);
+}
+
+static uint64_t
+sys_set_deadline (const uint64_t args[6]) {
+	return thread_set_deadline (ms_to_ticks ((unsigned) args[0]),
+			ms_to_ticks ((unsigned) args[1]));
+}
+
+static uint64_t
+sys_getpid (const uint64_t args[6] UNUSED) {
+	return thread_tid ();
+}
+
+/* Converts MS milliseconds to timer ticks, rounding up so that
+   a nonzero time is never less than one tick. */
+static int64_t
+ms_to_ticks (unsigned ms) {
+	return DIV_ROUND_UP ((int64_t) ms * TIMER_FREQ, 1000);
+}
@@ -2,8 +2,9 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
 #include "threads/thread.h"
-#include "threads/palloc.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
 
@@ -45,30 +46,44 @@
  *      stack pointer to point to the new thread's kernel stack.
  *      (The call is in schedule in thread.c.) */
 
-/* Kernel TSS. */
-struct task_state *tss;
+/* Each CPU has its own TSS, since each runs a different thread
+ * and so needs a different rsp0.  The slot after it is scratch
+ * space for syscall_entry, which reaches both through the
+ * KERNEL_GS_BASE MSR; see syscall-entry.S for the offsets. */
+struct cpu_tss {
+	struct task_state tss;
+	uint64_t user_rsp;              /* User rsp, saved by syscall_entry. */
+} __attribute__ ((aligned (128)));
 
-/* Initializes the kernel TSS. */
+static struct cpu_tss tss[CPU_MAX];
+
+#define MSR_KERNEL_GS_BASE 0xc0000102 /* Swapped in by swapgs. */
+
+/* Initializes the running CPU's TSS.  Called once on each CPU. */
 void
 tss_init (void) {
 	/* Our TSS is never used in a call gate or task gate, so only a
 	 * few fields of it are ever referenced, and those are the only
 	 * ones we initialize. */
-	tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	ASSERT (offsetof (struct cpu_tss, user_rsp) == 104);
+	write_msr (MSR_KERNEL_GS_BASE, (uint64_t) &tss[this_cpu ()->id]);
 	tss_update (thread_current ());
 }
 
-/* Returns the kernel TSS. */
+/* Returns the running CPU's TSS. */
 struct task_state *
 tss_get (void) {
-	ASSERT (tss != NULL);
-	return tss;
+	return &tss[this_cpu ()->id].tss;
 }
 
-/* Sets the ring 0 stack pointer in the TSS to point to the end
- * of the thread stack. */
+/* Sets the ring 0 stack pointer in the running CPU's TSS to point
+ * to the end of the thread stack. */
 void
 tss_update (struct thread *next) {
-	ASSERT (tss != NULL);
-	tss->rsp0 = (uint64_t) next + PGSIZE;
+	/* process_activate() also calls us with interrupts on, and a
+	 * migration between finding the TSS and writing it would
+	 * clobber another CPU's rsp0. */
+	enum intr_level old_level = intr_disable ();
+	tss_get ()->rsp0 = (uint64_t) next + PGSIZE;
+	intr_set_level (old_level);
 }